@@ -44,7 +44,7 @@ AsyncRendering::initialize()
   negative_pixels = NULL;
   frameids = NULL;
   negative_frameids = NULL;
-  frame_times = NULL;
+  frame_time = 0;
   kill_ager = false;
 	ager_tid = (pthread_t)-1;
 	
@@ -64,7 +64,6 @@ AsyncRendering::~AsyncRendering()
   if (negative_pixels) free(negative_pixels);
   if (frameids) free(frameids);
   if (negative_frameids) free(negative_frameids);
-  if (frame_times) free(frame_times);
 }
 
 void AsyncRendering::Clear()
@@ -98,38 +97,33 @@ AsyncRendering::FrameBufferAger_thread(void *p)
 	pthread_exit(NULL);
 }
 
+// Stale pixels all date from the start of the current frame, so whether
+// to fade or clear them is decided once per tick.   The lock is taken a
+// row of tiles at a time so arriving pixels are not held up for a whole
+// pass over the image.
+
 void
 AsyncRendering::FrameBufferAger()
 {
-	if (framebuffer && frameids && frame_times)
-	{
-		pthread_mutex_lock(&lock);
+	if (! framebuffer || ! frameids)
+    return;
 
-		long now = my_time();
+  pthread_mutex_lock(&lock);
+  int nrows = ager.GetNumberOfTileRows();
+  pthread_mutex_unlock(&lock);
 
-		for (int offset = 0; offset < width*height; offset++)
-		{
-			int fid = frameids[offset];
-			if (fid > 0 && fid < current)
-			{
-				long tm = frame_times[offset];
-				float sec = (now - tm) / 1000000000.0;
+  for (int row = 0; row < nrows; row++)
+  {
+		pthread_mutex_lock(&lock);
+
+		float sec = (my_time() - frame_time) / 1000000000.0;
+		if (sec > max_age)
+			ager.AgeTileRow(row, framebuffer, frameids, current, sec > (max_age + fadeout), sbuffer);
 
-				float *pix = framebuffer + (offset*4);
-				if (sec > max_age)
-				{
-					if (sec > (max_age + fadeout))
-					{
-						frame_times[offset] = now;
-						frameids[offset] = current;
-						*pix++ = 0.0, *pix++ = 0.0, *pix++ = 0.0, *pix++ = 1.0;
-					}
-					else
-						*pix++ *= 0.9, *pix++ *= 0.9, *pix++ *= 0.9, *pix++ = 1.0;
-				}
-			}
-		}
 		pthread_mutex_unlock(&lock);
+
+    if (sec <= max_age)
+      break;
 	}
 }
 
@@ -142,20 +136,15 @@ AsyncRendering::local_commit(MPI_Comm c)
   if (IsLocal() && !frameids)
   {
 		pthread_mutex_lock(&lock);
-    frameids = new int[GetTheWidth()*GetTheHeight()];
-    memset(frameids, 0, GetTheWidth()*GetTheHeight()*sizeof(int));
-
 		negative_pixels    = (float *)malloc(GetTheWidth()*GetTheHeight()*4*sizeof(float));
 		negative_frameids  = (int *)malloc(GetTheWidth()*GetTheHeight()*sizeof(int));
 		frameids           = (int *)malloc(GetTheWidth()*GetTheHeight()*sizeof(int));
-		frame_times        = (long *)malloc(GetTheWidth()*GetTheHeight()*sizeof(long));
 
 		memset(frameids, 0, GetTheWidth()*GetTheHeight()*sizeof(int));
 		memset(negative_frameids, 0, GetTheWidth()*GetTheHeight()*sizeof(int));
 
-		long now = my_time();
-		for (int i = 0; i < GetTheWidth()*GetTheHeight(); i++)
-			frame_times[i] = now;
+		frame_time = my_time();
+		ager.Resize(GetTheWidth(), GetTheHeight());
 
 		for (int i = 0; i < 4*GetTheWidth()*GetTheHeight(); i++)
 		{
@@ -189,9 +178,7 @@ AsyncRendering::AddLocalPixels(Pixel *p, int n, int frame, int s)
 		{
       this_frame_pixel_count = 0;
 			current = frame;
-
-			for (int offset = 0; offset < width*height; offset++)
-				frame_times[offset] = now;
+			frame_time = now;
 		}
 
 		// Only bump current frame IF this is a positive pixel
@@ -213,9 +200,7 @@ AsyncRendering::AddLocalPixels(Pixel *p, int n, int frame, int s)
       if (frameids[offset] == frame)
 			{
 #if 1
-				*pix++ += p->r;
-				*pix++ += p->g;
-				*pix++ += p->b;
+				AccumulateSample(pix, sbuffer[offset], &p->r, p->samples, 3);
 #else
 				float r = pix[0] + p->r;
 				float g = pix[1] + p->g;
@@ -261,7 +246,8 @@ AsyncRendering::AddLocalPixels(Pixel *p, int n, int frame, int s)
 					// pixel with the new sample and any negative samples that arrived 
 					// first
 					frameids[offset] = frame;
-					// frame_times[offset] = now;
+					sbuffer[offset] = p->samples;
+					ager.Touch(p->x, p->y, frame);
 					if (current == negative_frameids[offset])
 					{
 						*pix++ = (*npix + p->r);
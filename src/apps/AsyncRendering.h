@@ -23,6 +23,7 @@
 #include "Application.h"
 #include "Rendering.h"
 #include "Socket.h"
+#include "TileAger.h"
 
 #include <pthread.h>
 
@@ -87,7 +88,12 @@ private:
 	float*       negative_pixels = NULL;
 	int*         frameids = NULL;
 	int*         negative_frameids = NULL;
-	long*        frame_times = NULL;
+
+  // Pixels left over from prior frames start aging when the first
+  // contribution to the current frame arrives
+
+	long         frame_time;
+	TileAger     ager;
 
 	pthread_t		 ager_tid;
 	bool 				 kill_ager;
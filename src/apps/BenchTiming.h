@@ -0,0 +1,66 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#pragma once
+
+/*! \file BenchTiming.h 
+ * \brief wall-clock timing and JSON summaries shared by the benchmark apps
+ */
+
+#include <algorithm>
+#include <vector>
+#include <stdio.h>
+#include <time.h>
+
+//! seconds on the monotonic clock
+static inline double
+now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//! summary of a set of timings
+struct timing
+{
+	double min, median, mean;
+};
+
+//! summarize a set of timings, sorting them in place
+static inline timing
+summarize(std::vector<double>& t)
+{
+	timing r;
+	std::sort(t.begin(), t.end());
+	r.min = t.front();
+	r.median = t[t.size() / 2];
+	r.mean = 0;
+	for (auto d : t) r.mean += d;
+	r.mean /= t.size();
+	return r;
+}
+
+//! write a timing summary as a JSON member, scaling the seconds by `scale`
+static inline void
+print_timing(FILE *fp, const char *name, timing t, double scale)
+{
+	fprintf(fp, "\"%s\": {\"min\": %.3f, \"median\": %.3f, \"mean\": %.3f}", name, t.min*scale, t.median*scale, t.mean*scale);
+}
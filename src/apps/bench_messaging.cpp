@@ -0,0 +1,317 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+// Message-layer microbenchmarks, reported as JSON so results can be 
+// compared across commits:
+//
+//  - point-to-point round trips between ranks 0 and 1 (or rank 0 and itself
+//    if run on one process) over a range of message sizes, giving latency 
+//    (half the round trip) and bandwidth
+//  - the time for a blocking collective broadcast to return to its root, and
+//    for a non-collective broadcast to reach and be acknowledged by every 
+//    rank, over the same sizes; run under mpirun -np N for several N to see
+//    how the broadcast tree scales
+//  - the rate at which a stream of small Work messages is dispatched
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <pthread.h>
+
+#include "dtypes.h"
+#include "Application.h"
+
+using namespace gxy;
+using namespace std;
+
+int mpiRank = 0, mpiSize = 1;
+
+#include "Debug.h"
+#include "BenchTiming.h"
+
+// Rank 0 counts acknowledgements from the message handlers
+
+static pthread_mutex_t lck = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  w8 = PTHREAD_COND_INITIALIZER;
+static int acks = 0;
+
+static void
+ack()
+{
+	pthread_mutex_lock(&lck);
+	acks++;
+	pthread_cond_signal(&w8);
+	pthread_mutex_unlock(&lck);
+}
+
+static void
+wait_for_acks(int n)
+{
+	pthread_mutex_lock(&lck);
+	while (acks < n)
+		pthread_cond_wait(&w8, &lck);
+	acks -= n;
+	pthread_mutex_unlock(&lck);
+}
+
+class AckMsg : public Work
+{
+	WORK_CLASS(AckMsg, true)
+
+public:
+	bool Action(int s) { ack(); return false; }
+};
+
+// Returns to its sender sharing the contents of the ping, so the round trip 
+// carries the payload both ways
+
+class PongMsg : public Work
+{
+	WORK_CLASS(PongMsg, true)
+
+public:
+	bool Action(int s) { ack(); return false; }
+};
+
+class PingMsg : public Work
+{
+	WORK_CLASS(PingMsg, true)
+
+public:
+	bool Action(int s)
+	{
+		PongMsg pong(contents);
+		pong.Send(s);
+		return false;
+	}
+};
+
+// Each carries the length of the stream; the receiver acknowledges the last
+
+class StreamMsg : public Work
+{
+	WORK_CLASS(StreamMsg, true)
+
+public:
+	bool Action(int s)
+	{
+		static int count = 0;
+		if (++count == *(int *)get())
+		{
+			count = 0;
+			AckMsg a(sizeof(int));
+			a.Send(0);
+		}
+		return false;
+	}
+};
+
+class BcastAsyncMsg : public Work
+{
+	WORK_CLASS(BcastAsyncMsg, true)
+
+public:
+	bool Action(int s)
+	{
+		AckMsg a(sizeof(int));
+		a.Send(0);
+		return false;
+	}
+};
+
+class BcastCollectiveMsg : public Work
+{
+	WORK_CLASS(BcastCollectiveMsg, true)
+
+public:
+	bool CollectiveAction(MPI_Comm c, bool isRoot) { return false; }
+};
+
+WORK_CLASS_TYPE(AckMsg)
+WORK_CLASS_TYPE(PongMsg)
+WORK_CLASS_TYPE(PingMsg)
+WORK_CLASS_TYPE(StreamMsg)
+WORK_CLASS_TYPE(BcastAsyncMsg)
+WORK_CLASS_TYPE(BcastCollectiveMsg)
+
+// Run f warmup + iterations times, returning the summary of the timed iterations
+
+template<typename F>
+static timing
+measure(int warmup, int iterations, F f)
+{
+	vector<double> t;
+	for (int i = 0; i < warmup + iterations; i++)
+	{
+		double t0 = now();
+		f();
+		if (i >= warmup)
+			t.push_back(now() - t0);
+	}
+	return summarize(t);
+}
+
+void
+syntax(char *a)
+{
+  if (mpiRank == 0)
+  {
+    std::cerr << "syntax: " << a << " [options] " << endl;
+    std::cerr << "options:" << endl;
+    std::cerr << "  -i iterations  timed iterations per measurement (default 100)" << endl;
+    std::cerr << "  -w warmup      untimed iterations before each measurement (default 10)" << endl;
+    std::cerr << "  -m bytes       largest message size; sizes are powers of 4 up to it (default 4194304)" << endl;
+    std::cerr << "  -n messages    length of the message stream timed for dispatch rate (default 100000)" << endl;
+    std::cerr << "  -o file        write the JSON results to file (default stdout)" << endl;
+    std::cerr << "  -D[which]  run debugger in selected processes.  If which is given, it is a number or a hyphenated range, defaults to all" << endl;
+  }
+  exit(1);
+}
+
+int
+main(int argc, char * argv[])
+{
+  char *dbgarg;
+  bool dbg = false;
+  int iterations = 100, warmup = 10, nstream = 100000;
+  size_t maxbytes = 4194304;
+  char *ofile = NULL;
+
+	Application theApplication(&argc, &argv);
+	theApplication.Start();
+
+  mpiRank = theApplication.GetRank();
+  mpiSize = theApplication.GetSize();
+
+  for (int i = 1; i < argc; i++)
+    if (!strncmp(argv[i],"-D", 2)) dbg = true, dbgarg = argv[i] + 2;
+    else if (!strcmp(argv[i], "-i") && (i+1) < argc) iterations = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-w") && (i+1) < argc) warmup = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-m") && (i+1) < argc) maxbytes = atol(argv[++i]);
+    else if (!strcmp(argv[i], "-n") && (i+1) < argc) nstream = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-o") && (i+1) < argc) ofile = argv[++i];
+    else syntax(argv[0]);
+
+  if (iterations < 1 || warmup < 0 || nstream < 1 || maxbytes < 4)
+    syntax(argv[0]);
+
+  if (dbg) new Debug(argv[0], false, dbgarg);
+
+	theApplication.Run();
+
+	AckMsg::Register();
+	PongMsg::Register();
+	PingMsg::Register();
+	StreamMsg::Register();
+	BcastAsyncMsg::Register();
+	BcastCollectiveMsg::Register();
+
+	if (mpiRank == 0)
+	{
+		FILE *fp = ofile ? fopen(ofile, "w") : stdout;
+		if (! fp)
+		{
+			std::cerr << "unable to open " << ofile << endl;
+			theApplication.QuitApplication();
+			theApplication.Wait();
+			exit(1);
+		}
+
+		int peer = (mpiSize > 1) ? 1 : 0;
+
+		// Point-to-point Work can't be empty, so the smallest message is 4 bytes
+
+		vector<size_t> sizes;
+		for (size_t s = 4; s <= maxbytes; s *= 4)
+			sizes.push_back(s);
+
+		fprintf(fp, "{\n  \"benchmark\": \"messaging\",\n  \"ranks\": %d,\n  \"iterations\": %d,\n  \"warmup\": %d,\n", mpiSize, iterations, warmup);
+
+		fprintf(fp, "  \"point_to_point\": [\n");
+		for (size_t i = 0; i < sizes.size(); i++)
+		{
+			size_t s = sizes[i];
+			timing t = measure(warmup, iterations, [s, peer]() {
+				PingMsg ping(s);
+				ping.Send(peer);
+				wait_for_acks(1);
+			});
+
+			// Latency is half the round trip; bandwidth counts the payload once each way
+
+			timing lat = {t.min / 2, t.median / 2, t.mean / 2};
+			double mbps = (2.0 * s) / t.median / 1e6;
+
+			fprintf(fp, "    {\"bytes\": %lu, ", s);
+			print_timing(fp, "latency_us", lat, 1e6);
+			fprintf(fp, ", \"bandwidth_MBps\": %.3f}%s\n", mbps, (i < sizes.size()-1) ? "," : "");
+		}
+		fprintf(fp, "  ],\n");
+
+		fprintf(fp, "  \"broadcast\": [\n");
+		for (size_t i = 0; i < sizes.size(); i++)
+		{
+			size_t s = sizes[i];
+
+			timing tc = measure(warmup, iterations, [s]() {
+				BcastCollectiveMsg b(s);
+				b.Broadcast(true, true);
+			});
+
+			timing ta = measure(warmup, iterations, [s]() {
+				BcastAsyncMsg b(s);
+				b.Broadcast(false);
+				wait_for_acks(mpiSize);
+			});
+
+			fprintf(fp, "    {\"bytes\": %lu, ", s);
+			print_timing(fp, "collective_us", tc, 1e6);
+			fprintf(fp, ", ");
+			print_timing(fp, "async_us", ta, 1e6);
+			fprintf(fp, "}%s\n", (i < sizes.size()-1) ? "," : "");
+		}
+		fprintf(fp, "  ],\n");
+
+		double t0 = now();
+		for (int i = 0; i < nstream; i++)
+		{
+			StreamMsg m(sizeof(int));
+			*(int *)m.get() = nstream;
+			m.Send(peer);
+		}
+		wait_for_acks(1);
+		double t = now() - t0;
+
+		fprintf(fp, "  \"dispatch\": {\"messages\": %d, \"seconds\": %.6f, \"messages_per_second\": %.1f}\n}\n", nstream, t, nstream / t);
+
+		if (ofile)
+			fclose(fp);
+
+		theApplication.QuitApplication();
+	}
+
+	theApplication.Wait();
+}
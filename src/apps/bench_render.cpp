@@ -0,0 +1,702 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+// Rendering benchmark, reported as JSON so results can be compared across
+// commits.   No input files are read: each process generates its own 
+// partition of
+//
+//  - a float volume of n^3 samples holding concentric radial shells,
+//  - particles scattered uniformly through the volume's bounds, and
+//  - a tessellated sphere of 2m^2 triangles
+//
+// using the same spatial partitioning for all three.   For each selected 
+// workload a fixed orbit of cameras is rendered one frame at a time, and 
+// the time of each frame (from the start of rendering to its completion 
+// everywhere) is reported along with the time spent in each phase of ray 
+// processing, summed over all threads of all processes.   Run under mpirun 
+// -np N with several N, and with several -t, to see how rendering scales.
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "dtypes.h"
+#include "Application.h"
+#include "Threading.h"
+#include "Camera.h"
+#include "Datasets.h"
+#include "Particles.h"
+#include "ParticlesVis.h"
+#include "Renderer.h"
+#include "RenderTimings.h"
+#include "Rendering.h"
+#include "RenderingSet.h"
+#include "Triangles.h"
+#include "TrianglesVis.h"
+#include "Visualization.h"
+#include "Volume.h"
+#include "VolumeVis.h"
+
+using namespace gxy;
+using namespace std;
+
+int mpiRank = 0, mpiSize = 1;
+
+#include "Debug.h"
+#include "BenchTiming.h"
+
+#define VOLUME    0x1
+#define PARTICLES 0x2
+#define TRIANGLES 0x4
+
+// Split size processes into a grid of partitions, choosing the factors with 
+// the smallest sum as Volume does on import
+
+static void
+factor(int size, vec3i& f)
+{
+	f.x = 1; f.y = 1; f.z = size;
+	int best = size + 2;
+	for (int i = 1; i <= size; i++)
+		if ((size % i) == 0)
+			for (int j = 1; j <= size / i; j++)
+				if (((size / i) % j) == 0)
+				{
+					int k = size / (i * j);
+					if (i + j + k < best)
+						best = i + j + k, f.x = i, f.y = j, f.z = k;
+				}
+}
+
+// Everything a process needs to know of its partition of an n^3 grid 
+// spanning [-1, 1]^3.  As for imported volumes, the outer layer of samples 
+// is ghost data, and each partition has one layer of ghost samples all round.
+
+struct grid_partition
+{
+	grid_partition(int n, int rank, int size)
+	{
+		factor(size, parts);
+		ijk.x = rank % parts.x;
+		ijk.y = (rank / parts.x) % parts.y;
+		ijk.z = rank / (parts.x * parts.y);
+
+		counts = vec3i(n, n, n);
+		delta = 2.0 / (n - 1);
+
+		int *o = (int *)&offset, *c = (int *)&local, *p = (int *)&parts, *q = (int *)&ijk;
+		for (int a = 0; a < 3; a++)
+		{
+			int d = (n - 2) / p[a];
+			o[a] = 1 + q[a]*d;
+			c[a] = 1 + ((q[a] == (p[a]-1)) ? (n - 2) - o[a] : d);
+		}
+
+#define ijk2rank(i, j, k) ((i) + ((j) * parts.x) + ((k) * parts.x * parts.y))
+
+		neighbors[0] = (ijk.x > 0) ? ijk2rank(ijk.x - 1, ijk.y, ijk.z) : -1;
+		neighbors[1] = (ijk.x < (parts.x-1)) ? ijk2rank(ijk.x + 1, ijk.y, ijk.z) : -1;
+		neighbors[2] = (ijk.y > 0) ? ijk2rank(ijk.x, ijk.y - 1, ijk.z) : -1;
+		neighbors[3] = (ijk.y < (parts.y-1)) ? ijk2rank(ijk.x, ijk.y + 1, ijk.z) : -1;
+		neighbors[4] = (ijk.z > 0) ? ijk2rank(ijk.x, ijk.y, ijk.z - 1) : -1;
+		neighbors[5] = (ijk.z < (parts.z-1)) ? ijk2rank(ijk.x, ijk.y, ijk.z + 1) : -1;
+
+#undef ijk2rank
+
+		float d[] = {delta, delta, delta};
+
+		float go[] = {-1.0f + delta, -1.0f + delta, -1.0f + delta};
+		int   gc[] = {n - 2, n - 2, n - 2};
+		global_box = Box(go, gc, d);
+
+		float lo[] = {-1.0f + offset.x*delta, -1.0f + offset.y*delta, -1.0f + offset.z*delta};
+		local_box = Box(lo, (int *)&local, d);
+	}
+
+	vec3i parts, ijk, counts, offset, local;
+	float delta;
+	int neighbors[6];
+	Box global_box, local_box;
+};
+
+static float
+shells(float x, float y, float z)
+{
+	return 0.5 + 0.5*sin(8.0*sqrt(x*x + y*y + z*z));
+}
+
+static void
+generate_volume(VolumeP v, grid_partition& p)
+{
+	v->set_type(Volume::FLOAT);
+	v->set_number_of_components(1);
+	v->set_global_partitions(p.parts.x, p.parts.y, p.parts.z);
+	v->set_ijk(p.ijk.x, p.ijk.y, p.ijk.z);
+	v->set_global_counts(p.counts.x, p.counts.y, p.counts.z);
+	v->set_global_origin(-1.0, -1.0, -1.0);
+	v->set_deltas(p.delta, p.delta, p.delta);
+	v->set_local_offset(p.offset.x, p.offset.y, p.offset.z);
+	v->set_local_counts(p.local.x, p.local.y, p.local.z);
+	v->set_ghosted_local_offset(p.offset.x - 1, p.offset.y - 1, p.offset.z - 1);
+	v->set_ghosted_local_counts(p.local.x + 2, p.local.y + 2, p.local.z + 2);
+	v->set_neighbors(p.neighbors);
+	v->set_boxes(p.local_box, p.global_box);
+
+	size_t nx = p.local.x + 2, ny = p.local.y + 2, nz = p.local.z + 2;
+	float *samples = (float *)malloc(nx * ny * nz * sizeof(float));
+
+	float *s = samples;
+	for (size_t k = 0; k < nz; k++)
+	{
+		float z = -1.0 + (p.offset.z - 1 + k) * p.delta;
+		for (size_t j = 0; j < ny; j++)
+		{
+			float y = -1.0 + (p.offset.y - 1 + j) * p.delta;
+			for (size_t i = 0; i < nx; i++)
+				*s++ = shells(-1.0 + (p.offset.x - 1 + i) * p.delta, y, z);
+		}
+	}
+
+	v->set_samples(samples);
+}
+
+// Particles are scattered uniformly through the global box, so each process
+// gets its share of the total in proportion to the volume of its box
+
+static void
+generate_particles(ParticlesP particles, grid_partition& p, long total, float radius)
+{
+	particles->set_boxes(p.local_box, p.global_box);
+	particles->set_neighbors(p.neighbors);
+
+	Box *l = &p.local_box, *g = &p.global_box;
+	double fraction = ((l->xyz_max.x - l->xyz_min.x) * (l->xyz_max.y - l->xyz_min.y) * (l->xyz_max.z - l->xyz_min.z)) /
+	                  ((g->xyz_max.x - g->xyz_min.x) * (g->xyz_max.y - g->xyz_min.y) * (g->xyz_max.z - g->xyz_min.z));
+	int n = (int)(total * fraction + 0.5);
+
+	// Kept clear of the box faces, where the box is big enough, so that no 
+	// sphere spans partitions
+
+	float r = std::min(std::min(std::min(radius, 0.25f*(l->xyz_max.x - l->xyz_min.x)),
+	                                             0.25f*(l->xyz_max.y - l->xyz_min.y)),
+	                                             0.25f*(l->xyz_max.z - l->xyz_min.z));
+
+	std::mt19937 rng(GetTheApplication()->GetRank() + 1);
+	std::uniform_real_distribution<float> x(l->xyz_min.x + r, l->xyz_max.x - r);
+	std::uniform_real_distribution<float> y(l->xyz_min.y + r, l->xyz_max.y - r);
+	std::uniform_real_distribution<float> z(l->xyz_min.z + r, l->xyz_max.z - r);
+
+	particles->allocate(n, 0);
+
+	vec3f *vertices = particles->GetVertices();
+	float *data = particles->GetData();
+	for (int i = 0; i < n; i++)
+	{
+		vertices[i] = vec3f(x(rng), y(rng), z(rng));
+		data[i] = shells(vertices[i].x, vertices[i].y, vertices[i].z);
+	}
+}
+
+// A latitude/longitude tessellation of a sphere of radius 0.75 with m 
+// divisions each way.  Each process keeps the triangles whose bounds meet 
+// its box, so those spanning partitions are duplicated in each.
+
+static void
+generate_triangles(TrianglesP triangles, grid_partition& p, int m)
+{
+	triangles->set_boxes(p.local_box, p.global_box);
+	triangles->set_neighbors(p.neighbors);
+
+	const float R = 0.75;
+	Box *l = &p.local_box;
+
+	auto grid_vertex = [m, R](int i, int j) 
+	{
+		float theta = M_PI * j / m, phi = 2 * M_PI * i / m;
+		return vec3f(R * sin(theta) * cos(phi), R * cos(theta), R * sin(theta) * sin(phi));
+	};
+
+	auto inside = [l](vec3f a, vec3f b, vec3f c)
+	{
+		return std::max(std::max(a.x, b.x), c.x) >= l->xyz_min.x && std::min(std::min(a.x, b.x), c.x) <= l->xyz_max.x &&
+		       std::max(std::max(a.y, b.y), c.y) >= l->xyz_min.y && std::min(std::min(a.y, b.y), c.y) <= l->xyz_max.y &&
+		       std::max(std::max(a.z, b.z), c.z) >= l->xyz_min.z && std::min(std::min(a.z, b.z), c.z) <= l->xyz_max.z;
+	};
+
+	// Grid vertex indices of the kept triangles, then the local index of each
+	// grid vertex that is used
+
+	vector<int> kept;
+	for (int j = 0; j < m; j++)
+		for (int i = 0; i < m; i++)
+		{
+			int a = j*(m+1) + i, b = a + 1, c = a + (m+1) + 1, d = a + (m+1);
+			vec3f va = grid_vertex(i, j), vb = grid_vertex(i+1, j), vc = grid_vertex(i+1, j+1), vd = grid_vertex(i, j+1);
+
+			if (inside(va, vb, vc)) kept.push_back(a), kept.push_back(b), kept.push_back(c);
+			if (inside(va, vc, vd)) kept.push_back(a), kept.push_back(c), kept.push_back(d);
+		}
+
+	vector<int> local((m+1)*(m+1), -1);
+	int nv = 0;
+	for (auto k : kept)
+		if (local[k] == -1)
+			local[k] = nv++;
+
+	triangles->allocate(nv, kept.size());
+
+	vec3f *vertices = triangles->GetVertices();
+	vec3f *normals = triangles->GetNormals();
+	float *data = triangles->GetData();
+	int *connectivity = triangles->GetConnectivity();
+
+	for (int k = 0; k < (m+1)*(m+1); k++)
+		if (local[k] != -1)
+		{
+			vec3f v = grid_vertex(k % (m+1), k / (m+1));
+			vertices[local[k]] = v;
+			normals[local[k]] = vec3f(v.x / R, v.y / R, v.z / R);
+			data[local[k]] = 0.5 + 0.5 * (v.y / R);
+		}
+
+	for (size_t i = 0; i < kept.size(); i++)
+		connectivity[i] = local[kept[i]];
+}
+
+// Each process generates its partition of the selected datasets
+
+class GenerateMsg : public Work
+{
+	struct args
+	{
+		int  which;
+		Key  vk, pk, tk;
+		int  n;
+		long np;
+		float radius;
+		int  m;
+	};
+
+public:
+	GenerateMsg(int which, VolumeP v, ParticlesP p, TrianglesP t, int n, long np, float radius, int m) : GenerateMsg(sizeof(args))
+	{
+		args *a = (args *)contents->get();
+		a->which = which;
+		a->vk = v ? v->getkey() : -1;
+		a->pk = p ? p->getkey() : -1;
+		a->tk = t ? t->getkey() : -1;
+		a->n = n;
+		a->np = np;
+		a->radius = radius;
+		a->m = m;
+	}
+
+	WORK_CLASS(GenerateMsg, true)
+
+public:
+	bool CollectiveAction(MPI_Comm c, bool isRoot)
+	{
+		args *a = (args *)contents->get();
+		grid_partition p(a->n, GetTheApplication()->GetRank(), GetTheApplication()->GetSize());
+
+		if (a->which & VOLUME)
+			generate_volume(Volume::GetByKey(a->vk), p);
+
+		if (a->which & PARTICLES)
+			generate_particles(Particles::GetByKey(a->pk), p, a->np, a->radius);
+
+		if (a->which & TRIANGLES)
+			generate_triangles(Triangles::GetByKey(a->tk), p, a->m);
+
+		return false;
+	}
+};
+
+// Zero the phase timings everywhere, or reduce them to the root
+
+static double phase_seconds[RenderTimings::NUMBER_OF_PHASES];
+static double phase_max_seconds[RenderTimings::NUMBER_OF_PHASES];
+static long   phase_runs[RenderTimings::NUMBER_OF_PHASES];
+
+// Ray message bytes sent and received, summed over and most at any one process
+
+static long bytes[2], max_rank_bytes[2];
+
+class TimingsMsg : public Work
+{
+public:
+	TimingsMsg(bool reset) : TimingsMsg(sizeof(int))
+	{
+		*(int *)contents->get() = reset ? 1 : 0;
+	}
+
+	WORK_CLASS(TimingsMsg, true)
+
+public:
+	bool CollectiveAction(MPI_Comm c, bool isRoot)
+	{
+		if (*(int *)contents->get())
+		{
+			RenderTimings::Reset();
+			return false;
+		}
+
+		double seconds[RenderTimings::NUMBER_OF_PHASES];
+		long runs[RenderTimings::NUMBER_OF_PHASES];
+		RenderTimings::Get(seconds, runs);
+
+		MPI_Reduce(seconds, phase_seconds, RenderTimings::NUMBER_OF_PHASES, MPI_DOUBLE, MPI_SUM, 0, c);
+		MPI_Reduce(seconds, phase_max_seconds, RenderTimings::NUMBER_OF_PHASES, MPI_DOUBLE, MPI_MAX, 0, c);
+		MPI_Reduce(runs, phase_runs, RenderTimings::NUMBER_OF_PHASES, MPI_LONG, MPI_SUM, 0, c);
+
+		long b[2];
+		RenderTimings::GetBytes(b[0], b[1]);
+
+		MPI_Reduce(b, bytes, 2, MPI_LONG, MPI_SUM, 0, c);
+		MPI_Reduce(b, max_rank_bytes, 2, MPI_LONG, MPI_MAX, 0, c);
+
+		return false;
+	}
+};
+
+WORK_CLASS_TYPE(GenerateMsg)
+WORK_CLASS_TYPE(TimingsMsg)
+
+// Camera i of an n-camera orbit around the origin, looking down slightly
+
+static CameraP
+orbit_camera(int i, int n, int width, int height)
+{
+	CameraP cam = Camera::NewP();
+
+	float angle = 2*M_PI*(float(i) / n);
+	float vpx = 5.0 * cos(angle), vpy = 1.5, vpz = 5.0 * sin(angle);
+
+	cam->set_viewup(0.0, 1.0, 0.0);
+	cam->set_angle_of_view(30.0);
+	cam->set_viewpoint(vpx, vpy, vpz);
+	cam->set_viewdirection(-vpx, -vpy, -vpz);
+	cam->set_width(width);
+	cam->set_height(height);
+	cam->Commit();
+
+	return cam;
+}
+
+// Render a single frame, returning the time from its start to its completion
+
+static double
+render_frame(RendererP theRenderer, DatasetsP theDatasets, VisualizationP v, CameraP cam, int owner, string image)
+{
+	RenderingSetP rs = RenderingSet::NewP();
+	RenderingP r = Rendering::NewP();
+	r->SetTheOwner(owner);
+	r->SetTheCamera(cam);
+	r->SetTheDatasets(theDatasets);
+	r->SetTheVisualization(v);
+	r->Commit();
+	rs->AddRendering(r);
+	rs->Commit();
+
+	double t0 = now();
+	theRenderer->Start(rs);
+	rs->WaitForDone();
+	double t = now() - t0;
+
+	if (image != "")
+		rs->SaveImages(image);
+
+	return t;
+}
+
+void
+syntax(char *a)
+{
+  if (mpiRank == 0)
+  {
+    std::cerr << "syntax: " << a << " [options] " << endl;
+    std::cerr << "options:" << endl;
+    std::cerr << "  -d workloads   comma-separated list of volume, particles and triangles (default all)" << endl;
+    std::cerr << "  -v n           volume samples per axis (default 256)" << endl;
+    std::cerr << "  -p n           total number of particles (default 1000000)" << endl;
+    std::cerr << "  -r radius      particle radius (default 0.01)" << endl;
+    std::cerr << "  -m n           sphere mesh divisions per axis; the mesh has 2n^2 triangles (default 1000)" << endl;
+    std::cerr << "  -s w h         image size (default 512 512)" << endl;
+    std::cerr << "  -f frames      frames in the camera orbit (default 16)" << endl;
+    std::cerr << "  -w warmup      untimed frames rendered before the orbit (default 2)" << endl;
+    std::cerr << "  -t threads     threads in the rendering thread pool (default GXY_NTHREADS)" << endl;
+    std::cerr << "  -S             cast shadows, so that rays are traced beyond the first hit" << endl;
+    std::cerr << "  -O basename    save the images of the orbit" << endl;
+    std::cerr << "  -o file        write the JSON results to file (default stdout)" << endl;
+    std::cerr << "  -D[which]  run debugger in selected processes.  If which is given, it is a number or a hyphenated range, defaults to all" << endl;
+  }
+  exit(1);
+}
+
+int
+main(int argc, char * argv[])
+{
+  char *dbgarg;
+  bool dbg = false;
+  int which = VOLUME | PARTICLES | TRIANGLES;
+  int n = 256, m = 1000, width = 512, height = 512, frames = 16, warmup = 2;
+  long np = 1000000;
+  float radius = 0.01;
+  bool shadows = false;
+  char *ofile = NULL;
+  string ibase("");
+
+  // The rendering thread pool is sized when the Application is created
+
+  for (int i = 1; i < argc - 1; i++)
+    if (!strcmp(argv[i], "-t"))
+      setenv("GXY_NTHREADS", argv[i+1], 1);
+
+	Application theApplication(&argc, &argv);
+	theApplication.Start();
+
+  mpiRank = theApplication.GetRank();
+  mpiSize = theApplication.GetSize();
+
+  for (int i = 1; i < argc; i++)
+    if (!strncmp(argv[i],"-D", 2)) dbg = true, dbgarg = argv[i] + 2;
+    else if (!strcmp(argv[i], "-d") && (i+1) < argc)
+    {
+      which = 0;
+      stringstream ss(argv[++i]);
+      string w;
+      while (getline(ss, w, ','))
+        if (w == "volume") which |= VOLUME;
+        else if (w == "particles") which |= PARTICLES;
+        else if (w == "triangles") which |= TRIANGLES;
+        else syntax(argv[0]);
+    }
+    else if (!strcmp(argv[i], "-v") && (i+1) < argc) n = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-p") && (i+1) < argc) np = atol(argv[++i]);
+    else if (!strcmp(argv[i], "-r") && (i+1) < argc) radius = atof(argv[++i]);
+    else if (!strcmp(argv[i], "-m") && (i+1) < argc) m = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-s") && (i+2) < argc) width = atoi(argv[++i]), height = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-f") && (i+1) < argc) frames = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-w") && (i+1) < argc) warmup = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-t") && (i+1) < argc) i++;
+    else if (!strcmp(argv[i], "-S")) shadows = true;
+    else if (!strcmp(argv[i], "-O") && (i+1) < argc) ibase = argv[++i];
+    else if (!strcmp(argv[i], "-o") && (i+1) < argc) ofile = argv[++i];
+    else syntax(argv[0]);
+
+  // Every partition of the volume must hold at least one cell
+
+  vec3i parts;
+  factor(mpiSize, parts);
+  int most = std::max(std::max(parts.x, parts.y), parts.z);
+
+  if (which == 0 || (n - 2) < most || np < 0 || radius <= 0 || m < 1 || width < 1 || height < 1 || frames < 1 || warmup < 0)
+    syntax(argv[0]);
+
+  if (dbg) new Debug(argv[0], false, dbgarg);
+
+  Renderer::Initialize();
+	theApplication.Run();
+
+	GenerateMsg::Register();
+	TimingsMsg::Register();
+
+	if (mpiRank == 0)
+	{
+		FILE *fp = ofile ? fopen(ofile, "w") : stdout;
+		if (! fp)
+		{
+			std::cerr << "unable to open " << ofile << endl;
+			theApplication.QuitApplication();
+			theApplication.Wait();
+			exit(1);
+		}
+
+    RendererP theRenderer = Renderer::NewP();
+    theRenderer->Commit();
+
+		VolumeP volume = (which & VOLUME) ? Volume::NewP() : nullptr;
+		ParticlesP particles = (which & PARTICLES) ? Particles::NewP() : nullptr;
+		TrianglesP triangles = (which & TRIANGLES) ? Triangles::NewP() : nullptr;
+
+		double t0 = now();
+
+		GenerateMsg g(which, volume, particles, triangles, n, np, radius, m);
+		g.Broadcast(true, true);
+
+    DatasetsP theDatasets = Datasets::NewP();
+		if (volume)    volume->Commit(),    theDatasets->Insert("volume", volume);
+		if (particles) particles->Commit(), theDatasets->Insert("particles", particles);
+		if (triangles) triangles->Commit(), theDatasets->Insert("triangles", triangles);
+		theDatasets->Commit();
+
+		double t_generate = now() - t0;
+
+		vector<CameraP> theCameras;
+		for (int i = 0; i < frames; i++)
+			theCameras.push_back(orbit_camera(i, frames, width, height));
+
+    vec4f cmap[] = {
+        {0.00,1.0,0.5,0.5},
+        {0.25,0.5,1.0,0.5},
+        {0.50,0.5,0.5,1.0},
+        {0.75,1.0,1.0,0.5},
+        {1.00,1.0,0.5,1.0}
+    };
+
+    vec2f omap[] = {
+        {0.00, 0.00},
+        {0.80, 0.00},
+        {1.00, 0.10}
+    };
+
+		fprintf(fp, "{\n  \"benchmark\": \"render\",\n  \"ranks\": %d,\n  \"threads\": %d,\n", 
+				mpiSize, theApplication.GetTheThreadPool()->GetNumberOfThreads());
+		fprintf(fp, "  \"partitions\": [%d, %d, %d],\n", parts.x, parts.y, parts.z);
+		fprintf(fp, "  \"width\": %d,\n  \"height\": %d,\n  \"frames\": %d,\n  \"warmup\": %d,\n  \"shadows\": %s,\n", 
+				width, height, frames, warmup, shadows ? "true" : "false");
+		fprintf(fp, "  \"generate_seconds\": %.6f,\n", t_generate);
+		fprintf(fp, "  \"workloads\": [\n");
+
+		const char *names[] = {"volume", "particles", "triangles"};
+		bool first = true;
+		for (int w = 0; w < 3; w++)
+		{
+			if (! (which & (1 << w)))
+				continue;
+
+			VisP vis;
+			if (w == 0)
+			{
+				VolumeVisP vvis = VolumeVis::NewP();
+				vvis->SetOpacityMap(3, omap);
+				vvis->SetVolumeRendering(true);
+				vis = vvis;
+			}
+			else if (w == 1)
+			{
+				ParticlesVisP pvis = ParticlesVis::NewP();
+				pvis->SetRadius(radius);
+				vis = pvis;
+			}
+			else
+				vis = TrianglesVis::NewP();
+
+			MappedVisP mvis = std::dynamic_pointer_cast<MappedVis>(vis);
+			mvis->SetColorMap(5, cmap);
+			vis->SetName(names[w]);
+			vis->Commit(theDatasets);
+
+			VisualizationP v = Visualization::NewP();
+			float light[] = {1.0, 2.0, 3.0}; int t = 1;
+			v->get_the_lights()->SetLights(1, light, &t);
+			v->get_the_lights()->SetK(0.4, 0.6);
+			v->get_the_lights()->SetShadowFlag(shadows);
+			v->get_the_lights()->SetAO(0, 0.0);
+			v->AddVis(vis);
+			v->Commit(theDatasets);
+
+			for (int i = 0; i < warmup; i++)
+				render_frame(theRenderer, theDatasets, v, theCameras[0], 0, "");
+
+			TimingsMsg reset(true);
+			reset.Broadcast(true, true);
+
+			// The owner of each frame, and so the process that composites it, 
+			// moves round the processes
+
+			vector<double> times;
+			for (int i = 0; i < frames; i++)
+			{
+				string image("");
+				if (ibase != "")
+				{
+					stringstream ss;
+					ss << ibase << "_" << names[w] << "_" << i;
+					image = ss.str();
+				}
+
+				times.push_back(render_frame(theRenderer, theDatasets, v, theCameras[i], i % mpiSize, image));
+			}
+
+			double total = 0;
+			for (auto t : times) total += t;
+
+			TimingsMsg gather(false);
+			gather.Broadcast(true, true);
+
+			timing ft = summarize(times);
+
+			fprintf(fp, "%s    {\n      \"workload\": \"%s\",\n", first ? "" : ",\n", names[w]);
+			if (w == 0)
+				fprintf(fp, "      \"samples\": [%d, %d, %d],\n", n, n, n);
+			else if (w == 1)
+				fprintf(fp, "      \"particles\": %ld,\n      \"radius\": %.4f,\n", np, radius);
+			else
+				fprintf(fp, "      \"triangles\": %ld,\n", 2L*m*m);
+
+			fprintf(fp, "      ");
+			print_timing(fp, "frame_ms", ft, 1e3);
+			fprintf(fp, ",\n      \"frames_per_second\": %.3f,\n      \"primary_rays_per_second\": %.1f,\n", 
+					frames / total, (double(width) * height * frames) / total);
+
+			// Ray message bytes per frame, summed over all processes and the most
+			// sent or received by any one process
+
+			fprintf(fp, "      \"mpi_bytes_per_frame\": {\"sent\": %.1f, \"received\": %.1f, "
+									"\"max_rank_sent\": %.1f, \"max_rank_received\": %.1f},\n",
+					double(bytes[0]) / frames, double(bytes[1]) / frames,
+					double(max_rank_bytes[0]) / frames, double(max_rank_bytes[1]) / frames);
+
+			// Per phase, the seconds summed over all threads and processes, the 
+			// most spent by any one process, and the number of times it ran
+
+			fprintf(fp, "      \"phases\": {\n");
+			for (int p = 0; p < RenderTimings::NUMBER_OF_PHASES; p++)
+				fprintf(fp, "        \"%s\": {\"seconds\": %.6f, \"max_rank_seconds\": %.6f, \"runs\": %ld}%s\n",
+						RenderTimings::Name(p), phase_seconds[p], phase_max_seconds[p], phase_runs[p],
+						(p < RenderTimings::NUMBER_OF_PHASES-1) ? "," : "");
+			fprintf(fp, "      }\n    }");
+
+			first = false;
+		}
+
+		fprintf(fp, "\n  ]\n}\n");
+
+		if (ofile)
+			fclose(fp);
+
+		theCameras.clear();
+		theDatasets = nullptr;
+		theRenderer = nullptr;
+
+		theApplication.QuitApplication();
+	}
+
+	theApplication.Wait();
+}
@@ -43,6 +43,7 @@ using namespace rapidjson;
 #include <vtkFloatArray.h>
 #include <vtkDoubleArray.h>
 
+#include "ShmTransport.h"
 #include "SocketHandler.h"
 
 int mpiRank = 0, mpiSize;
@@ -212,6 +213,15 @@ main(int argc, char **argv)
   vector<bool> isvector;
   int point_count;
 
+  // If the datadesc asks for the shared-memory transport, timesteps are
+  // written into a segment per variable that Galaxy creates
+
+  bool shm = false;
+  vector<gxy::ShmHeader *> segments;
+  vector<int> segment_fds;
+  vector<uint64_t> segment_sizes;
+  uint64_t step = 0;
+
   for (auto t = 0; t < 2; t++)
   {
     string datadesc_file = datafiles[t];
@@ -295,6 +305,8 @@ main(int argc, char **argv)
 
     if (t == 0)
     {
+      shm = datadesc_doc.HasMember("transport") && string(datadesc_doc["transport"].GetString()) == "shm";
+
       int extent[6];
       vti->GetExtent(extent);
 
@@ -362,11 +374,17 @@ main(int argc, char **argv)
     rdr->Delete();
   }
 
+  segments.assign(varnames.size(), NULL);
+  segment_fds.assign(varnames.size(), -1);
+  segment_sizes.assign(varnames.size(), 0);
+
   // Now for each output time step:
 
   int it = 0; bool done = false; int dir = 1;
   while (! done)
   {
+    step++;
+
     float t =  (nsteps == 1) ? 0.5 : it / float(nsteps - 1);
 
     for (int i = 0; i < varnames.size(); i++)
@@ -407,12 +425,30 @@ main(int argc, char **argv)
 
       MPI_Barrier(MPI_COMM_WORLD);
   
-      skt->ConnectToServer(host.c_str(), port);
-      skt->Send(interpolated[i], point_count * (isvector[i] ? 3 : 1) * sizeof(float));
+      if (shm)
+      {
+        // Galaxy creates the segment on the first accept.   A real simulation
+        // would compute straight into the slot rather than copy into it.
+
+        if (! segments[i])
+          while (! (segments[i] = gxy::ShmAttach(gxy::ShmSegmentName(port, name), segment_fds[i], segment_sizes[i])))
+            usleep(10000);
 
-      int rply;
-      skt->Receive(&rply, sizeof(rply), 1);
-      std::cerr << mpiRank << ": received ack for " << name << "\n";
+        while (step > segments[i]->released)
+          usleep(1000);
+
+        memcpy(gxy::ShmSlot(segments[i], step), interpolated[i], point_count * (isvector[i] ? 3 : 1) * sizeof(float));
+        segments[i]->written = step;
+      }
+      else
+      {
+        skt->ConnectToServer(host.c_str(), port);
+        skt->Send(interpolated[i], point_count * (isvector[i] ? 3 : 1) * sizeof(float));
+
+        int rply;
+        skt->Receive(&rply, sizeof(rply), 1);
+        std::cerr << mpiRank << ": received ack for " << name << "\n";
+      }
 
       if (mpiRank == 0)
       {
@@ -483,6 +519,10 @@ main(int argc, char **argv)
     }
   }
 
+  for (int i = 0; i < segments.size(); i++)
+    if (segments[i])
+      gxy::ShmDetach(segments[i], "", segment_fds[i], segment_sizes[i], false);
+
   if (mpiRank == 0)
   {
     string cmd = string("close;");
@@ -0,0 +1,218 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+// Convert a VTK point set (.vtu, .vtp or legacy .vtk) holding one partition of
+// a Galaxy Geometry to a Galaxy geometry file (.gxyg), which Galaxy maps into
+// memory and uses in place rather than parsing.   Refer to the .gxyg files in
+// place of the VTK files in the geometry's partition document.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vtkSmartPointer.h>
+#include <vtkNew.h>
+#include <vtkPointSet.h>
+#include <vtkPoints.h>
+#include <vtkPointData.h>
+#include <vtkDataArray.h>
+#include <vtkFloatArray.h>
+#include <vtkCellIterator.h>
+#include <vtkCellType.h>
+#include <vtkIdList.h>
+#include <vtkDataSetReader.h>
+#include <vtkXMLGenericDataObjectReader.h>
+
+#include "dtypes.h"
+#include "GeometryFile.h"
+
+using namespace gxy;
+using namespace std;
+
+void
+syntax(char *a)
+{
+  cerr << "syntax: " << a << " [options] input.{vtu,vtp,vtk} output.gxyg" << endl;
+  cerr << "options:" << endl;
+  cerr << "  -t type    triangles, particles or pathlines (default: from the type of the first cell)" << endl;
+  exit(1);
+}
+
+// Copy a 3-component array to floats, converting other types
+
+static void
+get_vec3f(vtkDataArray *a, vector<vec3f>& v)
+{
+  int n = a->GetNumberOfTuples();
+  v.resize(n);
+
+  vtkFloatArray *f = vtkFloatArray::SafeDownCast(a);
+  if (f && f->GetNumberOfComponents() == 3)
+    memcpy(v.data(), f->GetVoidPointer(0), n*sizeof(vec3f));
+  else
+    for (int i = 0; i < n; i++)
+    {
+      double *t = a->GetTuple3(i);
+      v[i] = vec3f(t[0], t[1], t[2]);
+    }
+}
+
+static void
+get_float(vtkDataArray *a, int n, vector<float>& v)
+{
+  v.resize(n);
+
+  vtkFloatArray *f = vtkFloatArray::SafeDownCast(a);
+  if (! a)
+    memset(v.data(), 0, n*sizeof(float));
+  else if (f && f->GetNumberOfComponents() == 1)
+    memcpy(v.data(), f->GetVoidPointer(0), n*sizeof(float));
+  else
+    for (int i = 0; i < n; i++)
+      v[i] = a->GetComponent(i, 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  string type = "";
+  char *ifile = NULL, *ofile = NULL;
+
+  for (int i = 1; i < argc; i++)
+    if (!strcmp(argv[i], "-t") && (i+1) < argc) type = argv[++i];
+    else if (argv[i][0] == '-') syntax(argv[0]);
+    else if (! ifile) ifile = argv[i];
+    else if (! ofile) ofile = argv[i];
+    else syntax(argv[0]);
+
+  if (! ofile)
+    syntax(argv[0]);
+
+  string iname(ifile);
+  vtkSmartPointer<vtkPointSet> pset;
+
+  if (iname.size() > 4 && iname.substr(iname.size() - 4) == ".vtk")
+  {
+    vtkNew<vtkDataSetReader> rdr;
+    rdr->SetFileName(ifile);
+    rdr->Update();
+    pset = vtkPointSet::SafeDownCast(rdr->GetOutput());
+  }
+  else
+  {
+    vtkNew<vtkXMLGenericDataObjectReader> rdr;
+    rdr->SetFileName(ifile);
+    rdr->Update();
+    pset = vtkPointSet::SafeDownCast(rdr->GetOutput());
+  }
+
+  if (! pset)
+  {
+    cerr << "unable to read a point set from " << ifile << endl;
+    exit(1);
+  }
+
+  if (type == "")
+  {
+    vtkCellIterator *it = pset->NewCellIterator();
+    int ct = it->IsDoneWithTraversal() ? VTK_VERTEX : it->GetCellType();
+    it->Delete();
+
+    type = (ct == VTK_TRIANGLE) ? "triangles" : (ct == VTK_LINE || ct == VTK_POLY_LINE) ? "pathlines" : "particles";
+  }
+
+  int nv = pset->GetNumberOfPoints();
+
+  vector<vec3f> points;
+  if (nv)
+    get_vec3f(pset->GetPoints()->GetData(), points);
+
+  vtkDataArray *array = pset->GetPointData()->GetScalars();
+  if (! array) array = pset->GetPointData()->GetArray("data");
+
+  vector<float> data;
+  get_float(array, nv, data);
+
+  bool ok = false;
+  if (type == "triangles")
+  {
+    vtkDataArray *narray = pset->GetPointData()->GetArray("Normals");
+    if (! narray) narray = pset->GetPointData()->GetArray("Normals_");
+
+    vector<vec3f> normals;
+    if (narray)
+      get_vec3f(narray, normals);
+
+    vector<int> connectivity;
+    connectivity.reserve(3*pset->GetNumberOfCells());
+
+    vtkCellIterator *it = pset->NewCellIterator();
+    for (it->InitTraversal(); !it->IsDoneWithTraversal(); it->GoToNextCell())
+    {
+      vtkIdList *ids = it->GetPointIds();
+      if (ids->GetNumberOfIds() != 3)
+      {
+        cerr << "triangles can only hold 3-vertex cells" << endl;
+        exit(1);
+      }
+      for (int j = 0; j < 3; j++)
+        connectivity.push_back(ids->GetId(j));
+    }
+    it->Delete();
+
+    ok = GeometryFile::Write(ofile, GeometryFile::TRIANGLES, nv, points.data(), narray ? normals.data() : NULL, data.data(), 
+                             connectivity.size(), connectivity.data());
+  }
+  else if (type == "pathlines")
+  {
+    // As PathLines loads from VTK: each line's vertices are laid out in turn
+    // and the connectivity holds the first vertex of each segment
+
+    vector<vec3f> lvertices;
+    vector<float> ldata;
+    vector<int> connectivity;
+
+    vtkCellIterator *it = pset->NewCellIterator();
+    for (it->InitTraversal(); !it->IsDoneWithTraversal(); it->GoToNextCell())
+    {
+      vtkIdList *ids = it->GetPointIds();
+      for (int l = 0; l < ids->GetNumberOfIds(); l++)
+      {
+        int id = ids->GetId(l);
+        if (l < (ids->GetNumberOfIds() - 1))
+          connectivity.push_back(lvertices.size());
+        lvertices.push_back(points[id]);
+        ldata.push_back(data[id]);
+      }
+    }
+    it->Delete();
+
+    ok = GeometryFile::Write(ofile, GeometryFile::PATHLINES, lvertices.size(), lvertices.data(), NULL, ldata.data(),
+                             connectivity.size(), connectivity.data());
+  }
+  else if (type == "particles")
+    ok = GeometryFile::Write(ofile, GeometryFile::PARTICLES, nv, points.data(), NULL, data.data(), 0, NULL);
+  else
+    syntax(argv[0]);
+
+  return ok ? 0 : 1;
+}
@@ -19,10 +19,20 @@
 // // ========================================================================== //
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
 #include <cmath>
+#include <cctype>
+#include <cstring>
 
 #include "Application.h"
 #include "AmrVolume.h"
+#include "OsprayAmrVolume.h"
+
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkDataArray.h>
 
 namespace gxy
 {
@@ -32,12 +42,13 @@ void
 AmrVolume::initialize()
 {
     this->samplingRate = 0.5;
+    numlevels = 0;
+    numgrids = 0;
     super::initialize();
 }
 
 AmrVolume::~AmrVolume()
 {
-    // put stuff here
 }
 
 void
@@ -46,265 +57,546 @@ AmrVolume::Register()
     RegisterClass();
 }
 
-// this is the same factor function taken from Volume.cpp. Declared as static there.
-// this version may take into account amr nature of the data
+// Read the extent of a legacy VTK structured points file from its header,
+// without reading the data
+
+static bool
+read_vtk_extent(std::string fname, vec3f& origin, vec3f& spacing, vec3i& dims)
+{
+    std::ifstream in(fname.c_str(), std::ios::binary);
+    if (in.fail())
+        return false;
+
+    origin = vec3f(0.0, 0.0, 0.0);
+    spacing = vec3f(1.0, 1.0, 1.0);
+
+    bool have_dims = false;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream ss(line);
+        std::string kw;
+        ss >> kw;
+        std::transform(kw.begin(), kw.end(), kw.begin(), ::toupper);
+
+        if (kw == "DIMENSIONS")
+        {
+            ss >> dims.x >> dims.y >> dims.z;
+            have_dims = ! ss.fail();
+        }
+        else if (kw == "SPACING" || kw == "ASPECT_RATIO")
+            ss >> spacing.x >> spacing.y >> spacing.z;
+        else if (kw == "ORIGIN")
+            ss >> origin.x >> origin.y >> origin.z;
+        else if (kw == "POINT_DATA" || kw == "CELL_DATA")
+            break;
+    }
+
+    return have_dims;
+}
+
+// volume of the intersection of two boxes, 0 if they do not overlap
+
+static double
+overlap(Box& a, Box& b)
+{
+    double v = 1.0;
+    for (int i = 0; i < 3; i++)
+    {
+        double lo = std::max(a.get_min()[i], b.get_min()[i]);
+        double hi = std::min(a.get_max()[i], b.get_max()[i]);
+        if (hi <= lo) return 0.0;
+        v *= hi - lo;
+    }
+    return v;
+}
+
+double
+AmrVolume::cost(Box& region, std::vector<int>& subset)
+{
+    double c = 0.0;
+    for (auto i : subset)
+    {
+        amrgrid& g = grids[i];
+        c += overlap(region, g.box) / ((double)g.spacing.x * g.spacing.y * g.spacing.z);
+    }
+    return c;
+}
+
+// Recursive bisection of the region among n processes.   The split plane
+// is on the longest axis, on a level-0 cell boundary, where the number of
+// cells of all levels on each side is in proportion to the number of
+// processes on that side.   subset holds the grids that overlap the region.
+
+int
+AmrVolume::bisect(Box region, std::vector<int>& subset, int rank0, int n, vec3f& h0, std::vector<Box>& regions)
+{
+    int node = partitions.size();
+    partitions.push_back(partnode());
+
+    if (n == 1)
+    {
+        partitions[node].axis = -1;
+        partitions[node].child[0] = rank0;
+        regions[rank0] = region;
+        return node;
+    }
+
+    float *lo = region.get_min();
+    float *hi = region.get_max();
+    float *h = (float *)&h0;
+
+    int axis = 0;
+    for (int i = 1; i < 3; i++)
+        if ((hi[i] - lo[i]) / h[i] > (hi[axis] - lo[axis]) / h[axis])
+            axis = i;
+
+    int nlo = n / 2;
+    double target = cost(region, subset) * nlo / n;
+    int ncells = (int)((hi[axis] - lo[axis]) / h[axis] + 0.5);
+
+    float plane;
+    if (ncells < 2)
+        plane = lo[axis] + (hi[axis] - lo[axis]) * nlo / n;
+    else
+    {
+        // smallest k such that the cost below the plane at k reaches the target
+
+        Box below = region;
+        int k0 = 1, k1 = ncells - 1;
+        while (k0 < k1)
+        {
+            int k = (k0 + k1) / 2;
+            below.get_max()[axis] = lo[axis] + k*h[axis];
+            if (cost(below, subset) < target) k0 = k + 1;
+            else k1 = k;
+        }
+
+        below.get_max()[axis] = lo[axis] + k0*h[axis];
+        double c0 = cost(below, subset);
+        if (k0 > 1)
+        {
+            below.get_max()[axis] = lo[axis] + (k0-1)*h[axis];
+            if (target - cost(below, subset) < c0 - target)
+                k0 = k0 - 1;
+        }
+
+        plane = lo[axis] + k0*h[axis];
+    }
+
+    partitions[node].axis = axis;
+    partitions[node].plane = plane;
+
+    Box side[2] = {region, region};
+    side[0].get_max()[axis] = plane;
+    side[1].get_min()[axis] = plane;
+
+    for (int s = 0; s < 2; s++)
+    {
+        std::vector<int> sub;
+        for (auto i : subset)
+            if (overlap(side[s], grids[i].box) > 0.0)
+                sub.push_back(i);
+
+        int c = s == 0 ? bisect(side[0], sub, rank0, nlo, h0, regions)
+                       : bisect(side[1], sub, rank0 + nlo, n - nlo, h0, regions);
+        partitions[node].child[s] = c;
+    }
+
+    return node;
+}
+
+int
+AmrVolume::build_tree(int first, int count)
+{
+    int node = gridtree.size();
+    gridtree.push_back(gridnode());
+
+    Box box;
+    for (int i = first; i < first + count; i++)
+        box.add(grids[localgrids[gridorder[i]]].box);
+    gridtree[node].box = box;
+
+    if (count <= 4)
+    {
+        gridtree[node].first = first;
+        gridtree[node].count = count;
+        return node;
+    }
+
+    // split at the median of the grid centers on the longest axis
+
+    int axis = 0;
+    for (int i = 1; i < 3; i++)
+        if ((box.get_max()[i] - box.get_min()[i]) > (box.get_max()[axis] - box.get_min()[axis]))
+            axis = i;
+
+    auto center = [this, axis](int i)
+    {
+        Box& b = grids[localgrids[i]].box;
+        return b.get_min()[axis] + b.get_max()[axis];
+    };
+
+    int half = count / 2;
+    std::nth_element(gridorder.begin() + first, gridorder.begin() + first + half, gridorder.begin() + first + count,
+        [&center](int a, int b) { return center(a) < center(b); });
 
-static void
-factor(int ijk, vec3i &factors)
+    gridtree[node].count = 0;
+    int l = build_tree(first, half);
+    int r = build_tree(first + half, count - half);
+    gridtree[node].child[0] = l;
+    gridtree[node].child[1] = r;
+
+    return node;
+}
+
+int
+AmrVolume::find_grid(vec3f& p)
 {
-//  If ijk is prime, 1, 1, ijk will be chosen, i+j+k == ijk+2
-
- if (ijk == 1)
- {
-   factors.x = factors.y = factors.z = 1;
-   return;
- }
-
- int mm = ijk+3;
- for (int i = 1; i <= ijk>>1; i++)
- {
-   int jk = ijk / i;
-   if (ijk == (i * jk))
-   {
-      for (int j = 1; j <= jk>>1; j++)
-       {
-          int k = jk / j;
-          if (jk == (j * k))
-          {
-            int m = i + j + k;
-            if (m < mm)
+    if (gridtree.empty())
+        return -1;
+
+    int best = -1, best_level = -1;
+
+    int stack[64], sp = 0;
+    stack[sp++] = 0;
+    while (sp)
+    {
+        gridnode& n = gridtree[stack[--sp]];
+        if (! n.box.isIn(p))
+            continue;
+
+        if (n.count)
+        {
+            for (int i = n.first; i < n.first + n.count; i++)
             {
-               mm = m;
-               factors.x = i;
-               factors.y = j;
-               factors.z = k;
-             }
-           }
-       }
+                amrgrid& g = grids[localgrids[gridorder[i]]];
+                if (g.level > best_level && g.box.isIn(p))
+                {
+                    best = gridorder[i];
+                    best_level = g.level;
+                }
+            }
+        }
+        else
+        {
+            stack[sp++] = n.child[0];
+            stack[sp++] = n.child[1];
+        }
     }
- }
+
+    return best;
 }
 
-// this struct also appears in Volume.cpp. It needs to be placed in
-// a header file for all to enjoy..
-struct part
+// The extent of each grid as shipped in the import payload: level, origin,
+// spacing and cell counts
+
+static const int grid_meta_size = 10;
+
+bool
+AmrVolume::ReadHeader()
 {
-    vec3i ijk;
-    vec3i counts;
-    vec3i gcounts;
-    vec3i offsets;
-    vec3i goffsets;
-};
-
-/*part *
-partition(int ijk, vec3i factors, vec3i grid)
+    std::string ext((filename.find_last_of(".") == std::string::npos) ? "" :
+            filename.substr(filename.find_last_of(".")+1,filename.length()));
+
+    if (ext == "amrvol")
+        return ReadGxyAmrHeader();
+    else if (ext == "hierarchy")
+        return ReadEnzoHierarchy();
+
+    if (GetTheApplication()->GetRank() == 0)
+        std::cerr << "ERROR: AmrVolume: unrecognized file extension (" << ext << ")" << std::endl;
+    return false;
+}
+
+bool
+AmrVolume::Import(std::string fname, void *args, int argsSize)
 {
-  int ni = grid.x - 2;
-  int nj = grid.y - 2;
-  int nk = grid.z - 2;
-
-  int di = ni / factors.x;
-  int dj = nj / factors.y;
-  int dk = nk / factors.z;
-
-  part *parts = new part[ijk];
-  part *p = parts;
-  for (int k = 0; k < factors.z; k++)
-    for (int j = 0; j < factors.y; j++)
-      for (int i = 0; i < factors.x; i++, p++)
-      {
-        p->ijk.x = i;
-        p->ijk.y = j;
-        p->ijk.z = k;
-
-        p->offsets.x = 1 + i*di;
-        p->offsets.y = 1 + j*dj;
-        p->offsets.z = 1 + k*dk;
-
-        p->goffsets.x = p->offsets.x - 1;
-        p->goffsets.y = p->offsets.y - 1;
-        p->goffsets.z = p->offsets.z - 1;
-
-        p->counts.x = 1 + ((i == (factors.x-1)) ? ni - p->offsets.x : di);
-        p->counts.y = 1 + ((j == (factors.y-1)) ? nj - p->offsets.y : dj);
-        p->counts.z = 1 + ((k == (factors.z-1)) ? nk - p->offsets.z : dk);
-
-        p->gcounts.x = p->counts.x + 2;
-        p->gcounts.y = p->counts.y + 2;
-        p->gcounts.z = p->counts.z + 2;
-      }
-
-    return parts;
-}*/
-extern part*
-partition(int ijk, vec3i factors, vec3i grid);
+    // The master reads the extent of every grid and ships them with the 
+    // import, ahead of any caller's arguments: the number of grids followed
+    // by grid_meta_size floats per grid
+
+    filename = fname;
+    if (! ReadHeader() || ! ReadGridMetadata())
+    {
+        set_error(1);
+        return false;
+    }
+
+    std::vector<unsigned char> payload(sizeof(int) + numgrids*grid_meta_size*sizeof(float) + argsSize);
+    unsigned char *p = payload.data();
+
+    *(int *)p = numgrids;
+    p += sizeof(int);
+
+    for (int i = 0; i < numgrids; i++)
+    {
+        amrgrid& g = grids[i];
+        float m[grid_meta_size] = {
+            (float)g.level,
+            g.origin.x,  g.origin.y,  g.origin.z,
+            g.spacing.x, g.spacing.y, g.spacing.z,
+            (float)g.counts.x, (float)g.counts.y, (float)g.counts.z
+        };
+        memcpy(p, m, sizeof(m));
+        p += sizeof(m);
+    }
+
+    if (argsSize)
+        memcpy(p, args, argsSize);
+
+    return Volume::Import(fname, payload.data(), payload.size());
+}
 
 bool
 AmrVolume::local_import(char *fname, MPI_Comm c)
 {
-    std::string type_string,data_fname;
     filename = fname;
-    std::cerr << "AMR local import" << std::endl;
-    vtkStructuredPointsReader *gridreader = vtkStructuredPointsReader::New();
-    vtkStructuredPoints *gsp;
+
     int rank = GetTheApplication()->GetRank();
     int size = GetTheApplication()->GetSize();
-    // here we examine the fname to determine, from extension, what type
-    // of data we are looking at and read it appropriately.
-    
-    // dir contains the directory of the file or empty string
-    std::string dir((filename.find_last_of("/") == std::string::npos) ? "" : 
-            filename.substr(0,filename.find_last_of("/")+1));
 
-    std::string ext((filename.find_last_of(".") == std::string::npos) ? "" :
-            filename.substr(filename.find_last_of(".")+1,filename.length()));
-    amrtype flt = NOEXT;
-    // do something more clever later.
-    if(ext == "amrvol") 
+    // Every process reads the (small) header; the grid extents come from the 
+    // master in the payload, so nothing here is collective and a failure at
+    // one process leaves the others to finish
+
+    if (! ReadHeader())
+        return false;
+
+    unsigned char *p = (unsigned char *)fname + strlen(fname) + 1;
+
+    int n;
+    memcpy(&n, p, sizeof(int));
+    p += sizeof(int);
+
+    if (n != numgrids)
     {
-        flt = GXYAMR;
-    } 
-    else if(ext == "hierarchy") 
+        std::cerr << "ERROR: AmrVolume: " << filename << " changed during import" << std::endl;
+        return false;
+    }
+
+    grids.resize(numgrids);
+    for (int i = 0; i < numgrids; i++)
+    {
+        float m[grid_meta_size];
+        memcpy(m, p, sizeof(m));
+        p += sizeof(m);
+
+        amrgrid& g = grids[i];
+        g.level = (int)m[0];
+        g.origin = vec3f(m[1], m[2], m[3]);
+        g.spacing = vec3f(m[4], m[5], m[6]);
+        g.counts = vec3i((int)m[7], (int)m[8], (int)m[9]);
+        g.box = Box(g.origin, g.origin + vec3f(g.counts.x*g.spacing.x, g.counts.y*g.spacing.y, g.counts.z*g.spacing.z));
+    }
+
+    // The global domain is the union of the level-0 grids.   Every process
+    // computes the same partitioning from the same metadata.
+
+    Box domain;
+    std::vector<int> all;
+    for (int i = 0; i < numgrids; i++)
     {
-        flt = ENZOAMR;
-    } 
-    switch(flt) 
+        if (grids[i].level == 0)
+            domain.add(grids[i].box);
+        all.push_back(i);
+    }
+
+    vec3f h0 = grids[0].spacing;
+
+    std::vector<Box> regions(size);
+    partitions.clear();
+    bisect(domain, all, 0, size, h0, regions);
+
+    Box& region = regions[rank];
+    local_box = region;
+    global_box = domain;
+
+    // The uniform-grid description of the level-0 domain and the local part of it
+
+    type = FLOAT;
+    number_of_components = 1;
+    deltas = h0;
+    global_origin = domain.xyz_min;
+    global_counts = vec3i(1 + (int)((domain.xyz_max.x - domain.xyz_min.x) / h0.x + 0.5),
+                          1 + (int)((domain.xyz_max.y - domain.xyz_min.y) / h0.y + 0.5),
+                          1 + (int)((domain.xyz_max.z - domain.xyz_min.z) / h0.z + 0.5));
+    local_offset = vec3i((int)((region.xyz_min.x - domain.xyz_min.x) / h0.x + 0.5),
+                         (int)((region.xyz_min.y - domain.xyz_min.y) / h0.y + 0.5),
+                         (int)((region.xyz_min.z - domain.xyz_min.z) / h0.z + 0.5));
+    local_counts = vec3i(1 + (int)((region.xyz_max.x - region.xyz_min.x) / h0.x + 0.5),
+                         1 + (int)((region.xyz_max.y - region.xyz_min.y) / h0.y + 0.5),
+                         1 + (int)((region.xyz_max.z - region.xyz_min.z) / h0.z + 0.5));
+    ghosted_local_offset = local_offset;
+    ghosted_local_counts = local_counts;
+
+    // Face neighbors, for anything that routes by face: the owner of the point
+    // just beyond the center of each face
+
+    vec3f center;
+    region.center(center);
+    for (int f = 0; f < 6; f++)
     {
-        case GXYAMR: ReadGxyAmrHeader();
-            break;
-        case ENZOAMR: ReadEnzoHierarchy();
-            break;
-        default: std::cerr << "indeterminate input file type" << std::endl;
-            break;
+        int axis = f >> 1;
+        vec3f q = center;
+        float *qp = (float *)&q;
+        float step = 0.5 * ((float *)&h0)[axis];
+        qp[axis] = (f & 1) ? region.get_max()[axis] + step : region.get_min()[axis] - step;
+        neighbors[f] = PointOwner(q);
     }
-    // now read the level 0 grid and decompose it (if necessary) as done
-    // in the parent class. There can be many level 0 grids. We need to 
-    // move this into the loop over grids and levels below. 
-    gridreader->SetFileName(gridfilenames[0].c_str());
-    gsp = gridreader->GetOutput();
-    gridreader->Update();
-    // now get some metadata
-    // The level 0 grid loads "global metadata" as well as gridspacing and 
-    // gridcounts vectors. (data is duplicated)
-    double dvector[3],range[2],bounds[6];
-    int ivector[3];
-    float *fltptr;
-    vec3f tmpvec,lowerbound,upperbound;
-    gsp->GetOrigin(dvector);
-    gsp->ComputeBounds();
-    gsp->GetBounds(bounds);
-    lowerbound.x = bounds[0];
-    lowerbound.y = bounds[2];
-    lowerbound.z = bounds[4];
-    upperbound.x = bounds[1];
-    upperbound.y = bounds[3];
-    upperbound.z = bounds[5];
-    std::cerr <<"level0 lb" <<  lowerbound.x << " " << lowerbound.y << " " << lowerbound.z << std::endl;
-    std::cerr <<"level0 ub" <<  upperbound.x << " " << upperbound.y << " " << upperbound.z << std::endl;
-    std::cerr << "AMRV: origin " << dvector[0] << " " << dvector[1] <<" " << dvector[2] << std::endl;
-    global_origin.x = dvector[0];
-    global_origin.y = dvector[1];
-    global_origin.z = dvector[2];
-    gridorigin.push_back(global_origin);
-    gsp->GetDimensions(ivector);
-    std::cerr << "AMRV: dimensions " << ivector[0] << " " << ivector[1] <<" " << ivector[2] << std::endl;
-    global_counts.x = ivector[0] -1;
-    global_counts.y = ivector[1] -1;
-    global_counts.z = ivector[2] -1;
-    // save the data to gridcounts vector too. level= grid = 0..
-    gridcounts.push_back(global_counts);
-    gsp->GetSpacing(dvector);
-    std::cerr << "AMRV: spacing " << dvector[0] << " " << dvector[1] <<" " << dvector[2] << std::endl;
-    deltas.x = dvector[0];
-    deltas.y = dvector[1];
-    deltas.z = dvector[2];
-    // save the data to gridspacing
-    gridspacing.push_back(deltas);
-    // now partition the level 0 grid if needed..
-    vec3i global_partitions;
-    factor(size,global_partitions);
-//    std::cerr << "AMRV: part " << global_partitions.x << " " 
-//        << global_partitions.y << " " 
-//        << global_partitions.z << std::endl;
-    part *partitions = partition(size,global_partitions, global_counts);
- //   std::cerr << " AMRV: rank " << rank << std::endl;
-    part *my_partition = partitions + rank;
-    local_offset = my_partition->offsets;
-    local_counts = my_partition->counts;
-    ghosted_local_offset = my_partition->goffsets;
-    ghosted_local_counts = my_partition->gcounts;
-    // done partitioning level0 metadata. Use it to get some scalars
-    // NOTE: this is broke using vtk datasets.
-    // just set the level0 data to point to all of level 0 for now.
-    // insert malloc of space for points here and copy gsp data to new location
-    int npts = gsp->GetNumberOfPoints();
-    std::cerr << " level0 grid has " << npts << " points" << std::endl;
-    if(gsp->GetScalarType() == VTK_FLOAT)
-        std::cerr << " scalars type float" << std::endl;
-    else
-        std::cerr << " scalars type not flota " << std::endl;
-    type = gsp->GetScalarType() == VTK_FLOAT?FLOAT:UCHAR;
-    fltptr = new float[npts];
-    float* dptr = (float*)gsp->GetScalarPointer();
-    //gridsamples.push_back((float*)gsp->GetScalarPointer());
-    for(int p = 0; p<npts;p++) fltptr[p] = dptr[p];
-    gridsamples.push_back(fltptr);
-    float* yourmama = (float*)gsp->GetScalarPointer();
-    std::cerr << "first float from gsp" << yourmama[0]<< " " << yourmama[1] << std::endl;
-    gsp->GetScalarRange(range);
-    local_min = range[0];
-    local_max = range[1];
-    // now do the rest of the grids in all the levels
-    for(int l=1;l<numlevels;l++)
+
+    // Read the grids that overlap the local part, at any level, into one
+    // contiguous array of float samples
+
+    localgrids.clear();
+    size_t nsamples = 0;
+    for (int i = 0; i < numgrids; i++)
+        if (overlap(region, grids[i].box) > 0.0)
+        {
+            localgrids.push_back(i);
+            vec3i& n = grids[i].counts;
+            nsamples += (size_t)(n.x + 1) * (n.y + 1) * (n.z + 1);
+        }
+
+    localsamples.resize(nsamples);
+    gridsamples.clear();
+
+    vtkNew<vtkStructuredPointsReader> gridreader;
+    float *dst = localsamples.data();
+    for (auto i : localgrids)
     {
-        // get all the grids in this level
-        for(int g=0;g<levelnumgrids[l];g++)
+        amrgrid& g = grids[i];
+        size_t npts = (size_t)(g.counts.x + 1) * (g.counts.y + 1) * (g.counts.z + 1);
+
+        gridreader->SetFileName(gridfilenames[i].c_str());
+        gridreader->Update();
+
+        vtkStructuredPoints *gsp = gridreader->GetOutput();
+        vtkDataArray *scalars = gsp->GetPointData()->GetScalars();
+        if (! scalars || (size_t)gsp->GetNumberOfPoints() != npts)
         {
-            int index = get_grid_index(l,g);
-            gridreader->SetFileName(gridfilenames[index].c_str());
-            gridreader->Update();
-            gsp->GetOrigin(dvector);
-            gsp->GetScalarRange(range);
-            local_min = (local_min < range[0])?local_min:range[0];
-            local_max = (local_max > range[1])?local_max:range[1];
-            tmpvec.x = dvector[0];
-            tmpvec.y = dvector[1];
-            tmpvec.z = dvector[2];
-            gridorigin.push_back(tmpvec);
-            gsp->GetDimensions(ivector);
-            gridcounts.push_back(vec3i(ivector[0]-1,ivector[1]-1,ivector[2]-1));
-            gsp->GetSpacing(dvector);
-            tmpvec.x = dvector[0];
-            tmpvec.y = dvector[1];
-            tmpvec.z = dvector[2];
-            gridspacing.push_back(tmpvec);
-            dptr = (float*)gsp->GetScalarPointer();
-            npts = gsp->GetNumberOfPoints();
-            fltptr = new float[npts];
-            for(int p = 0; p<npts;p++) fltptr[p] = dptr[p];
-            gridsamples.push_back(fltptr);
-            //gridsamples.push_back((float*)gsp->GetScalarPointer());
+            std::cerr << "ERROR: AmrVolume: unable to read grid " << gridfilenames[i] << std::endl;
+            return false;
         }
+
+        if (scalars->GetDataType() == VTK_FLOAT && scalars->GetNumberOfComponents() == 1)
+            memcpy(dst, scalars->GetVoidPointer(0), npts * sizeof(float));
+        else
+            for (size_t p = 0; p < npts; p++)
+                dst[p] = scalars->GetComponent(p, 0);
+
+        gridsamples.push_back(dst);
+        dst += npts;
     }
-    // a macro from the volume object. 
-#define ijk2rank(i, j, k) ((i) + ((j) * global_partitions.x) + ((k) * global_partitions.x * global_partitions.y))
-    // set neighbors
-    neighbors[0] = (my_partition->ijk.x > 0) ? ijk2rank(my_partition->ijk.x - 1, my_partition->ijk.y, my_partition->ijk.z) : -1;
-    neighbors[1] = (my_partition->ijk.x < (global_partitions.x-1)) ? ijk2rank(my_partition->ijk.x + 1, my_partition->ijk.y, my_partition->ijk.z) : -1;
-    neighbors[2] = (my_partition->ijk.y > 0) ? ijk2rank(my_partition->ijk.x, my_partition->ijk.y - 1, my_partition->ijk.z) : -1;
-    neighbors[3] = (my_partition->ijk.y < (global_partitions.y-1)) ? ijk2rank(my_partition->ijk.x, my_partition->ijk.y + 1, my_partition->ijk.z) : -1;
-    neighbors[4] = (my_partition->ijk.z > 0) ? ijk2rank(my_partition->ijk.x, my_partition->ijk.y, my_partition->ijk.z - 1) : -1;
-    neighbors[5] = (my_partition->ijk.z < (global_partitions.z-1)) ? ijk2rank(my_partition->ijk.x, my_partition->ijk.y, my_partition->ijk.z + 1) : -1;
-    // set global values here. This wont hold up under mpi
-    global_min = local_min;
-    global_max = local_max;
-    // We need to set the local_box. 
-    set_local_box(lowerbound,upperbound);
-    // global box same as local box in this one d example... bad juju. 
-    global_box = Box(lowerbound,upperbound);
+
+    // Box tree over the local grids
+
+    gridtree.clear();
+    gridorder.resize(localgrids.size());
+    for (size_t i = 0; i < localgrids.size(); i++)
+        gridorder[i] = i;
+    if (! localgrids.empty())
+        build_tree(0, localgrids.size());
 
     return true;
 }
+
+bool
+AmrVolume::local_commit(MPI_Comm c)
+{
+    if (KeyedDataObject::local_commit(c))
+        return true;
+
+    commit_range(localsamples.data(), localsamples.size(), 1, c);
+    return false;
+}
+
+bool
+AmrVolume::Sample(vec3f& p, float* result)
+{
+    if (! local_box.isIn(p))
+        return false;
+
+    int i = find_grid(p);
+    if (i < 0)
+        return false;
+
+    amrgrid& g = grids[localgrids[i]];
+
+    float x = (p.x - g.origin.x) / g.spacing.x;
+    float y = (p.y - g.origin.y) / g.spacing.y;
+    float z = (p.z - g.origin.z) / g.spacing.z;
+
+    int ix = std::min(std::max((int)floor(x), 0), g.counts.x - 1);
+    int iy = std::min(std::max((int)floor(y), 0), g.counts.y - 1);
+    int iz = std::min(std::max((int)floor(z), 0), g.counts.z - 1);
+
+    float dx = x - ix, dy = y - iy, dz = z - iz;
+
+    size_t jstep = g.counts.x + 1;
+    size_t kstep = jstep * (g.counts.y + 1);
+
+    float *s000 = gridsamples[i] + ix + iy*jstep + iz*kstep;
+    float *s010 = s000 + jstep;
+    float *s001 = s000 + kstep;
+    float *s011 = s001 + jstep;
+
+    float t00 = s000[0] + dx * (s000[1] - s000[0]);
+    float t10 = s010[0] + dx * (s010[1] - s010[0]);
+    float t01 = s001[0] + dx * (s001[1] - s001[0]);
+    float t11 = s011[0] + dx * (s011[1] - s011[0]);
+
+    float t0 = t00 + dy * (t10 - t00);
+    float t1 = t01 + dy * (t11 - t01);
+
+    result[0] = t0 + dz * (t1 - t0);
+    return true;
+}
+
+int
+AmrVolume::Sample(int n, vec3f* p, float* values, unsigned char* valid)
+{
+    int k = 0;
+    for (int i = 0; i < n; i++)
+    {
+        bool in = Sample(p[i], values + i);
+        if (in) k++;
+        else values[i] = 0;
+        if (valid) valid[i] = in ? 1 : 0;
+    }
+    return k;
+}
+
+int
+AmrVolume::PointOwner(vec3f& p)
+{
+    if (partitions.empty() || ! global_box.isIn(p))
+        return -1;
+
+    float *pp = (float *)&p;
+
+    int node = 0;
+    while (partitions[node].axis >= 0)
+    {
+        partnode& n = partitions[node];
+        node = n.child[pp[n.axis] < n.plane ? 0 : 1];
+    }
+
+    return partitions[node].child[0];
+}
+
+OsprayObjectP 
+AmrVolume::CreateTheOSPRayEquivalent(KeyedDataObjectP kdop)
+{
+  if (! ospData || hasBeenModified())
+  {
+    ospData = OsprayObject::Cast(OsprayAmrVolume::NewP(AmrVolume::Cast(kdop)));
+    setModified(false);
+  }
+
+  return ospData;
+}
+
 int
 AmrVolume::get_grid_index(int level, int grid)
 {
@@ -316,10 +608,7 @@ AmrVolume::get_grid_index(int level, int grid)
 void
 AmrVolume::get_counts(int level, int grid, int& cx,int& cy,int& cz)
 {
-    int index;
-    vec3i counts;
-    index = get_grid_index(level,grid);
-    counts = gridcounts[index];
+    vec3i counts = get_counts(level,grid);
     cx = counts.x;
     cy = counts.y;
     cz = counts.z;
@@ -327,24 +616,17 @@ AmrVolume::get_counts(int level, int grid, int& cx,int& cy,int& cz)
 vec3i
 AmrVolume::get_counts(int level, int grid)
 {
-    int index;
-    index = get_grid_index(level,grid);
-    return gridcounts[index];
+    return grids[get_grid_index(level,grid)].counts;
 }
 vec3f
 AmrVolume::get_origin(int level, int grid)
 {
-    int index;
-    index = get_grid_index(level,grid);
-    return gridorigin[index];
+    return grids[get_grid_index(level,grid)].origin;
 }
 void
 AmrVolume::get_origin(int level,int grid,float& x, float& y, float& z)
 {
-   int index;
-   vec3f sc;
-   index = get_grid_index(level,grid);
-   sc = gridorigin[index];
+   vec3f sc = get_origin(level,grid);
    x = sc.x;
    y = sc.y;
    z = sc.z;
@@ -352,65 +634,106 @@ AmrVolume::get_origin(int level,int grid,float& x, float& y, float& z)
 void
 AmrVolume::set_counts(int level, int grid, vec3i& counts) 
 {
-    int index;
-    index = get_grid_index(level,grid);
-    gridcounts[index] = counts;
+    grids[get_grid_index(level,grid)].counts = counts;
 }
 void
 AmrVolume::set_deltas(int level, int grid, vec3f& deltas)
 {
-    int index;
-    index = get_grid_index(level,grid);
-    gridspacing[index] = deltas;
+    grids[get_grid_index(level,grid)].spacing = deltas;
 }
 void 
 AmrVolume::get_deltas(int level, int grid, float& sx, float& sy, float& sz)
 {
-    int index;
-    vec3f spacing;
-    index = get_grid_index(level,grid);
-    spacing = gridspacing[index];
+    vec3f spacing = grids[get_grid_index(level,grid)].spacing;
     sx = spacing.x;
     sy = spacing.y;
     sz = spacing.z;
 }
-void
+bool
 AmrVolume::ReadEnzoHierarchy()
 {
+    if (GetTheApplication()->GetRank() == 0)
+        std::cerr << "ERROR: AmrVolume: Enzo hierarchies are not supported: " << filename << std::endl;
+    return false;
 }
 float*
 AmrVolume::getScalarData(int level, int grid)
 {
-    int index;
-    index = get_grid_index(level,grid);
-    return gridsamples[index];
+    int index = get_grid_index(level,grid);
+    for (size_t i = 0; i < localgrids.size(); i++)
+        if (localgrids[i] == index)
+            return gridsamples[i];
+    return NULL;
 }
-void
+bool
 AmrVolume::ReadGxyAmrHeader()
 {
     std::ifstream in;
     in.open(filename.c_str());
     if (in.fail())
     {
-        cerr<< "ERROR: unable to open volfile: " << filename << endl;
-        exit(1);
+        if (GetTheApplication()->GetRank() == 0)
+            std::cerr << "ERROR: unable to open volfile: " << filename << std::endl;
+        return false;
     }
+
+    // grid file names are relative to the directory of the header
+
+    std::string dir((filename.find_last_of("/") == std::string::npos) ? "" : 
+            filename.substr(0,filename.find_last_of("/")+1));
+
     in >> numlevels; // get the number of levels
     int grids;
     std::string gfn;
     numgrids = 0;
+    levelnumgrids.clear();
+    gridfilenames.clear();
     for(int l = 0; l < numlevels; l++) // get the number of grids in each level
     {
         in >> grids;
         levelnumgrids.push_back(grids);   
-        //in >> levelnumgrids[l];
         numgrids += levelnumgrids[l];
     }
     for(int i = 0; i<numgrids; i++)
     {
         in >> gfn;
-        gridfilenames.push_back(gfn);
+        gridfilenames.push_back(gfn[0] == '/' ? gfn : dir + gfn);
+    }
+
+    if (in.fail() || numlevels < 1 || levelnumgrids[0] < 1)
+    {
+        if (GetTheApplication()->GetRank() == 0)
+            std::cerr << "ERROR: malformed amrvol file: " << filename << std::endl;
+        return false;
     }
+
+    return true;
+}
+bool
+AmrVolume::ReadGridMetadata()
+{
+    grids.resize(numgrids);
+
+    int index = 0;
+    for (int l = 0; l < numlevels; l++)
+        for (int g = 0; g < levelnumgrids[l]; g++, index++)
+        {
+            amrgrid& grid = grids[index];
+            vec3i dims;
+            if (! read_vtk_extent(gridfilenames[index], grid.origin, grid.spacing, dims))
+            {
+                std::cerr << "ERROR: AmrVolume: unable to read grid header " << gridfilenames[index] << std::endl;
+                return false;
+            }
+
+            grid.level = l;
+            grid.counts = vec3i(dims.x - 1, dims.y - 1, dims.z - 1);
+            grid.box = Box(grid.origin, grid.origin + vec3f(grid.counts.x*grid.spacing.x,
+                                                            grid.counts.y*grid.spacing.y,
+                                                            grid.counts.z*grid.spacing.z));
+        }
+
+    return true;
 }
 
 } // namespace gxy
@@ -47,21 +47,104 @@ public:
         virtual void initialize(); //!< initialize this AMR Volume
         virtual ~AmrVolume(); //!< default destructor
 
-        //! commit this object to the local registry
-        /*! This action is performed in response to a ImportMsg */
+        using Volume::Import;
+
+        //! read the extents of the grids of the hierarchy and broadcast an ImportMsg carrying them
+        /*! Called on the master process, which reads the header of every grid so
+         *  that the other processes need not, and local_import needs no collectives. */
+        virtual bool Import(std::string fname, void *args, int argsSize);
+
+        //! import the AMR hierarchy into local memory
+        /*! This action is performed in response to a ImportMsg.   The hierarchy
+         *  is partitioned by recursive bisection of the level-0 domain, balancing
+         *  the number of cells of all levels in each part, and each process reads
+         *  only the grids that overlap its part. */
         virtual bool local_import(char *fname, MPI_Comm c);
 
-        //! method to read gxyamr data
-        /*! an internal method used to load gxyamr metadata */
+        //! complete the global range of the distributed AMR volume
+        virtual bool local_commit(MPI_Comm c);
+
+        using Volume::Sample;
+        using Volume::get_deltas;
+
+        //! Interpolate the finest grid containing an arbitrary point; true if in the local partition
+        virtual bool Sample(vec3f& p, float* i);
+
+        //! Interpolate a batch of `n` points at once
+        virtual int Sample(int n, vec3f* p, float* values, unsigned char* valid = NULL);
+
+        //! Which process owns an arbitrary point in this global volume? -1 for outside
+        virtual int PointOwner(vec3f& p);
+
+        //! rays leaving the local partition are sent to the owner of the point they exit to
+        virtual bool routes_by_owner() { return true; }
+
+        //! get the number of grids held at this process
+        int get_number_of_local_grids() { return localgrids.size(); }
+        //! get the level of the `i^th` local grid
+        int get_local_grid_level(int i) { return grids[localgrids[i]].level; }
+        //! get the origin, spacing and number of points per axis of the `i^th` local grid
+        void get_local_grid(int i, vec3f& origin, vec3f& spacing, vec3i& counts)
+        {
+            amrgrid& g = grids[localgrids[i]];
+            origin = g.origin;
+            spacing = g.spacing;
+            counts = vec3i(g.counts.x + 1, g.counts.y + 1, g.counts.z + 1);
+        }
+        //! get the samples of the `i^th` local grid
+        float *get_local_grid_samples(int i) { return gridsamples[i]; }
+
+        virtual OsprayObjectP CreateTheOSPRayEquivalent(KeyedDataObjectP);
 
 private:
         enum amrtype {GXYAMR,ENZOAMR,NOEXT};
+
+        //! metadata of one grid of the hierarchy
+        struct amrgrid
+        {
+            int level;
+            vec3f origin;
+            vec3f spacing;
+            vec3i counts;       // cells per axis
+            Box box;
+        };
+
+        //! a node of the k-d tree of process partitions.   Leaves have axis -1.
+        struct partnode
+        {
+            int axis;
+            float plane;
+            int child[2];       // node indices, or the owning rank at a leaf
+        };
+
+        //! a node of the box tree over the local grids.   Leaves have count > 0.
+        struct gridnode
+        {
+            Box box;
+            int first, count;   // range of gridorder at a leaf
+            int child[2];
+        };
+
+        //! read the header of `filename`, by its extension
+        bool ReadHeader();
         //! method to read gxyamr data
         /*! an internal method used to load gxyamr metadata */
-        void ReadGxyAmrHeader();
+        bool ReadGxyAmrHeader();
         //! method to read Enzo data
         /*! an internal method used to load Enzo Hierarchy metadata */
-        void ReadEnzoHierarchy();
+        bool ReadEnzoHierarchy();
+        //! read the extent of every grid named in gridfilenames into grids
+        bool ReadGridMetadata();
+        //! split `region` among `n` processes starting at `rank0`, returning the k-d node index
+        /*! `subset` holds the grids that overlap `region`; `regions` receives the part of each process */
+        int bisect(Box region, std::vector<int>& subset, int rank0, int n, vec3f& h0, std::vector<Box>& regions);
+        //! number of cells of the grids in `subset` that lie within `region`
+        double cost(Box& region, std::vector<int>& subset);
+        //! build the box tree over gridorder[first..first+count)
+        int build_tree(int first, int count);
+        //! index into localgrids of the finest local grid containing p, or -1
+        int find_grid(vec3f& p);
+
         int get_grid_index(int level, int grid);
         float *getScalarData(int level, int grid);
         void get_counts(int level,int grid, int& cx,int& cy,int& cz);
@@ -72,17 +155,18 @@ private:
         void set_counts(int level, int grid, vec3i& counts);
         void set_deltas(int level, int grid, vec3f& deltas);
 
-
-
 protected:
         int numlevels;
         int numgrids;
         std::vector<int> levelnumgrids;
         std::vector<std::string> gridfilenames;
         float samplingRate;
-        std::vector<vec3f> gridorigin;
-        std::vector<vec3f> gridspacing;
-        std::vector<vec3i> gridcounts;
-        std::vector<float*> gridsamples;
+        std::vector<amrgrid> grids;         // every grid of the hierarchy
+        std::vector<partnode> partitions;   // k-d tree of process partitions, root at 0
+        std::vector<int> localgrids;        // indices into grids of the grids read here
+        std::vector<float*> gridsamples;    // samples of each local grid, into localsamples
+        std::vector<float> localsamples;
+        std::vector<gridnode> gridtree;     // box tree over the local grids, root at 0
+        std::vector<int> gridorder;         // indices into localgrids, ordered by the tree
 };
 } // namespace gxy
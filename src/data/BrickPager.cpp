@@ -0,0 +1,212 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "BrickPager.h"
+
+namespace gxy
+{
+
+static size_t
+page_size()
+{
+  static size_t ps = sysconf(_SC_PAGESIZE);
+  return ps;
+}
+
+BrickPager *
+BrickPager::MapFile(std::string fname, size_t offset, size_t size, size_t brick_size, size_t budget)
+{
+  int fd = open(fname.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    std::cerr << "ERROR: BrickPager: unable to open " << fname << ": " << strerror(errno) << std::endl;
+    return NULL;
+  }
+
+  // Pages past the end of the file would fault on first access rather than
+  // reading short, so a file that is too small is an error here
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || size_t(info.st_size) < offset + size)
+  {
+    std::cerr << "ERROR: BrickPager: " << fname << " is too small: need " << (offset + size) << " bytes" << std::endl;
+    close(fd);
+    return NULL;
+  }
+
+  // mmap offsets must be page-aligned
+
+  size_t skip = offset % page_size();
+  size_t map_size = size + skip;
+
+  void *map = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, offset - skip);
+  if (map == MAP_FAILED)
+  {
+    std::cerr << "ERROR: BrickPager: unable to map " << fname << ": " << strerror(errno) << std::endl;
+    close(fd);
+    return NULL;
+  }
+
+  BrickPager *pager = new BrickPager(fd, (unsigned char *)map, map_size, skip, brick_size, budget);
+  pager->map_offset = offset - skip;
+  pager->filled = size;
+  return pager;
+}
+
+BrickPager *
+BrickPager::MapScratch(std::string dir, size_t size, size_t brick_size, size_t budget)
+{
+  std::string tmpl = dir + "/gxy-bricks-XXXXXX";
+  std::vector<char> name(tmpl.begin(), tmpl.end());
+  name.push_back(0);
+
+  int fd = mkstemp(name.data());
+  if (fd < 0)
+  {
+    std::cerr << "ERROR: BrickPager: unable to create scratch file in " << dir << ": " << strerror(errno) << std::endl;
+    return NULL;
+  }
+
+  unlink(name.data());
+
+  if (ftruncate(fd, size) != 0)
+  {
+    std::cerr << "ERROR: BrickPager: unable to size scratch file in " << dir << ": " << strerror(errno) << std::endl;
+    close(fd);
+    return NULL;
+  }
+
+  void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED)
+  {
+    std::cerr << "ERROR: BrickPager: unable to map scratch file: " << strerror(errno) << std::endl;
+    close(fd);
+    return NULL;
+  }
+
+  BrickPager *pager = new BrickPager(fd, (unsigned char *)map, size, 0, brick_size, budget);
+  pager->map_offset = 0;
+  pager->filled = 0;
+  return pager;
+}
+
+BrickPager::BrickPager(int f, unsigned char *m, size_t ms, size_t skip, size_t bs, size_t b)
+  : fd(f), map(m), map_size(ms), base(m + skip)
+{
+  brick_size = std::max(page_size(), ((bs + page_size() - 1) / page_size()) * page_size());
+  budget = std::max((size_t)1, b / brick_size);
+
+  int nbricks = (map_size + brick_size - 1) / brick_size;
+  where.resize(nbricks);
+  listed.resize(nbricks, false);
+
+  pthread_mutex_init(&lock, NULL);
+}
+
+BrickPager::~BrickPager()
+{
+  munmap(map, map_size);
+  close(fd);
+  pthread_mutex_destroy(&lock);
+}
+
+void
+BrickPager::Filled(size_t end)
+{
+  // write back and drop whole pages only, so a partly filled page stays mapped
+
+  size_t from = ((base - map) + filled) / page_size() * page_size();
+  size_t to = ((base - map) + end) / page_size() * page_size();
+
+  if (to > from)
+  {
+    msync(map + from, to - from, MS_SYNC);
+    madvise(map + from, to - from, MADV_DONTNEED);
+    posix_fadvise(fd, map_offset + from, to - from, POSIX_FADV_DONTNEED);
+  }
+
+  filled = end;
+}
+
+void
+BrickPager::evict(int b)
+{
+  size_t start = b * brick_size;
+  size_t len = std::min(brick_size, map_size - start);
+
+  madvise(map + start, len, MADV_DONTNEED);
+  posix_fadvise(fd, map_offset + start, len, POSIX_FADV_DONTNEED);
+}
+
+void
+BrickPager::Prefetch(size_t begin, size_t end)
+{
+  if (end <= begin)
+    return;
+
+  int b0 = ((base - map) + begin) / brick_size;
+  int b1 = ((base - map) + end - 1) / brick_size;
+  if (b1 >= (int)where.size()) b1 = where.size() - 1;
+
+  // No more than the budget is read ahead; the rest of a larger request is
+  // faulted in as it is touched
+
+  if ((size_t)(b1 - b0 + 1) > budget) b1 = b0 + budget - 1;
+
+  pthread_mutex_lock(&lock);
+
+  for (int b = b0; b <= b1; b++)
+  {
+    if (listed[b])
+      lru.erase(where[b]);
+    else
+    {
+      size_t start = b * brick_size;
+      madvise(map + start, std::min(brick_size, map_size - start), MADV_WILLNEED);
+      listed[b] = true;
+    }
+
+    lru.push_front(b);
+    where[b] = lru.begin();
+  }
+
+  while (lru.size() > budget)
+  {
+    int b = lru.back();
+    lru.pop_back();
+    listed[b] = false;
+    evict(b);
+  }
+
+  pthread_mutex_unlock(&lock);
+}
+
+} // namespace gxy
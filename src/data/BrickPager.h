@@ -0,0 +1,95 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#pragma once
+
+/*! \file BrickPager.h 
+ * \brief a file-backed sample array paged in bricks under a memory budget
+ * \ingroup data
+ */
+
+#include <cstddef>
+#include <list>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+namespace gxy
+{
+
+//! a file-backed sample array paged in bricks under a memory budget
+/*! \ingroup data
+ * The array is a shared mapping of a file, so any part of it can be read at any 
+ * time; pages not resident are faulted in by the kernel.   The pager divides the 
+ * mapping into bricks of contiguous bytes and keeps a least-recently-used list of 
+ * the bricks that have been asked for.   Prefetch asks the kernel to read bricks 
+ * ahead of use and, when the bricks in the list exceed the budget, drops the least
+ * recently requested from both the mapping and the page cache.   The budget bounds
+ * what the pager reads ahead and keeps, not what is resident: pages of bricks that
+ * are read without being asked for, as when one request spans more than the budget,
+ * are faulted in by the kernel and left to it to reclaim.
+ */
+class BrickPager
+{
+public:
+  //! map `size` bytes of the file `fname`, starting at `offset`, read-only
+  /*! \returns NULL if the file cannot be mapped */
+  static BrickPager *MapFile(std::string fname, size_t offset, size_t size, size_t brick_size, size_t budget);
+
+  //! map a scratch file of `size` bytes in the directory `dir`, to be filled by the caller
+  /*! The file is unlinked as soon as it is created.
+   * \returns NULL if the file cannot be created
+   */
+  static BrickPager *MapScratch(std::string dir, size_t size, size_t brick_size, size_t budget);
+
+  ~BrickPager(); //!< unmap the array
+
+  //! get the address of the first byte of the array
+  unsigned char *data() { return base; }
+
+  //! the array is filled up to byte `end`: write back and drop the pages before it
+  void Filled(size_t end);
+
+  //! the bytes [begin, end) of the array will be read soon
+  void Prefetch(size_t begin, size_t end);
+
+private:
+  BrickPager(int fd, unsigned char *map, size_t map_size, size_t skip, size_t brick_size, size_t budget);
+
+  //! drop the given brick from the mapping and the page cache
+  void evict(int b);
+
+  int fd;
+  unsigned char *map;     // page-aligned start of the mapping
+  size_t map_size;
+  unsigned char *base;    // first byte of the array within the mapping
+  size_t map_offset;      // file offset of the mapping
+  size_t brick_size;      // a multiple of the page size
+  size_t budget;          // in bricks
+  size_t filled;
+
+  std::list<int> lru;     // requested bricks, most recent first
+  std::vector<std::list<int>::iterator> where;
+  std::vector<bool> listed;
+
+  pthread_mutex_t lock;
+};
+
+} // namespace gxy
@@ -144,14 +144,28 @@ Datasets::LoadFromJSON(Value& v)
 
 	Value& ds = v["Datasets"];
 
+  // The imports are issued together and performed concurrently at
+  // each process; a dataset that fails to load still lets the ones
+  // recorded before it complete
+
+  KeyedDataObject::BeginImports();
+
+  bool ok = true;
 	if (ds.IsArray())
 	{
-		for (int i = 0; i < ds.Size(); i++)
-			if (! loadTyped(ds[i])) return false;
-    return true;
+		for (int i = 0; ok && i < ds.Size(); i++)
+			ok = loadTyped(ds[i]);
 	}
 	else
-		return loadTyped(ds);
+		ok = loadTyped(ds);
+
+  if (! KeyedDataObject::EndImports())
+  {
+    set_error(1);
+    ok = false;
+  }
+
+  return ok;
 }
 
 bool
@@ -71,9 +71,29 @@ Geometry::initialize()
   pthread_mutex_init(&lock, NULL);
 }
 
+void
+Geometry::unmap()
+{
+  if (mapped)
+  {
+    int nv = mapped->GetNumberOfVertices();
+    int nc = mapped->GetConnectivitySize();
+
+    vertices.assign(mapped->GetVertices(), mapped->GetVertices() + nv);
+    data.assign(mapped->GetData(), mapped->GetData() + nv);
+    if (nc)
+      connectivity.assign(mapped->GetConnectivity(), mapped->GetConnectivity() + nc);
+    else
+      connectivity.clear();
+
+    mapped = nullptr;
+  }
+}
+
 void
 Geometry::allocate_vertices(int nv)
 {
+  unmap();
   vertices.resize(nv);
   data.resize(nv);
 }
@@ -81,6 +101,7 @@ Geometry::allocate_vertices(int nv)
 void
 Geometry::allocate_connectivity(int nc)
 {
+  unmap();
   connectivity.resize(nc);
 }
 
@@ -142,28 +163,17 @@ Geometry::Import(string s)
 bool
 Geometry::local_commit(MPI_Comm c)
 {
-  if (super::local_commit(c))
-    return true;
+  // Geometry is filled in place through its accessors, so can't tell
+  // whether its data changed; assume it did
 
-  if (data.size() == 0)
-    local_min = local_max = 0;
-  else
-  {
-    float *dptr = data.data();
-    local_min = local_max = *dptr ++;
+  SetDirty(DIRTY_DATA);
 
-    for (auto i = 1; i < data.size(); i++)
-    {
-      float d = *dptr++;
-      if (local_min > d) local_min = d;
-      if (local_max < d) local_max = d;
-    }
-  }
+  if (super::local_commit(c))
+    return true;
 
-  MPI_Allreduce(&local_min, &global_min, 1, MPI_FLOAT, MPI_MIN, c);
-  MPI_Allreduce(&local_max, &global_max, 1, MPI_FLOAT, MPI_MAX, c);
+  commit_range(GetData(), GetNumberOfVertices(), 1, c);
 
-  int local_counts[2] = {(int)vertices.size(), (int)connectivity.size()};
+  int local_counts[2] = {GetNumberOfVertices(), GetConnectivitySize()};
   int global_counts[2];
 
   MPI_Allreduce(local_counts, global_counts, 2, MPI_INT, MPI_SUM, c);
@@ -203,6 +213,19 @@ Geometry::local_import(char *p, MPI_Comm c)
     if (fname.c_str()[0] != '/')
       fname = dir + fname;
 
+    // Galaxy geometry files are mapped and used in place rather than parsed
+
+    if (GeometryFile::IsGeometryFile(fname))
+    {
+      shared_ptr<GeometryFile> f = GeometryFile::Map(fname);
+      if (! f || ! load_from_geometry_file(f))
+      {
+        set_error(1);
+        return false;
+      }
+      return true;
+    }
+
     vtkNew<VTKError> e;
     vtkNew<vtkXMLUnstructuredGridReader> rdr;
     e->watch(rdr);
@@ -371,6 +394,9 @@ Geometry::LoadFromJSON(Value& v)
     default_color.w = 1.0;
   }
 
+  if (v.HasMember("histogram"))
+    set_histogram_bins(v["histogram"].GetInt());
+
   if (v.HasMember("filename"))
   {
     return Import(v["filename"].GetString());
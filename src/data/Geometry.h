@@ -33,6 +33,7 @@
 
 #include <vtkPointSet.h>
 
+#include "GeometryFile.h"
 #include "KeyedDataObject.h"
 
 namespace gxy
@@ -86,15 +87,16 @@ class Geometry : public KeyedDataObject
     a = default_color.w;
   }
 
-  int GetNumberOfVertices() { return vertices.size(); }
-  int GetConnectivitySize() { return connectivity.size(); }
+  int GetNumberOfVertices() { return mapped ? mapped->GetNumberOfVertices() : vertices.size(); }
+  int GetConnectivitySize() { return mapped ? mapped->GetConnectivitySize() : connectivity.size(); }
 
-  vec3f* GetVertices() { return (vec3f *)vertices.data(); }
-  float* GetData() { return (float *)data.data(); }
-  int*   GetConnectivity() { return (int *)connectivity.data(); }
+  vec3f* GetVertices() { return mapped ? mapped->GetVertices() : (vec3f *)vertices.data(); }
+  float* GetData() { return mapped ? mapped->GetData() : (float *)data.data(); }
+  int*   GetConnectivity() { return mapped ? mapped->GetConnectivity() : (int *)connectivity.data(); }
 
   void clear()
   {
+    mapped = nullptr;
     vertices.clear();
     data.clear();
     connectivity.clear();
@@ -118,6 +120,25 @@ protected:
 
   virtual bool load_from_vtkPointSet(vtkPointSet *) { return false; }
 
+  //! use the arrays of a mapped Galaxy geometry file in place
+  /*! Subclasses check that the file holds their kind of geometry and call adopt()
+   */
+  virtual bool load_from_geometry_file(std::shared_ptr<GeometryFile>) { return false; }
+
+  //! use the arrays of a mapped Galaxy geometry file in place of the local arrays
+  void adopt(std::shared_ptr<GeometryFile> f)
+  {
+    vertices.clear();
+    data.clear();
+    connectivity.clear();
+    mapped = f;
+  }
+
+  //! copy the arrays of a mapped geometry file into the local arrays and release it
+  /*! Done before the arrays are resized or appended to
+   */
+  virtual void unmap();
+
   void initialize(); //!< initialize this Geometry objec
 
   //! Get partitioning info from JSON object
@@ -131,6 +152,9 @@ protected:
   std::vector<float> data;
   std::vector<int>   connectivity;
 
+  //! if set, the mapped geometry file whose arrays are used in place of the above
+  std::shared_ptr<GeometryFile> mapped;
+
   int global_vertex_count;
   int global_element_count;
 
@@ -0,0 +1,184 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#include <iostream>
+#include <climits>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "GeometryFile.h"
+
+using namespace std;
+
+namespace gxy
+{
+
+GeometryFile::~GeometryFile()
+{
+  munmap(base, size);
+}
+
+bool
+GeometryFile::IsGeometryFile(string filename)
+{
+  return filename.size() > 5 && filename.substr(filename.size() - 5) == ".gxyg";
+}
+
+// Does the array of n elements of sz bytes at offset o lie within the file?
+
+static bool
+in_file(int64_t o, int64_t n, size_t sz, size_t size)
+{
+  return o >= (int64_t)sizeof(GeometryFileHeader) && n >= 0 && (size_t)o + n*sz <= size;
+}
+
+shared_ptr<GeometryFile>
+GeometryFile::Map(string filename)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    cerr << "ERROR: unable to open geometry file " << filename << "\n";
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(GeometryFileHeader))
+  {
+    cerr << "ERROR: " << filename << " is too short to be a geometry file\n";
+    close(fd);
+    return NULL;
+  }
+
+  size_t size = st.st_size;
+
+  // Private and writable, so Galaxy can modify the arrays in place without
+  // touching the file; pages are only copied if they are written
+
+  void *b = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (b == MAP_FAILED)
+  {
+    cerr << "ERROR: unable to map geometry file " << filename << "\n";
+    return NULL;
+  }
+
+  GeometryFileHeader *h = (GeometryFileHeader *)b;
+
+  const char *problem = NULL;
+  if (h->magic != GXY_GEOMETRY_FILE_MAGIC)
+    problem = "is not a Galaxy geometry file";
+  else if (h->version != GXY_GEOMETRY_FILE_VERSION)
+    problem = "is an unsupported version";
+  else if (h->type < TRIANGLES || h->type > PATHLINES)
+    problem = "has an unknown geometry type";
+  else if (h->nvertices > INT_MAX || h->nconnectivity > INT_MAX)
+    problem = "is too large";
+  else if (! in_file(h->vertices, h->nvertices, sizeof(vec3f), size) ||
+           ! in_file(h->data, h->nvertices, sizeof(float), size) ||
+           (h->normals && ! in_file(h->normals, h->nvertices, sizeof(vec3f), size)) ||
+           (h->connectivity && ! in_file(h->connectivity, h->nconnectivity, sizeof(int), size)) ||
+           (! h->connectivity && h->nconnectivity))
+    problem = "is truncated or corrupt";
+
+  if (problem)
+  {
+    cerr << "ERROR: " << filename << " " << problem << "\n";
+    munmap(b, size);
+    return NULL;
+  }
+
+  return shared_ptr<GeometryFile>(new GeometryFile((unsigned char *)b, size));
+}
+
+static int64_t
+aligned(int64_t o)
+{
+  return (o + GXY_GEOMETRY_FILE_ALIGNMENT - 1) & ~(int64_t)(GXY_GEOMETRY_FILE_ALIGNMENT - 1);
+}
+
+// Write n bytes of p at offset o, padding from the current offset cur
+
+static bool
+write_at(FILE *fp, int64_t& cur, int64_t o, const void *p, size_t n)
+{
+  static const char zeros[GXY_GEOMETRY_FILE_ALIGNMENT] = {0};
+  if (o > cur && fwrite(zeros, 1, o - cur, fp) != (size_t)(o - cur))
+    return false;
+  cur = o + n;
+  return n == 0 || fwrite(p, 1, n, fp) == n;
+}
+
+bool
+GeometryFile::Write(string filename, Type type, 
+                    int64_t nvertices, const vec3f *vertices, const vec3f *normals, const float *data,
+                    int64_t nconnectivity, const int *connectivity)
+{
+  GeometryFileHeader h;
+  memset(&h, 0, sizeof(h));
+
+  h.magic = GXY_GEOMETRY_FILE_MAGIC;
+  h.version = GXY_GEOMETRY_FILE_VERSION;
+  h.type = type;
+  h.nvertices = nvertices;
+  h.nconnectivity = connectivity ? nconnectivity : 0;
+
+  int64_t o = aligned(sizeof(h));
+  h.vertices = o;
+  o = aligned(o + nvertices*sizeof(vec3f));
+  if (normals)
+  {
+    h.normals = o;
+    o = aligned(o + nvertices*sizeof(vec3f));
+  }
+  h.data = o;
+  o = aligned(o + nvertices*sizeof(float));
+  if (connectivity)
+    h.connectivity = o;
+
+  FILE *fp = fopen(filename.c_str(), "wb");
+  if (! fp)
+  {
+    cerr << "ERROR: unable to create geometry file " << filename << "\n";
+    return false;
+  }
+
+  int64_t cur = 0;
+  bool ok = write_at(fp, cur, 0, &h, sizeof(h)) &&
+            write_at(fp, cur, h.vertices, vertices, nvertices*sizeof(vec3f)) &&
+            (! normals || write_at(fp, cur, h.normals, normals, nvertices*sizeof(vec3f))) &&
+            write_at(fp, cur, h.data, data, nvertices*sizeof(float)) &&
+            (! connectivity || write_at(fp, cur, h.connectivity, connectivity, h.nconnectivity*sizeof(int)));
+
+  if (fclose(fp) != 0)
+    ok = false;
+
+  if (! ok)
+    cerr << "ERROR: unable to write geometry file " << filename << "\n";
+
+  return ok;
+}
+
+} // namespace gxy
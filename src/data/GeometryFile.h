@@ -0,0 +1,111 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#pragma once
+
+/*! \file GeometryFile.h 
+ * \brief a Galaxy-native binary container for one partition of a Geometry, loaded by mmap
+ * \ingroup data
+ */
+
+#include <memory>
+#include <string>
+#include <stdint.h>
+
+#include "dtypes.h"
+
+namespace gxy
+{
+
+#define GXY_GEOMETRY_FILE_MAGIC     0x47595847    // "GXYG"
+#define GXY_GEOMETRY_FILE_VERSION   1
+#define GXY_GEOMETRY_FILE_ALIGNMENT 64
+
+//! the header at the start of a Galaxy geometry file
+/*! The header is followed by the arrays it locates, each aligned to
+ * GXY_GEOMETRY_FILE_ALIGNMENT bytes: vertices (3 floats each), normals (3
+ * floats each, optional), data (1 float each) and connectivity (ints).   Values 
+ * are in the byte order of the machine that wrote the file.
+ * \ingroup data
+ */
+struct GeometryFileHeader
+{
+  int32_t magic;            //!< GXY_GEOMETRY_FILE_MAGIC
+  int32_t version;          //!< GXY_GEOMETRY_FILE_VERSION
+  int32_t type;             //!< a GeometryFile::Type
+  int32_t pad;
+  int64_t nvertices;        //!< number of vertices (and normals and data values)
+  int64_t nconnectivity;    //!< number of connectivity indices
+  int64_t vertices;         //!< byte offset of the vertex array
+  int64_t normals;          //!< byte offset of the normal array, 0 if none
+  int64_t data;             //!< byte offset of the data array
+  int64_t connectivity;     //!< byte offset of the connectivity array, 0 if none
+};
+
+//! a Galaxy-native binary container for one partition of a Geometry, loaded by mmap
+/*! Loading a GeometryFile maps it into memory rather than parsing it, and the 
+ * Geometry it is loaded into uses its arrays in place, sharing them with 
+ * OSPRay.   The mapping is private: writes to the arrays are not carried back to 
+ * the file.   The mapping is released when the last reference to the
+ * GeometryFile goes away.
+ * \ingroup data
+ */
+class GeometryFile
+{
+public:
+  //! the kind of Geometry held in a file, and so how its connectivity is read
+  enum Type
+  {
+    TRIANGLES,  //!< connectivity holds three vertex indices per triangle
+    PARTICLES,  //!< no connectivity
+    PATHLINES   //!< connectivity holds the first vertex index of each line segment
+  };
+
+  ~GeometryFile();
+
+  //! map the named file, returning NULL (after reporting why) if it cannot be
+  static std::shared_ptr<GeometryFile> Map(std::string filename);
+
+  //! write a Galaxy geometry file; normals and connectivity may be NULL
+  static bool Write(std::string filename, Type type, 
+                    int64_t nvertices, const vec3f *vertices, const vec3f *normals, const float *data,
+                    int64_t nconnectivity, const int *connectivity);
+
+  //! does the file name have the extension of a Galaxy geometry file (.gxyg)?
+  static bool IsGeometryFile(std::string filename);
+
+  Type  GetType() { return (Type)header->type; }
+  int   GetNumberOfVertices() { return header->nvertices; }
+  int   GetConnectivitySize() { return header->nconnectivity; }
+
+  vec3f *GetVertices() { return (vec3f *)(base + header->vertices); }
+  vec3f *GetNormals() { return header->normals ? (vec3f *)(base + header->normals) : NULL; }
+  float *GetData() { return (float *)(base + header->data); }
+  int   *GetConnectivity() { return header->connectivity ? (int *)(base + header->connectivity) : NULL; }
+
+private:
+  GeometryFile(unsigned char *b, size_t s) : base(b), size(s), header((GeometryFileHeader *)b) {}
+
+  unsigned char *base;
+  size_t size;
+  GeometryFileHeader *header;
+};
+
+} // namespace gxy
@@ -18,12 +18,19 @@
 //                                                                            //
 // ========================================================================== //
 
+#include <atomic>
+#include <cfloat>
+#include <functional>
+#include <future>
+
 #include "Application.h"
 #include "KeyedDataObject.h"
 #include "Datasets.h"
 #include "Geometry.h"
 #include "Volume.h"
 #include "AmrVolume.h"
+#include "RangeScan.h"
+#include "Threading.h"
 
 using namespace std;
 
@@ -31,6 +38,7 @@ namespace gxy
 {
 
 WORK_CLASS_TYPE(KeyedDataObject::ImportMsg);
+WORK_CLASS_TYPE(KeyedDataObject::ImportBatchMsg);
 
 void
 KeyedDataObject::Register()
@@ -38,6 +46,7 @@ KeyedDataObject::Register()
   RegisterClass();
 
   ImportMsg::Register();
+  ImportBatchMsg::Register();
 
   Datasets::Register();
   Geometry::Register();
@@ -79,26 +88,320 @@ KeyedDataObject::initialize()
   time_varying = false;
   attached = false;
   skt = NULL;
+  histogram_bins = getenv("GXY_HISTOGRAM_BINS") ? atoi(getenv("GXY_HISTOGRAM_BINS")) : 0;
+  histogram_min = histogram_max = 0;
+}
+
+int
+KeyedDataObject::serialSize()
+{
+  return super::serialSize() + sizeof(int);
+}
+
+unsigned char*
+KeyedDataObject::serialize(unsigned char *ptr)
+{
+  ptr = super::serialize(ptr);
+  *(int *)ptr = histogram_bins;
+  ptr += sizeof(int);
+  return ptr;
 }
 
+unsigned char*
+KeyedDataObject::deserialize(unsigned char *ptr)
+{
+  ptr = super::deserialize(ptr);
+  histogram_bins = *(int *)ptr;
+  ptr += sizeof(int);
+  return ptr;
+}
+
+// The OSPRay equivalent is only rebuilt if the object changed.   The dirty
+// flags are left for the subclass's commit, and cleared by commit_range once
+// the range and histogram are done, so a direct call to a subclass's 
+// local_commit (eg. from the in-situ connector) also clears them
+
 bool
 KeyedDataObject::local_commit(MPI_Comm c)
 {
-  setModified(true);
+  if (IsDirty(DIRTY_ALL))
+    setModified(true);
   return false;
 }
 
+template<typename T>
+void
+KeyedDataObject::commit_range(const T *samples, size_t n, int ncomp, MPI_Comm c)
+{
+  bool mpi = GetTheApplication()->GetTheMessageManager()->UsingMPI();
+
+  // A process with no data contributes an empty range (min > max) to the
+  // reduction, but reports its local range as 0, 0
+
+  float lmin = local_min, lmax = local_max;
+  if (n == 0)
+  {
+    lmin = FLT_MAX;
+    lmax = -FLT_MAX;
+  }
+  else if (IsDirty(DIRTY_DATA))
+    RangeScan::MinMax(samples, n, ncomp, lmin, lmax);
+
+  if (mpi)
+  {
+    float l[2] = {-lmax, lmin}, g[2];
+    MPI_Allreduce(l, g, 2, MPI_FLOAT, MPI_MIN, c);
+    global_max = -g[0];
+    global_min = g[1];
+  }
+  else
+  {
+    global_min = lmin;
+    global_max = lmax;
+  }
+
+  if (global_min > global_max)
+    global_min = global_max = 0;
+
+  if (n == 0)
+    local_min = local_max = 0;
+  else
+  {
+    local_min = lmin;
+    local_max = lmax;
+  }
+
+  if (histogram_bins <= 0)
+  {
+    histogram.clear();
+    local_histogram.clear();
+    dirty = 0;
+    return;
+  }
+
+  // The local histogram is binned over the global range, so it is rebinned
+  // if either the local data or the global range changed
+
+  if (IsDirty(DIRTY_DATA) || (int)local_histogram.size() != histogram_bins ||
+      histogram_min != global_min || histogram_max != global_max)
+  {
+    local_histogram.resize(histogram_bins);
+    RangeScan::Histogram(samples, n, ncomp, global_min, global_max, local_histogram);
+    histogram_min = global_min;
+    histogram_max = global_max;
+  }
+
+  histogram.resize(histogram_bins);
+  if (mpi)
+    MPI_Allreduce(local_histogram.data(), histogram.data(), histogram_bins, MPI_LONG, MPI_SUM, c);
+  else
+    histogram = local_histogram;
+
+  dirty = 0;
+}
+
+template void KeyedDataObject::commit_range(const float *, size_t, int, MPI_Comm);
+template void KeyedDataObject::commit_range(const unsigned char *, size_t, int, MPI_Comm);
+
 bool
 KeyedDataObject::Import(string filename) { return Import(filename, NULL, 0); }
 
+// Imports recorded between BeginImports and EndImports, and the global
+// error count of the last batch.   Master process only.
+
+static vector<pair<Key, string>> *pending_imports = NULL;
+static int import_batch_errors = 0;
+
 bool
 KeyedDataObject::Import(string filename, void *args, int argsSize)
 {
+  if (pending_imports)
+  {
+    string payload(filename.c_str(), filename.length() + 1);
+    if (argsSize)
+      payload.append((const char *)args, argsSize);
+
+    pending_imports->push_back(pair<Key, string>(getkey(), payload));
+    return true;
+  }
+
   ImportMsg msg(getkey(), filename, args, argsSize);
   msg.Broadcast(true, true);
   return get_error() == 0;
 }
 
+void
+KeyedDataObject::BeginImports()
+{
+  if (pending_imports)
+    std::cerr << "WARNING: KeyedDataObject::BeginImports called with a batch already open" << std::endl;
+  else
+    pending_imports = new vector<pair<Key, string>>;
+}
+
+bool
+KeyedDataObject::EndImports()
+{
+  if (! pending_imports)
+    return true;
+
+  vector<pair<Key, string>> imports;
+  imports.swap(*pending_imports);
+  delete pending_imports;
+  pending_imports = NULL;
+
+  if (imports.empty())
+    return true;
+
+  ImportBatchMsg msg(imports);
+  msg.Broadcast(true, true);
+
+  if (import_batch_errors)
+  {
+    std::cerr << "ERROR: " << import_batch_errors << " import(s) failed" << std::endl;
+    return false;
+  }
+
+  for (auto& i : imports)
+  {
+    KeyedDataObjectP o = KeyedDataObject::GetByKey(i.first);
+    if (! o->Commit())
+      return false;
+  }
+
+  return true;
+}
+
+static size_t
+import_batch_size(vector<pair<Key, string>>& imports)
+{
+  size_t sz = sizeof(int);
+  for (auto& i : imports)
+    sz += sizeof(Key) + sizeof(int) + i.second.size();
+  return sz;
+}
+
+KeyedDataObject::ImportBatchMsg::ImportBatchMsg(vector<pair<Key, string>>& imports) : ImportBatchMsg(import_batch_size(imports))
+{
+  unsigned char *p = contents->get();
+
+  *(int *)p = imports.size();
+  p += sizeof(int);
+
+  for (auto& i : imports)
+  {
+    *(Key *)p = i.first;
+    p += sizeof(Key);
+
+    *(int *)p = i.second.size();
+    p += sizeof(int);
+
+    memcpy(p, i.second.data(), i.second.size());
+    p += i.second.size();
+  }
+}
+
+class import_task : public ThreadPoolTask
+{
+public:
+  // The message thread is blocked on the batch, so it goes ahead of rendering tasks
+  import_task(std::function<void()> f) : ThreadPoolTask(4), f(f) {}
+  virtual int work() { f(); return 0; }
+
+private:
+  std::function<void()> f;
+};
+
+bool
+KeyedDataObject::ImportBatchMsg::CollectiveAction(MPI_Comm c, bool isRoot)
+{
+  unsigned char *p = contents->get();
+
+  int n = *(int *)p;
+  p += sizeof(int);
+
+  vector<KeyedDataObjectP> objects;
+  vector<char *> payloads;
+
+  for (int i = 0; i < n; i++)
+  {
+    Key k = *(Key *)p;
+    p += sizeof(Key);
+
+    int sz = *(int *)p;
+    p += sizeof(int);
+
+    KeyedDataObjectP o = KeyedDataObject::GetByKey(k);
+    o->SetDirty(DIRTY_DATA);
+
+    objects.push_back(o);
+    payloads.push_back((char *)p);
+    p += sz;
+  }
+
+  // The reads are throttled so that concurrent imports don't just contend 
+  // for the same file system bandwidth: a fixed number of workers take the
+  // imports in order.  The message thread is one of them.   Each process
+  // reaches the imports in its own order, so imports that make collective
+  // calls are set aside and done after, in batch order.
+
+  vector<int> concurrent, serial;
+  for (int i = 0; i < n; i++)
+    if (objects[i]->import_is_collective())
+      serial.push_back(i);
+    else
+      concurrent.push_back(i);
+
+  int nc = concurrent.size();
+
+  int nworkers = getenv("GXY_IMPORT_CONCURRENCY") ? atoi(getenv("GXY_IMPORT_CONCURRENCY")) : 4;
+
+  ThreadPool *pool = GetTheApplication()->GetTheThreadPool();
+  int nthreads = pool ? pool->GetNumberOfThreads() + 1 : 1;
+
+  if (nworkers > nthreads) nworkers = nthreads;
+  if (nworkers > nc) nworkers = nc;
+  if (nworkers < 1) nworkers = 1;
+
+  std::atomic<int> next(0), local_errors(0);
+
+  auto import = [&](int i) {
+    if (! objects[i]->local_import(payloads[i], c))
+    {
+      objects[i]->set_error(1);
+      local_errors++;
+    }
+  };
+
+  auto worker = [&]() {
+    for (int i = next++; i < nc; i = next++)
+      import(concurrent[i]);
+  };
+
+  vector<std::future<int>> futures;
+  for (int i = 1; i < nworkers; i++)
+    futures.emplace_back(pool->AddTask(new import_task(worker)));
+
+  worker();
+
+  for (auto& f : futures)
+    f.get();
+
+  for (auto i : serial)
+    import(i);
+
+  // The one point at which the processes synchronize
+
+  int errors = local_errors;
+  if (GetTheApplication()->GetTheMessageManager()->UsingMPI())
+    MPI_Allreduce(MPI_IN_PLACE, &errors, 1, MPI_INT, MPI_SUM, c);
+
+  if (isRoot)
+    import_batch_errors = errors;
+
+  return false;
+}
+
 bool
 KeyedDataObject::local_import(char *s, MPI_Comm c)
 {
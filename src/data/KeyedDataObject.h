@@ -27,6 +27,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 #include <pthread.h>
 
 #include <vtkSmartPointer.h>
@@ -56,6 +57,7 @@ class KeyedDataObject : public KeyedObject
 	KEYED_OBJECT_SUBCLASS(KeyedDataObject, KeyedObject)
 
 	friend class ImportMsg;
+	friend class ImportBatchMsg;
 
 public:
 	virtual ~KeyedDataObject(); //!< destructor
@@ -88,6 +90,15 @@ public:
    */
   bool has_neighbor(unsigned int face) { return neighbors[face] >= 0; }
 
+  //! are rays leaving the local partition routed to the owner of the point they exit to, rather than to a face neighbor?
+  /*! True for data that is not partitioned on a regular grid of processes, which may have 
+   * more than one neighbor across a face
+   */
+  virtual bool routes_by_owner() { return false; }
+
+  //! Which process owns an arbitrary point in the global data? -1 for outside or unknown
+  virtual int PointOwner(vec3f& p) { return -1; }
+
   //! is this KeyedDataObject time varying?
 	bool is_time_varying() { return time_varying; }
 
@@ -105,6 +116,22 @@ public:
   //! broadcast an ImportMsg to all Galaxy processes to import the given data file using the given arguments
 	virtual bool Import(std::string, void *args, int argsSize);
 
+  //! defer the ImportMsgs of subsequent calls to Import until EndImports
+  /*! Called on the master process.   While a batch is open, Import records its 
+   * arguments and returns true without reading anything.
+   */
+  static void BeginImports();
+
+  //! broadcast the deferred imports as a single collective message, then commit the imported objects
+  /*! Each process performs its reads concurrently on the thread pool, at most
+   * GXY_IMPORT_CONCURRENCY (default 4) at a time, and the processes then join in a 
+   * single reduction of the error count.   Imports of classes whose 
+   * import_is_collective is true follow, one at a time, in batch order.   Returns false if any import failed 
+   * at any process, in which case the objects that failed there have their error set
+   * and nothing is committed.
+   */
+  static bool EndImports();
+
   //! copy the data partitioning of the given KeyedDataObject
 	void CopyPartitioning(KeyedDataObjectP o);
 
@@ -117,6 +144,14 @@ public:
   void get_global_minmax(float& min, float& max)   { min = global_min; max = global_max; }
   void get_local_minmax(float& min, float& max)   { min = local_min; max = local_max; }
 
+  //! set the number of bins of the global histogram computed at commit; 0 for none
+  void set_histogram_bins(int n) { histogram_bins = n; }
+  //! get the number of bins of the global histogram computed at commit
+  int get_histogram_bins() { return histogram_bins; }
+
+  //! get the global histogram of data values (or magnitudes) over the global range, as of the last commit
+  const std::vector<long>& get_histogram() { return histogram; }
+
   virtual OsprayObjectP CreateTheOSPRayEquivalent(KeyedDataObjectP kdop);
   virtual OsprayObjectP GetTheOSPRayEquivalent() { return ospData; }
 
@@ -125,7 +160,28 @@ public:
   void setModified(bool m) { modified = m; }
   bool hasBeenModified() { return modified; }
 
+  virtual int serialSize();
+  virtual unsigned char* serialize(unsigned char *ptr);
+  virtual unsigned char* deserialize(unsigned char *ptr);
+
 protected:
+  //! complete the global range and histogram of the local data at commit
+  /*! The local range is rescanned only if the data is dirty; the reductions 
+   * are collective and so are always performed.   Points of more than one component
+   * are reduced by magnitude.   Defined for float and unsigned char samples.
+   * Clears the dirty flags, so should be the last use of them in local_commit.
+   */
+  template<typename T> void commit_range(const T *samples, size_t n, int ncomp, MPI_Comm c);
+
+  int histogram_bins;
+  std::vector<long> histogram;
+
+  // The local histogram and the range it was binned over, so it is only
+  // rebinned if the data or the global range changed
+
+  std::vector<long> local_histogram;
+  float histogram_min, histogram_max;
+
   bool modified;
   OsprayObjectP ospData;
 	vtkClientSocket *skt;
@@ -133,8 +189,20 @@ protected:
 
 	bool time_varying, attached;
 
+  //! read this process's part of the data named in an ImportMsg payload
+  /*! In a batch (see EndImports) this may run on a worker thread, concurrently 
+   * with the imports of other objects, and the processes take the imports in 
+   * no common order.   It must therefore make no collective calls on `c` 
+   * unless import_is_collective is true.
+   */
   virtual bool local_import(char *, MPI_Comm c);
 
+  //! does local_import make collective calls?
+  /*! If so, batched imports of this class run on the message thread, 
+   * one at a time and in batch order at every process.
+   */
+  virtual bool import_is_collective() { return false; }
+
 	Box global_box, local_box;
 	int neighbors[6];
 
@@ -167,6 +235,7 @@ protected:
 			p += sizeof(Key);
 
 			KeyedDataObjectP o = KeyedDataObject::GetByKey(k);
+			o->SetDirty(DIRTY_DATA);
 
 			if (!o->local_import(p, c))
         o->set_error(1);
@@ -174,6 +243,21 @@ protected:
 			return false;
 		}
   };
+
+  //! tell Galaxy processes to import a batch of data files concurrently
+  /*! Each entry is the object's Key, the size of its ImportMsg payload and the 
+   * payload itself (the filename and arguments)
+   */
+  class ImportBatchMsg : public Work
+  {
+  public:
+    ImportBatchMsg(std::vector<std::pair<Key, std::string>>& imports);
+
+    WORK_CLASS(ImportBatchMsg, true);
+
+  public:
+    bool CollectiveAction(MPI_Comm c, bool isRoot);
+  };
 };
 
 } // namespace gxy
@@ -77,15 +77,30 @@ Particles::~Particles()
 void
 Particles::GetParticles(Particle*& p, int& n)
 {
-  n = vertices.size();
+  n = GetNumberOfVertices();
+  vec3f *v = GetVertices();
+  float *d = GetData();
   p = new Particle[n];
   for (int i = 0; i < n; i++)
   { 
-    p[i].xyz = vertices[i];
-    p[i].u.value = data[i];
+    p[i].xyz = v[i];
+    p[i].u.value = d[i];
   }
 }
 
+bool
+Particles::load_from_geometry_file(std::shared_ptr<GeometryFile> f)
+{
+  if (f->GetType() != GeometryFile::PARTICLES)
+  {
+    std::cerr << "ERROR: geometry file does not hold particles\n";
+    return false;
+  }
+
+  adopt(f);
+  return true;
+}
+
 bool
 Particles::load_from_vtkPointSet(vtkPointSet *pset)
 {
@@ -78,6 +78,7 @@ public:
   //! add a Particle to this Particles dataset
 	void push_back(Particle& p)
   {
+    unmap();
     vertices.push_back(p.xyz);
     data.push_back(p.u.value);
   }
@@ -97,6 +98,7 @@ public:
 
 protected:
   virtual bool load_from_vtkPointSet(vtkPointSet *);
+  virtual bool load_from_geometry_file(std::shared_ptr<GeometryFile>);
 };
 
 } // namespace gxy
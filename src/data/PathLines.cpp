@@ -64,6 +64,7 @@ void
 PathLines::initialize()
 {
   super::initialize();
+  window_time = 0;
 };
 
 PathLines::~PathLines()
@@ -127,18 +128,70 @@ PathLines::load_from_vtkPointSet(vtkPointSet *pset)
 void
 PathLines::GetPLVertices(PLVertex*& p, int& n)
 {
-  n = vertices.size();
+  n = GetNumberOfVertices();
+  vec3f *v = GetVertices();
+  float *d = GetData();
   p = new PLVertex[n];
   for (int i = 0; i < n; i++)
   {
-    p[i].xyz = vertices[i];
-    p[i].value = data[i];
+    p[i].xyz = v[i];
+    p[i].value = d[i];
   }
 }
 
+bool
+PathLines::load_from_geometry_file(std::shared_ptr<GeometryFile> f)
+{
+  if (f->GetType() != GeometryFile::PATHLINES)
+  {
+    std::cerr << "ERROR: geometry file does not hold pathlines\n";
+    return false;
+  }
+
+  windows.clear();
+  adopt(f);
+  return true;
+}
+
+void
+PathLines::allocate_windows(std::vector<int>& sizes)
+{
+  windows.clear();
+  windows.reserve(sizes.size());
+
+  int nv = 0;
+  for (auto s : sizes)
+  {
+    windows.push_back(PLWindow(nv, s));
+    nv += s;
+  }
+
+  allocate_vertices(nv);
+  connectivity.clear();
+  connectivity.reserve(nv);
+
+  window_time = 0;
+}
+
+void
+PathLines::update_connectivity()
+{
+  connectivity.clear();
+  for (auto& w : windows)
+    for (int i = w.first; i < (w.last - 1); i++)
+      connectivity.push_back(w.base + i);
+}
+
 OsprayObjectP 
 PathLines::CreateTheOSPRayEquivalent(KeyedDataObjectP kdop)
 { 
+  // If the vertex buffers haven't moved, only the segment indices need to be
+  // handed to OSPRay again
+
+  OsprayPathLinesP opl = OsprayPathLines::Cast(ospData);
+  if (opl && is_incremental() && opl->Update(PathLines::Cast(kdop)))
+    return ospData;
+
   ospData = OsprayObject::Cast(OsprayPathLines::NewP(PathLines::Cast(kdop)));
   return ospData;
 } 
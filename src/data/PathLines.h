@@ -54,6 +54,21 @@ struct PLVertex
   float value;
 };
 
+//! the extent of a single pathline within a PathLines vertex buffer
+/*! Used when a PathLines object is updated incrementally: each line owns a fixed
+ * slot in the vertex buffer and only the visible range [first, last) of that
+ * slot is referenced by the connectivity.
+ * \ingroup data
+ */
+struct PLWindow
+{
+  PLWindow(int b, int s) : base(b), size(s), first(0), last(0) {}
+  int base;   //!< index of the first vertex of this line in the vertex buffer
+  int size;   //!< number of vertices reserved for this line
+  int first;  //!< first visible vertex, relative to base
+  int last;   //!< one past the last visible vertex, relative to base
+};
+
 
 //! a pathline dataset within Galaxy consists of three parts: a set of vertices, a set of indices and a set or pointers into that set of indices indicating where the individual pathlines begin.  Data is per-vertex.
 /* \ingroup data 
@@ -71,8 +86,41 @@ public:
 
   virtual OsprayObjectP CreateTheOSPRayEquivalent(KeyedDataObjectP);
 
+  //! remove all vertices, data, connectivity and incremental windows
+  void clear()
+  {
+    super::clear();
+    windows.clear();
+  }
+
+  //! allocate a vertex slot for each line, sized by `sizes`, for incremental updates
+  /*! The vertex buffer is sized to hold every line in full and the connectivity
+   * buffer is reserved to that size, so subsequent calls to update_connectivity 
+   * never reallocate.
+   */
+  void allocate_windows(std::vector<int>& sizes);
+
+  //! return the per-line windows used for incremental updates
+  std::vector<PLWindow>& GetWindows() { return windows; }
+
+  //! is this PathLines object being updated incrementally?
+  bool is_incremental() { return windows.size() > 0; }
+
+  //! get the time the windows were last advanced to
+  float get_window_time() { return window_time; }
+
+  //! set the time the windows were last advanced to
+  void set_window_time(float t) { window_time = t; }
+
+  //! rebuild the connectivity from the visible portion of each window
+  void update_connectivity();
+
 protected:
   virtual bool load_from_vtkPointSet(vtkPointSet *);
+  virtual bool load_from_geometry_file(std::shared_ptr<GeometryFile>);
+
+  std::vector<PLWindow> windows;
+  float window_time;
 
 private:
 };
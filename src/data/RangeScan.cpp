@@ -0,0 +1,232 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#include <cfloat>
+#include <cmath>
+#include <functional>
+#include <future>
+
+#include "Application.h"
+#include "RangeScan.h"
+#include "Threading.h"
+
+namespace gxy
+{
+
+// Arrays of fewer points than this per thread are not worth splitting further
+
+#define GXY_SCAN_GRAIN (1 << 16)
+
+// Independent min/max accumulators per chunk, so the loops vectorize
+
+#define GXY_SCAN_LANES 8
+
+class scan_task : public ThreadPoolTask
+{
+public:
+  // The caller is waiting on the task, so it goes ahead of rendering tasks
+  scan_task(std::function<void()> f) : ThreadPoolTask(4), f(f) {}
+  virtual int work() { f(); return 0; }
+
+private:
+  std::function<void()> f;
+};
+
+static int
+number_of_parts(size_t n)
+{
+  ThreadPool *pool = GetTheApplication()->GetTheThreadPool();
+  size_t k = pool ? pool->GetNumberOfThreads() + 1 : 1;
+  size_t m = n / GXY_SCAN_GRAIN;
+  return (int)(m < 1 ? 1 : m < k ? m : k);
+}
+
+// Call f(part, start, end) for each of nparts ranges covering [0, n); the 
+// calling thread takes the first
+
+static void
+run_parts(size_t n, int nparts, std::function<void(int, size_t, size_t)> f)
+{
+  ThreadPool *pool = GetTheApplication()->GetTheThreadPool();
+  size_t per = (n + nparts - 1) / nparts;
+
+  std::vector< std::future<int> > futures;
+  for (int i = 1; i < nparts; i++)
+  {
+    size_t s = i * per, e = (s + per) < n ? (s + per) : n;
+    futures.emplace_back(pool->AddTask(new scan_task([f, i, s, e]() { f(i, s, e); })));
+  }
+
+  f(0, 0, per < n ? per : n);
+
+  for (auto& t : futures)
+    t.get();
+}
+
+template<typename T>
+static inline float
+magnitude2(const T *p, int ncomp)
+{
+  float d = 0;
+  for (int c = 0; c < ncomp; c++)
+  {
+    float v = p[c];
+    d += v * v;
+  }
+  return d;
+}
+
+// Range of the values (ncomp == 1) or squared magnitudes of points [s, e)
+
+template<typename T>
+static void
+minmax_part(const T *p, size_t s, size_t e, int ncomp, float& mn, float& mx)
+{
+  float lo[GXY_SCAN_LANES], hi[GXY_SCAN_LANES];
+  for (int j = 0; j < GXY_SCAN_LANES; j++)
+  {
+    lo[j] = FLT_MAX;
+    hi[j] = -FLT_MAX;
+  }
+
+  size_t i = s;
+  if (ncomp == 1)
+  {
+    for ( ; i + GXY_SCAN_LANES <= e; i += GXY_SCAN_LANES)
+      for (int j = 0; j < GXY_SCAN_LANES; j++)
+      {
+        float v = p[i + j];
+        lo[j] = v < lo[j] ? v : lo[j];
+        hi[j] = v > hi[j] ? v : hi[j];
+      }
+
+    for ( ; i < e; i++)
+    {
+      float v = p[i];
+      lo[0] = v < lo[0] ? v : lo[0];
+      hi[0] = v > hi[0] ? v : hi[0];
+    }
+  }
+  else
+  {
+    for ( ; i + GXY_SCAN_LANES <= e; i += GXY_SCAN_LANES)
+      for (int j = 0; j < GXY_SCAN_LANES; j++)
+      {
+        float v = magnitude2(p + (i + j)*ncomp, ncomp);
+        lo[j] = v < lo[j] ? v : lo[j];
+        hi[j] = v > hi[j] ? v : hi[j];
+      }
+
+    for ( ; i < e; i++)
+    {
+      float v = magnitude2(p + i*ncomp, ncomp);
+      lo[0] = v < lo[0] ? v : lo[0];
+      hi[0] = v > hi[0] ? v : hi[0];
+    }
+  }
+
+  mn = lo[0]; mx = hi[0];
+  for (int j = 1; j < GXY_SCAN_LANES; j++)
+  {
+    mn = lo[j] < mn ? lo[j] : mn;
+    mx = hi[j] > mx ? hi[j] : mx;
+  }
+}
+
+template<typename T>
+void
+RangeScan::MinMax(const T *samples, size_t n, int ncomp, float& min, float& max)
+{
+  int nparts = number_of_parts(n);
+  std::vector<float> mins(nparts), maxs(nparts);
+
+  run_parts(n, nparts, [&](int k, size_t s, size_t e) {
+    minmax_part(samples, s, e, ncomp, mins[k], maxs[k]);
+  });
+
+  min = mins[0]; max = maxs[0];
+  for (int k = 1; k < nparts; k++)
+  {
+    if (mins[k] < min) min = mins[k];
+    if (maxs[k] > max) max = maxs[k];
+  }
+
+  if (ncomp > 1 && min <= max)
+  {
+    min = sqrt(min);
+    max = sqrt(max);
+  }
+}
+
+template<typename T>
+static void
+histogram_part(const T *p, size_t s, size_t e, int ncomp, float min, float scale, std::vector<long>& bins)
+{
+  float last = bins.size() - 1;
+  long *b = bins.data();
+
+  // NaNs fail the first test and land in bin 0
+
+  auto bin = [min, scale, last](float v) {
+    float f = (v - min) * scale;
+    f = f >= 0 ? f : 0;
+    return (int)(f < last ? f : last);
+  };
+
+  if (ncomp == 1)
+    for (size_t i = s; i < e; i++)
+      b[bin(p[i])]++;
+  else
+    for (size_t i = s; i < e; i++)
+      b[bin(sqrt(magnitude2(p + i*ncomp, ncomp)))]++;
+}
+
+template<typename T>
+void
+RangeScan::Histogram(const T *samples, size_t n, int ncomp, float min, float max, std::vector<long>& bins)
+{
+  int nbins = bins.size();
+  if (nbins == 0)
+    return;
+
+  float scale = (max > min) ? nbins / (max - min) : 0;
+
+  int nparts = number_of_parts(n);
+  std::vector< std::vector<long> > partial(nparts, std::vector<long>(nbins, 0));
+
+  run_parts(n, nparts, [&](int k, size_t s, size_t e) {
+    histogram_part(samples, s, e, ncomp, min, scale, partial[k]);
+  });
+
+  for (int i = 0; i < nbins; i++)
+  {
+    long c = 0;
+    for (int k = 0; k < nparts; k++)
+      c += partial[k][i];
+    bins[i] = c;
+  }
+}
+
+template void RangeScan::MinMax(const float *, size_t, int, float&, float&);
+template void RangeScan::MinMax(const unsigned char *, size_t, int, float&, float&);
+template void RangeScan::Histogram(const float *, size_t, int, float, float, std::vector<long>&);
+template void RangeScan::Histogram(const unsigned char *, size_t, int, float, float, std::vector<long>&);
+
+} // namespace gxy
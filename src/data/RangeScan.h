@@ -0,0 +1,57 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#pragma once
+
+/*! \file RangeScan.h 
+ * \brief parallel reductions over the sample arrays of data objects
+ * \ingroup data
+ */
+
+#include <cstddef>
+#include <vector>
+
+namespace gxy
+{
+
+//! parallel reductions over the sample arrays of data objects
+/*! \ingroup data
+ * Sample arrays are split into chunks reduced by the application's ThreadPool 
+ * alongside the calling thread; arrays too small to be worth splitting are reduced
+ * in place.   Points of more than one component are reduced by magnitude.   Within
+ * a chunk the loops carry several independent accumulators so that they vectorize.
+ */
+class RangeScan
+{
+public:
+  //! find the range of the `n` points of `ncomp` components in `samples`
+  /*! If there are no points, min is returned greater than max.   NaNs are ignored.
+   */
+  template<typename T>
+  static void MinMax(const T *samples, size_t n, int ncomp, float& min, float& max);
+
+  //! count the points of `samples` in `bins.size()` equal bins spanning [min, max]
+  /*! Points outside [min, max] are counted in the first or last bin.
+   */
+  template<typename T>
+  static void Histogram(const T *samples, size_t n, int ncomp, float min, float max, std::vector<long>& bins);
+};
+
+} // namespace gxy
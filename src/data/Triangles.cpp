@@ -74,6 +74,48 @@ Triangles::allocate_vertices(int nv)
   normals.resize(nv);
 }
 
+void
+Triangles::unmap()
+{
+  if (mapped && mapped->GetNormals())
+    normals.assign(mapped->GetNormals(), mapped->GetNormals() + mapped->GetNumberOfVertices());
+  super::unmap();
+}
+
+static void
+default_normals(std::vector<vec3f>& normals, int nv)
+{
+  std::cerr << "triangle set has no normals\n";
+
+  normals.resize(nv);
+  float *nptr = (float *)normals.data();
+  for (int i = 0; i < nv; i++)
+  {
+    *nptr++ = 1.0;
+    *nptr++ = 0.0;
+    *nptr++ = 0.0;
+  }
+}
+
+bool
+Triangles::load_from_geometry_file(std::shared_ptr<GeometryFile> f)
+{
+  if (f->GetType() != GeometryFile::TRIANGLES)
+  {
+    std::cerr << "ERROR: geometry file does not hold triangles\n";
+    return false;
+  }
+
+  adopt(f);
+
+  if (f->GetNormals())
+    normals.clear();
+  else
+    default_normals(normals, f->GetNumberOfVertices());
+
+  return true;
+}
+
 
 bool
 Triangles::load_from_vtkPointSet(vtkPointSet *pset)
@@ -105,17 +147,7 @@ Triangles::load_from_vtkPointSet(vtkPointSet *pset)
     if (narray)
       memcpy(normals.data(), narray->GetVoidPointer(0), 3*nv*sizeof(float));
     else
-    {
-      std::cerr << "triangle set has no normals\n";
-
-      float *nptr = (float *)normals.data();
-      for (int i = 0; i < nv; i++)
-      {
-        *nptr++ = 1.0;
-        *nptr++ = 0.0;
-        *nptr++ = 0.0;
-      }
-    }
+      default_normals(normals, nv);
     vtkDataArray *array = pset->GetPointData()->GetScalars();
     if (! array) array = pset->GetPointData()->GetArray("data");
 
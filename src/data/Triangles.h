@@ -58,12 +58,14 @@ public:
   //! Allocate space for vertices(data) and connectivity
   virtual void allocate_vertices(int nv);
 
-  vec3f* GetNormals() { return (vec3f *)normals.data(); }
+  vec3f* GetNormals() { return (mapped && mapped->GetNormals()) ? mapped->GetNormals() : (vec3f *)normals.data(); }
 
   virtual OsprayObjectP CreateTheOSPRayEquivalent(KeyedDataObjectP);
 
 protected:
   virtual bool load_from_vtkPointSet(vtkPointSet *);
+  virtual bool load_from_geometry_file(std::shared_ptr<GeometryFile>);
+  virtual void unmap();
   std::vector<vec3f> normals;
 };
 
@@ -22,6 +22,7 @@
 
 #include "Application.h"
 #include "Volume.h"
+#include "Volume_ispc.h"
 #include "OsprayVolume.h"
 
 #include <vtkNew.h>
@@ -45,6 +46,8 @@ Volume::initialize()
 	initialize_grid = false;
 	vtkobj = NULL;
 	samples = NULL;
+	samples_owned = true;
+	pager = NULL;
   number_of_components = 1;
   super::initialize();
 }
@@ -58,7 +61,20 @@ Volume::Register()
 Volume::~Volume()
 {
 	if (vtkobj) vtkobj->Delete();
-	if (samples) free(samples);
+	if (samples && samples_owned) free(samples);
+	if (pager) delete pager;
+}
+
+// Out-of-core mode.   GXY_VOLUME_MEMORY gives the memory, in MB, of the samples
+// of each Volume that each process reads ahead and keeps (see BrickPager); if it
+// is set the samples are paged from disk in bricks of GXY_BRICK_SIZE MB rather 
+// than read into memory.
+
+static size_t
+env_megabytes(const char *name, size_t dflt)
+{
+  const char *s = getenv(name);
+  return ((s && atol(s) > 0) ? (size_t)atol(s) : dflt) << 20;
 }
 
 bool
@@ -66,6 +82,9 @@ Volume::LoadFromJSON(Value& v)
 {
   int r = GetTheApplication()->GetRank();
 
+  if (v.HasMember("histogram"))
+    set_histogram_bins(v["histogram"].GetInt());
+
  	if (v.HasMember("filename"))
 	{
     set_attached(false);
@@ -314,9 +333,28 @@ Volume::local_import(char *fname, MPI_Comm c)
       return false;
     }
   }
+  else if (getenv("GXY_VOLUME_MEMORY") && size <= (global_counts.z - 2))
+  {
+    // Slabs in z, so each partition is a contiguous range of the raw file
+    // that can be paged directly.   If there are too few slices for each 
+    // process to get a cell, the partitions are chosen as usual and paged
+    // through scratch files.
+
+    global_partitions.x = global_partitions.y = 1;
+    global_partitions.z = size;
+  }
   else
     factor(size, global_partitions);
 
+  if (global_partitions.x > (global_counts.x - 2) ||
+      global_partitions.y > (global_counts.y - 2) ||
+      global_partitions.z > (global_counts.z - 2))
+  {
+    if (rank == 0) cerr << "ERROR: volume is too small for a " << global_partitions.x << "x" << global_partitions.y 
+                        << "x" << global_partitions.z << " partitioning" << endl;
+    return false;
+  }
+
   part *partitions = partition(size, global_partitions, global_counts);
   part *my_partition = partitions + rank;
 
@@ -334,26 +372,71 @@ Volume::local_import(char *fname, MPI_Comm c)
 	size_t row_sz = ghosted_local_counts.x * sample_sz;
 	size_t tot_sz = row_sz * ghosted_local_counts.y * ghosted_local_counts.z;
 
-	samples = (unsigned char *)malloc(tot_sz);
-
 	string rawname = data_fname[0] == '/' ? data_fname : (dir + data_fname);
-	ifstream raw;
-  raw.open(rawname.c_str(), ios::in | ios::binary);
 
-	char *dst = (char *)samples;
-	for (int z = 0; z < ghosted_local_counts.z; z++)
-		for (int y = 0; y < ghosted_local_counts.y; y++)
+	drop_pager();
+
+	// When paged, a partition that spans x and y is the contiguous range of the
+	// raw file it maps directly; any other is copied to a scratch file and mapped
+
+	bool mapped = false;
+	if (getenv("GXY_VOLUME_MEMORY"))
+	{
+		size_t budget = env_megabytes("GXY_VOLUME_MEMORY", 0);
+		size_t brick_sz = env_megabytes("GXY_BRICK_SIZE", 16);
+
+		if (ghosted_local_counts.x == global_counts.x && ghosted_local_counts.y == global_counts.y)
+		{
+			size_t offset = (size_t)ghosted_local_offset.z * global_counts.y * global_counts.x * sample_sz;
+			pager = BrickPager::MapFile(rawname, offset, tot_sz, brick_sz, budget);
+			mapped = true;
+		}
+		else
+		{
+			const char *dir = getenv("GXY_PAGING_DIR") ? getenv("GXY_PAGING_DIR") : 
+			                  getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+			pager = BrickPager::MapScratch(dir, tot_sz, brick_sz, budget);
+		}
+
+		if (! pager)
+			return false;
+
+		samples = pager->data();
+		samples_owned = false;
+	}
+	else
+	{
+		samples = (unsigned char *)malloc(tot_sz);
+		samples_owned = true;
+	}
+
+	if (! mapped)
+	{
+		ifstream raw;
+		raw.open(rawname.c_str(), ios::in | ios::binary);
+
+		char *dst = (char *)samples;
+		for (int z = 0; z < ghosted_local_counts.z; z++)
 		{
-			streampos src = (((ghosted_local_offset.z + z) * (global_counts.y * global_counts.x)) + 
-											 ((ghosted_local_offset.y + y) * global_counts.x) + 
-											   ghosted_local_offset.x) * sample_sz;
+			for (int y = 0; y < ghosted_local_counts.y; y++)
+			{
+				streampos src = (((ghosted_local_offset.z + z) * (global_counts.y * global_counts.x)) + 
+												 ((ghosted_local_offset.y + y) * global_counts.x) + 
+													 ghosted_local_offset.x) * sample_sz;
 
-			raw.seekg(src, ios_base::beg);
-			raw.read(dst, row_sz);
-			dst += row_sz;
+				raw.seekg(src, ios_base::beg);
+				raw.read(dst, row_sz);
+				dst += row_sz;
+			}
+
+			// Don't hold the copied slices of a scratch file in memory
+
+			if (pager)
+				pager->Filled(dst - (char *)samples);
 		}
 
-	raw.close();
+		raw.close();
+	}
 
 #define ijk2rank(i, j, k) ((i) + ((j) * global_partitions.x) + ((k) * global_partitions.x * global_partitions.y))
 
@@ -403,125 +486,25 @@ Volume::local_commit(MPI_Comm c)
     return true;
   }
 
-	if (type == FLOAT)
-	{
-		float *ptr = (float *)samples;
-    if (number_of_components == 1)
-    {
-      local_min = local_max = *ptr++;
-      for (int i = 1; i < ghosted_local_counts.x * ghosted_local_counts.y * ghosted_local_counts.z; i++, ptr++)
-      {	
-        if (*ptr < local_min) local_min = *ptr;
-        if (*ptr > local_max) local_max = *ptr;
-      }
-    }
-    else
-    {
-      for (int i = 0; i < ghosted_local_counts.x * ghosted_local_counts.y * ghosted_local_counts.z; i++)
-      {	
-        double d = 0;
-        for (int j = 0; j < number_of_components; j++, ptr++)
-          d += ((*ptr) * (*ptr));
-        if (i == 0)
-          local_min = local_max = d;
-        else
-        {
-          if (d < local_min) local_min = d;
-          if (d > local_max) local_max = d;
-        }
-      }
-      local_min = sqrt(local_min);
-      local_max = sqrt(local_max);
-    }
-	}
-	else
-	{
-		unsigned char *ptr = (unsigned char *)samples;
-    if (number_of_components == 1)
-    {
-      local_min = local_max = *ptr++;
-      for (int i = 1; i < ghosted_local_counts.x * ghosted_local_counts.y * ghosted_local_counts.z; i++, ptr++)
-      {	
-        if (*ptr < local_min) local_min = *ptr;
-        if (*ptr > local_max) local_max = *ptr;
-      }
-    }
-    else
-    {
-      for (int i = 0; i < ghosted_local_counts.x * ghosted_local_counts.y * ghosted_local_counts.z; i++)
-      {	
-        double d = 0;
-        for (int j = 0; j < number_of_components; j++, ptr++)
-        {
-          double p = *ptr;
-          d += (p * p);
-        }
-        if (i == 0)
-          local_min = local_max = d;
-        else
-        {
-          if (d < local_min) local_min = d;
-          if (d > local_max) local_max = d;
-        }
-      }
-      local_min = sqrt(local_min);
-      local_max = sqrt(local_max);
-    }
-	}
-
-
-	float lmin, lmax, gmin, gmax;
-	get_local_minmax(lmin, lmax);
-
-	if (GetTheApplication()->GetTheMessageManager()->UsingMPI())
-	{
-		MPI_Allreduce(&lmax, &gmax, 1, MPI_FLOAT, MPI_MAX, c);
-		MPI_Allreduce(&lmin, &gmin, 1, MPI_FLOAT, MPI_MIN, c);
-	}
-	else
-	{
-		gmin = lmin;
-		gmax = lmax;
-	}
+  size_t n = (size_t)ghosted_local_counts.x * ghosted_local_counts.y * ghosted_local_counts.z;
 
-	set_global_minmax(gmin, gmax);
+  if (type == FLOAT)
+    commit_range((float *)samples, n, number_of_components, c);
+  else
+    commit_range(samples, n, number_of_components, c);
 
   return false;
 }
 
-#define get_sample_ptr(ijk)                                               \
-  (samples + ((ijk.z * ghosted_local_counts.y * ghosted_local_counts.x)   \
-              +  (ijk.y * ghosted_local_counts.x)                         \
-              +  ijk.x) * number_of_components * (isFloat() ? 4 : 1))
-
-#define interp1(T, t, a, b, d)                      \
-  float t[number_of_components];                    \
-  {                                                 \
-    T *aptr = (T *)a, *bptr = (T *)b;               \
-    for (int i = 0; i < number_of_components; i++)  \
-      t[i] = (1-d)*(aptr[i]) + d*(bptr[i]);         \
-  }
-  
-#define interp2(t, aptr, bptr, d)                   \
-  float t[number_of_components];                    \
-  {                                                 \
-    for (int i = 0; i < number_of_components; i++)  \
-      t[i] = (1-d)*(aptr[i]) + d*(bptr[i]);         \
-  }
-  
-#define interp3(aptr, bptr, d)                      \
-  {                                                 \
-    for (int i = 0; i < number_of_components; i++)  \
-      result[i] = (1-d)*(aptr[i]) + d*(bptr[i]);    \
-  }
-  
-
-vec3i add(vec3i a, vec3i b) { return vec3i(a.x + b.x, a.y + b.y, a.z + b.z); }
+// The components of a single point go on the stack for the usual few, on
+// the heap otherwise
 
 bool
 Volume::Sample(vec3f& p, vec3f& v)
 {
-  float values[number_of_components];
+  float local[4];
+  std::vector<float> heap(number_of_components > 4 ? number_of_components : 0);
+  float *values = heap.empty() ? local : heap.data();
   if (! Sample(p, values))
     return false;
 
@@ -535,7 +518,9 @@ Volume::Sample(vec3f& p, vec3f& v)
 bool
 Volume::Sample(vec3f& p, float& v)
 {
-  float values[number_of_components];
+  float local[4];
+  std::vector<float> heap(number_of_components > 4 ? number_of_components : 0);
+  float *values = heap.empty() ? local : heap.data();
   if (! Sample(p, values))
     return false;
 
@@ -543,50 +528,118 @@ Volume::Sample(vec3f& p, float& v)
   return true;
 }
 
+// Single-point counterpart of the ISPC batch kernel in Volume.ispc
+
+template<typename T>
 bool
-Volume::Sample(vec3f& p, float* result)
+Volume::trilinear(vec3f& p, float *result)
 {
   // Get p in grid coordinates
-  vec3f grid_xyz = (p - global_origin);
-  grid_xyz.x = grid_xyz.x / deltas.x;
-  grid_xyz.y = grid_xyz.y / deltas.y;
-  grid_xyz.z = grid_xyz.z / deltas.z;
+  float x = (p.x - global_origin.x) / deltas.x;
+  float y = (p.y - global_origin.y) / deltas.y;
+  float z = (p.z - global_origin.z) / deltas.z;
+
+  // Lower corner of containing hex, relative to the ghosted local grid
+  int ix = (int)floor(x) - ghosted_local_offset.x;
+  int iy = (int)floor(y) - ghosted_local_offset.y;
+  int iz = (int)floor(z) - ghosted_local_offset.z;
+
+  if (ix < 0 || ix >= (ghosted_local_counts.x-1)) return false;
+  if (iy < 0 || iy >= (ghosted_local_counts.y-1)) return false;
+  if (iz < 0 || iz >= (ghosted_local_counts.z-1)) return false;
+
+  float dx = x - (ix + ghosted_local_offset.x);
+  float dy = y - (iy + ghosted_local_offset.y);
+  float dz = z - (iz + ghosted_local_offset.z);
+
+  size_t istep = number_of_components;
+  size_t jstep = istep * ghosted_local_counts.x;
+  size_t kstep = jstep * ghosted_local_counts.y;
+
+  T *s000 = ((T *)samples) + ix*istep + iy*jstep + iz*kstep;
+  T *s100 = s000 + istep;
+  T *s010 = s000 + jstep;
+  T *s110 = s010 + istep;
+  T *s001 = s000 + kstep;
+  T *s101 = s001 + istep;
+  T *s011 = s001 + jstep;
+  T *s111 = s011 + istep;
+
+  for (int c = 0; c < number_of_components; c++)
+  {
+    float t00 = s000[c] + dx * ((float)s100[c] - (float)s000[c]);
+    float t10 = s010[c] + dx * ((float)s110[c] - (float)s010[c]);
+    float t01 = s001[c] + dx * ((float)s101[c] - (float)s001[c]);
+    float t11 = s011[c] + dx * ((float)s111[c] - (float)s011[c]);
+
+    float t0 = t00 + dy * (t10 - t00);
+    float t1 = t01 + dy * (t11 - t01);
+
+    result[c] = t0 + dz * (t1 - t0);
+  }
 
-  // Lower corner of containing hex
-  vec3i ll(floor(grid_xyz.x), floor(grid_xyz.y), floor(grid_xyz.z));
+  return true;
+}
 
-  if (ll.x < ghosted_local_offset.x || ll.x >= (ghosted_local_offset.x + (ghosted_local_counts.x-1))) return false;
-  if (ll.y < ghosted_local_offset.y || ll.y >= (ghosted_local_offset.y + (ghosted_local_counts.y-1))) return false;
-  if (ll.z < ghosted_local_offset.z || ll.z >= (ghosted_local_offset.z + (ghosted_local_counts.z-1))) return false;
+bool
+Volume::Sample(vec3f& p, float* result)
+{
+  return isFloat() ? trilinear<float>(p, result) : trilinear<unsigned char>(p, result);
+}
 
-  float dx = grid_xyz.x - ll.x;
-  float dy = grid_xyz.y - ll.y;
-  float dz = grid_xyz.z - ll.z;
+int
+Volume::Sample(int n, vec3f* p, float* values, unsigned char* valid)
+{
+  if (pager && n > 0)
+  {
+    float zmin = p[0].z, zmax = p[0].z;
+    for (int i = 1; i < n; i++)
+    {
+      if (p[i].z < zmin) zmin = p[i].z;
+      if (p[i].z > zmax) zmax = p[i].z;
+    }
+    Prefetch(zmin, zmax);
+  }
 
-  ll = ll - ghosted_local_offset;
+  float origin[] = {global_origin.x, global_origin.y, global_origin.z};
+  float delta[]  = {deltas.x, deltas.y, deltas.z};
+  int offsets[]  = {ghosted_local_offset.x, ghosted_local_offset.y, ghosted_local_offset.z};
+  int counts[]   = {ghosted_local_counts.x, ghosted_local_counts.y, ghosted_local_counts.z};
 
   if (isFloat())
   {
-    interp1(float, t00, get_sample_ptr(add(ll, vec3i(0, 0, 0))), get_sample_ptr(add(ll, vec3i(1, 0, 0))), dx);
-    interp1(float, t01, get_sample_ptr(add(ll, vec3i(0, 0, 1))), get_sample_ptr(add(ll, vec3i(1, 0, 1))), dx);
-    interp1(float, t10, get_sample_ptr(add(ll, vec3i(0, 1, 0))), get_sample_ptr(add(ll, vec3i(1, 1, 0))), dx);
-    interp1(float, t11, get_sample_ptr(add(ll, vec3i(0, 1, 1))), get_sample_ptr(add(ll, vec3i(1, 1, 1))), dx);
-    interp2(t0, t00, t10, dy);
-    interp2(t1, t01, t11, dy);
-    interp3(t0, t1, dz);
+    if (number_of_components == 1)
+      return ispc::Volume_sample_float_1((float *)samples, origin, delta, offsets, counts, n, (float *)p, values, valid);
+    else
+      return ispc::Volume_sample_float_N((float *)samples, number_of_components, origin, delta, offsets, counts, n, (float *)p, values, valid);
   }
   else
   {
-    interp1(unsigned char, t00, get_sample_ptr(add(ll, vec3i(0, 0, 0))), get_sample_ptr(add(ll, vec3i(1, 0, 0))), dx);
-    interp1(unsigned char, t01, get_sample_ptr(add(ll, vec3i(0, 0, 1))), get_sample_ptr(add(ll, vec3i(1, 0, 1))), dx);
-    interp1(unsigned char, t10, get_sample_ptr(add(ll, vec3i(0, 1, 0))), get_sample_ptr(add(ll, vec3i(1, 1, 0))), dx);
-    interp1(unsigned char, t11, get_sample_ptr(add(ll, vec3i(0, 1, 1))), get_sample_ptr(add(ll, vec3i(1, 1, 1))), dx);
-    interp2(t0, t00, t10, dy);
-    interp2(t1, t01, t11, dy);
-    interp3(t0, t1, dz);
+    if (number_of_components == 1)
+      return ispc::Volume_sample_uchar_1(samples, origin, delta, offsets, counts, n, (float *)p, values, valid);
+    else
+      return ispc::Volume_sample_uchar_N(samples, number_of_components, origin, delta, offsets, counts, n, (float *)p, values, valid);
   }
+}
 
-  return true;
+void
+Volume::Prefetch(float zmin, float zmax)
+{
+  if (! pager)
+    return;
+
+  // slices of the ghosted local grid, including the one above for interpolation
+
+  int k0 = (int)floor((zmin - global_origin.z) / deltas.z) - ghosted_local_offset.z;
+  int k1 = (int)floor((zmax - global_origin.z) / deltas.z) - ghosted_local_offset.z + 1;
+
+  if (k0 < 0) k0 = 0;
+  if (k1 > ghosted_local_counts.z - 1) k1 = ghosted_local_counts.z - 1;
+  if (k1 < k0)
+    return;
+
+  size_t slice = (size_t)ghosted_local_counts.x * ghosted_local_counts.y * number_of_components * ((type == FLOAT) ? 4 : 1);
+  pager->Prefetch(k0 * slice, (k1 + 1) * slice);
 }
 
 int 
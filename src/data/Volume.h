@@ -34,6 +34,7 @@
 #include <vtkSmartPointer.h>
 
 #include "Box.h"
+#include "BrickPager.h"
 #include "dtypes.h"
 #include "KeyedDataObject.h"
 
@@ -65,9 +66,27 @@ public:
 	//! set the samples (i.e. data value) array for this Volume
 	void set_samples(void * s) 
 	{ 
+		drop_pager();
 		if (samples != NULL) 
 	  { std::cerr << "WARNING: overwriting (and leaking) Galaxy samples array!" << std::endl;} 
 	  samples = (unsigned char*)s; 
+	  samples_owned = true;
+	  SetDirty(DIRTY_DATA);
+	}
+	//! replace the samples array for this Volume, returning the prior one to the caller
+	/*! \param owned whether the Volume is to free the new array; if not (eg. the array
+	 *               is in memory shared with a simulation) its provider must outlive it
+	 * If the samples were paged, paging stops and NULL is returned, as the mapping
+	 * is released here
+	 */
+	unsigned char *swap_samples(void *s, bool owned = true)
+	{
+		drop_pager();
+		unsigned char *prior = samples;
+		samples = (unsigned char *)s;
+		samples_owned = owned;
+		SetDirty(DIRTY_DATA);
+		return prior;
 	}
 
 	//! get the deltas (grid step size) for this Volume
@@ -156,6 +175,13 @@ public:
 	 	local_counts.y = ny;
     local_counts.z = nz;
 	}
+	//! get the global index of the first (non-ghost) sample point at this process
+	void get_local_offsets(int& ni, int& nj, int& nk)
+	{
+		ni = local_offset.x;
+		nj = local_offset.y;
+		nk = local_offset.z;
+	}
 	//! get the local offset for ghost data at this process
 	void get_ghosted_local_offsets(int& ni, int& nj, int& nk) 
 	{
@@ -217,12 +243,28 @@ public:
   void set_number_of_components(int n) { number_of_components = n; }
 
   //! Interpolate an arbitrary point and return true if its in the local partition, otherwise false
-  bool Sample(vec3f& p, float* i);
+  virtual bool Sample(vec3f& p, float* i);
   bool Sample(vec3f& p, vec3f& v);
   bool Sample(vec3f& p, float& v);
 
+  //! Interpolate a batch of `n` points at once
+  /*! `values` receives `number_of_components` floats per point.  Points that do
+   * not lie in the local (ghosted) partition receive 0 and, if `valid` is given,
+   * are flagged 0 there; points that do are flagged 1.   Returns the number of
+   * points that were in the local partition.
+   */
+  virtual int Sample(int n, vec3f* p, float* values, unsigned char* valid = NULL);
+
   //! Which process owns an arbitrary point in this global volume? -1 for outside
-  int PointOwner(vec3f& p);
+  virtual int PointOwner(vec3f& p);
+
+  //! are the samples of this Volume paged from disk rather than held in memory?
+  /*! Set at import when GXY_VOLUME_MEMORY gives the memory budget for them */
+  bool is_paged() { return pager != NULL; }
+
+  //! the samples between the given z values will be read soon
+  /*! Reads their bricks ahead of use if the Volume is paged, otherwise does nothing */
+  void Prefetch(float zmin, float zmax);
 
 	void set_global_partitions(int i, int j, int k) { global_partitions.x = i; global_partitions.y = j; global_partitions.z = k; }
 
@@ -232,13 +274,30 @@ public:
 
   void Allocate()
   {
-    if (samples) free(samples);
+    drop_pager();
+    if (samples && samples_owned) free(samples);
+    samples_owned = true;
     size_t sz = global_counts.x * global_counts.y * global_counts.z * number_of_components 
       * ((type == FLOAT) ? sizeof(float) : sizeof(unsigned char));
     samples = (unsigned char *)malloc(sz);
+    SetDirty(DIRTY_DATA);
   }
 
 protected:
+  template<typename T> bool trilinear(vec3f& p, float *result);
+
+  //! stop paging, if the samples are paged, releasing their mapping
+  void drop_pager()
+  {
+    if (pager)
+    {
+      delete pager;
+      pager = NULL;
+      samples = NULL;
+      samples_owned = false;
+    }
+  }
+
 	bool initialize_grid; 	// If time step data, need to grab grid info from first timestep
 
   vtkImageData *vtkobj;
@@ -260,6 +319,8 @@ protected:
 	vec3i ghosted_local_offset;
 	vec3i ghosted_local_counts;
 	unsigned char *samples;
+	bool samples_owned;
+	BrickPager *pager;
 };
 
 } // namespace gxy
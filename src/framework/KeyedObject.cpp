@@ -192,6 +192,7 @@ KeyedObject::KeyedObject(KeyedObjectClass c, Key k) : keyedObjectClass(c), key(k
 {  
 	ko_count++;
   error = 0;
+  dirty = DIRTY_ALL;
 	initialize();
 }
 
@@ -257,34 +258,136 @@ KeyedObject::deserialize(unsigned char *p)
 	return p;
 }
 
+// A CommitMsg carries a commit_header followed by either the object's full
+// serialized state, a list of the byte ranges of the state that changed since
+// the last commit (each an offset, a length and the bytes), or nothing if the
+// state is unchanged.
+
+enum { COMMIT_FULL, COMMIT_DELTA, COMMIT_UNCHANGED };
+
+struct commit_header
+{
+  Key key;
+  int dirty;      // dirty flags at the committing process
+  int mode;       // COMMIT_FULL, COMMIT_DELTA or COMMIT_UNCHANGED
+  int size;       // size of the serialized state
+  int nranges;    // number of changed ranges in a COMMIT_DELTA
+};
+
+// Changed ranges closer than this are merged
+
+#define COMMIT_DELTA_GAP 16
+
+static void
+append(std::vector<unsigned char>& v, const void *p, size_t n)
+{
+  v.insert(v.end(), (unsigned char *)p, ((unsigned char *)p) + n);
+}
+
 bool
 KeyedObject::Commit()
 {
-	CommitMsg msg(this);
+  std::vector<unsigned char> state(SerialSize());
+  Serialize(state.data());
+
+  commit_header hdr;
+  hdr.key     = getkey();
+  hdr.size    = state.size();
+  hdr.nranges = 0;
+
+  std::vector<unsigned char> ranges;
+
+  if (state == committed_state)
+    hdr.mode = COMMIT_UNCHANGED;
+  else if (state.size() != committed_state.size())
+    hdr.mode = COMMIT_FULL;
+  else
+  {
+    int n = state.size();
+    for (int i = 0; i < n; )
+    {
+      if (state[i] == committed_state[i]) { i++; continue; }
+
+      int j = i + 1, last = i;
+      while (j < n && j - last <= COMMIT_DELTA_GAP)
+      {
+        if (state[j] != committed_state[j]) last = j;
+        j++;
+      }
+
+      int len = (last - i) + 1;
+      append(ranges, &i, sizeof(int));
+      append(ranges, &len, sizeof(int));
+      append(ranges, state.data() + i, len);
+      hdr.nranges++;
+
+      i = last + 1;
+    }
+
+    hdr.mode = ranges.size() < state.size() ? COMMIT_DELTA : COMMIT_FULL;
+  }
+
+  if (hdr.mode != COMMIT_UNCHANGED)
+    dirty |= DIRTY_STATE;
+
+  hdr.dirty = dirty;
+
+  std::vector<unsigned char> payload;
+  append(payload, &hdr, sizeof(hdr));
+  if (hdr.mode == COMMIT_FULL)
+    append(payload, state.data(), state.size());
+  else if (hdr.mode == COMMIT_DELTA)
+    append(payload, ranges.data(), ranges.size());
+
+  committed_state.swap(state);
+
+	CommitMsg msg(payload);
 	msg.Broadcast(true, true);
   NotifyObservers(ObserverEvent::Updated, (void *)this);
   return get_error() == 0;
 }
 
-KeyedObject::CommitMsg::CommitMsg(KeyedObject* kop) : KeyedObject::CommitMsg::CommitMsg(kop->SerialSize())
+KeyedObject::CommitMsg::CommitMsg(std::vector<unsigned char>& payload) : KeyedObject::CommitMsg::CommitMsg(payload.size())
 {
-	unsigned char *p = (unsigned char *)get();
-	kop->Serialize(p);
+	memcpy(get(), payload.data(), payload.size());
 }
 
 bool
 KeyedObject::CommitMsg::CollectiveAction(MPI_Comm c, bool isRoot)
 {
   unsigned char *p = (unsigned char *)get();
-  Key k = *(Key *)p;
-  p += sizeof(Key);
+  commit_header *hdr = (commit_header *)p;
+  p += sizeof(commit_header);
 
-  KeyedObjectP kop = GetTheKeyedObjectFactory()->get(k);
+  KeyedObjectP kop = GetTheKeyedObjectFactory()->get(hdr->key);
 
   if (! isRoot)
-    kop->deserialize(p);
+  {
+    std::vector<unsigned char>& state = kop->committed_state;
+
+    if (hdr->mode == COMMIT_FULL)
+      state.assign(p, p + hdr->size);
+    else if (hdr->mode == COMMIT_DELTA)
+      for (int i = 0; i < hdr->nranges; i++)
+      {
+        int offset = *(int *)p; p += sizeof(int);
+        int len    = *(int *)p; p += sizeof(int);
+        memcpy(state.data() + offset, p, len);
+        p += len;
+      }
+
+    // The state begins with the key
+
+    if (hdr->mode != COMMIT_UNCHANGED)
+      kop->deserialize(state.data() + sizeof(Key));
+
+    kop->dirty |= hdr->dirty;
+  }
+
+  bool r = kop->local_commit(c);
+  kop->dirty = 0;
 
-  return kop->local_commit(c);
+  return r;
 }
 
 void
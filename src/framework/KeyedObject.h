@@ -189,10 +189,29 @@ public:
   virtual unsigned char *deserialize(unsigned char *);
 
   //! commit this object to the global registry across all processes
+  /*! Only the parts of the serialized state that changed since the last commit are
+   * broadcast, and none if nothing did; local_commit runs everywhere regardless.
+   */
   virtual bool Commit();
   //! commit this object to the local registry
+  /*! Subclasses may use IsDirty to skip work whose inputs have not changed since
+   * the last commit.   The dirty flags are cleared when local_commit returns.
+   */
   virtual bool local_commit(MPI_Comm);
 
+  //! parts of a KeyedObject that may change between commits
+  /*! DIRTY_STATE covers the serialized state, and is set by Commit when it changed.
+   * DIRTY_DATA covers bulk data held separately at each process (eg. a Volume's 
+   * samples) and must be set at each process by whatever changes it.   New objects
+   * are entirely dirty.
+   */
+  enum DirtyFlags { DIRTY_STATE = 0x1, DIRTY_DATA = 0x2, DIRTY_ALL = 0x3 };
+
+  //! note that the given parts of this object have changed
+  void SetDirty(int flags = DIRTY_ALL) { dirty |= flags; }
+  //! have any of the given parts of this object changed since the last commit?
+  bool IsDirty(int flags = DIRTY_ALL) { return (dirty & flags) != 0; }
+
 	// only concrete subclasses have static LoadToJSON at abstract layer
   //! construct object from a Galaxy JSON specification
   virtual bool LoadFromJSON(rapidjson::Value&) { std::cerr << "abstract KeyedObject LoadFromJSON" << std::endl; return false; }
@@ -201,7 +220,7 @@ public:
   class CommitMsg : public Work
   {
   public:
-    CommitMsg(KeyedObject* kop);
+    CommitMsg(std::vector<unsigned char>& payload);
 
     // defined in Work.h
     WORK_CLASS(CommitMsg, false);
@@ -215,6 +234,13 @@ protected:
   Key key;
   bool primary;
 
+  int dirty;
+
+  // The serialized state as of the last commit, from which the next commit's
+  // changes are found on the primary and to which they are applied elsewhere
+
+  std::vector<unsigned char> committed_state;
+
 private:
   //! remove this object from the global registry
 	virtual void Drop();
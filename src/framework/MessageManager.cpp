@@ -213,6 +213,11 @@ void *MessageManager::messageThread(void *p)
 			if (! mm->quit)
         mm->quit = check_outgoing(mm);
 
+			// Any non-blocking collectives finished?
+
+			if (mm->UsingMPI() && ! mm->quit)
+				check_nbc(mm);
+
 			purge_completed_mpi_buffers();
 
 #if 0
@@ -482,6 +487,27 @@ MessageManager::check_outgoing(MessageManager *mm)
 	return kill_app;
 }
 		
+void
+MessageManager::check_nbc(MessageManager *mm)
+{
+	// Complete in posting order, so that anything a completion posts in
+	// turn is posted in the same order on every rank
+
+	while (! mm->nbc_pending.empty())
+	{
+		int flag; MPI_Status s;
+		NonBlockingCollective *c = mm->nbc_pending.front();
+
+		MPI_Test(c->GetRequest(), &flag, &s);
+		if (! flag)
+			break;
+
+		mm->nbc_pending.pop_front();
+		c->Complete();
+		delete c;
+	}
+}
+		
 bool
 MessageManager::check_clientserver(MessageManager *mm)
 {
@@ -542,6 +568,7 @@ MessageManager::setup_mpi(Application *app, MessageManager *mm)
 		MPI_Comm p2p, coll;
 		MPI_Comm_dup(MPI_COMM_WORLD, &p2p);
 		MPI_Comm_dup(MPI_COMM_WORLD, &coll);
+		MPI_Comm_dup(MPI_COMM_WORLD, &mm->nbc_comm);
 
 		mm->setP2PComm(p2p);
 		mm->setCollComm(coll);
@@ -27,6 +27,7 @@
 
 #include <iostream>
 #include <memory>
+#include <deque>
 #include <mpi.h>
 #include <stdlib.h>
 
@@ -39,6 +40,30 @@ namespace gxy
 
 class Application;
 
+//! a non-blocking collective operation whose completion is detected by the message thread
+/*! \ingroup framework
+ * Subclasses post their operation on MessageManager::getNBCComm() from the 
+ * message thread (i.e. from a CollectiveAction), handing the request to 
+ * MessageManager::AddNonBlockingCollective.   The message thread tests the
+ * outstanding operations in the order they were posted, calls Complete() when
+ * one finishes and then deletes it.
+ * \sa MessageManager
+ */
+class NonBlockingCollective
+{
+public:
+  virtual ~NonBlockingCollective() {} //!< default destructor
+
+  //! the request the subclass's operation was posted with
+  MPI_Request *GetRequest() { return &request; }
+
+  //! called on the message thread once the operation has completed
+  virtual void Complete() = 0;
+
+protected:
+  MPI_Request request;
+};
+
 //! manages communication of interprocess Messages in Galaxy
 /*! \ingroup framework
  * \sa Message, MessageQ, Work
@@ -82,6 +107,16 @@ public:
 	MPI_Comm getP2PComm() { return p2p_comm; }
 	//! get the MPI communicator for collective communications
 	MPI_Comm getCollComm() { return coll_comm; }
+	//! get the MPI communicator for non-blocking collectives
+	/*! All ranks must post their non-blocking collectives on this communicator 
+	 * in the same order, so they should only be posted from a CollectiveAction
+	 * broadcast from a single root.
+	 */
+	MPI_Comm getNBCComm() { return nbc_comm; }
+
+	//! hand a posted non-blocking collective to the message thread to be completed
+	/*! must be called on the message thread, i.e. from a CollectiveAction */
+	void AddNonBlockingCollective(NonBlockingCollective *c) { nbc_pending.push_back(c); }
 
 	//! returns a pointer to the incoming MessageQ for this manager
   MessageQ *GetIncomingMessageQueue() { return theIncomingQueue; }
@@ -148,6 +183,7 @@ private:
 	static bool check_clientserver(MessageManager*);
 	static bool check_mpi(MessageManager*);
 	static bool check_outgoing(MessageManager*);
+	static void check_nbc(MessageManager*);
 
   static void *messageThread(void *);
   static void *workThread(void *);
@@ -169,7 +205,9 @@ private:
 	bool pause;
 	bool quit;
 
-	MPI_Comm p2p_comm, coll_comm;
+	MPI_Comm p2p_comm, coll_comm, nbc_comm;
+
+	std::deque<NonBlockingCollective *> nbc_pending;
 };
 
 } // namespace gxy
@@ -0,0 +1,133 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#pragma once
+
+/*! \file Philox.h 
+ * \brief a counter-based random number generator for independent, reproducible streams
+ * \ingroup framework
+ */
+
+#include <stdint.h>
+#include <math.h>
+
+namespace gxy
+{
+
+//! a counter-based (Philox4x32-10) random number generator
+/*! \ingroup framework
+ * Each generator is a pure function of its key and counter, so any number of
+ * threads can draw from independent streams without shared state.   A stream
+ * is identified by a seed and two stream ids (e.g. MPI rank and thread or chain
+ * index); the same seed and stream ids always produce the same sequence, 
+ * regardless of how work is scheduled.
+ */
+class Philox
+{
+public:
+  //! create the stream identified by `seed`, `s0` and `s1`
+  Philox(uint32_t seed = 0, uint32_t s0 = 0, uint32_t s1 = 0)
+  {
+    key[0] = seed;
+    key[1] = s0;
+    ctr[0] = ctr[1] = 0;
+    ctr[2] = s1;
+    ctr[3] = 0;
+    next_out = 4;
+    have_normal = false;
+  }
+
+  //! return the next raw 32-bit value in this stream
+  uint32_t next()
+  {
+    if (next_out == 4)
+    {
+      generate();
+      if (++ctr[0] == 0) ++ctr[1];
+      next_out = 0;
+    }
+    return out[next_out++];
+  }
+
+  //! return a uniformly distributed float in [0, 1)
+  float uniform() { return (next() >> 8) * (1.0f / 16777216.0f); }
+
+  //! return a normally distributed value with mean 0 and standard deviation 1
+  float normal()
+  {
+    if (have_normal)
+    {
+      have_normal = false;
+      return saved_normal;
+    }
+
+    // Box-Muller; 1 - uniform() is in (0, 1] so the log is finite
+
+    float r = sqrtf(-2.0f * logf(1.0f - uniform()));
+    float t = 2.0f * (float)M_PI * uniform();
+
+    saved_normal = r * sinf(t);
+    have_normal = true;
+
+    return r * cosf(t);
+  }
+
+private:
+  static void mulhilo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo)
+  {
+    uint64_t p = (uint64_t)a * (uint64_t)b;
+    hi = (uint32_t)(p >> 32);
+    lo = (uint32_t)p;
+  }
+
+  void generate()
+  {
+    uint32_t c[4] = {ctr[0], ctr[1], ctr[2], ctr[3]};
+    uint32_t k[2] = {key[0], key[1]};
+
+    for (int r = 0; r < 10; r++)
+    {
+      uint32_t hi0, lo0, hi1, lo1;
+      mulhilo(0xD2511F53, c[0], hi0, lo0);
+      mulhilo(0xCD9E8D57, c[2], hi1, lo1);
+
+      c[0] = hi1 ^ c[1] ^ k[0];
+      c[1] = lo1;
+      c[2] = hi0 ^ c[3] ^ k[1];
+      c[3] = lo0;
+
+      k[0] += 0x9E3779B9;
+      k[1] += 0xBB67AE85;
+    }
+
+    for (int i = 0; i < 4; i++)
+      out[i] = c[i];
+  }
+
+  uint32_t key[2];
+  uint32_t ctr[4];
+  uint32_t out[4];
+  int      next_out;
+
+  bool  have_normal;
+  float saved_normal;
+};
+
+} // namespace gxy
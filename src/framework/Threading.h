@@ -218,6 +218,9 @@ public:
 
 	int GetNumberOfTasks() { return number_of_tasks; }
 
+	//! return the number of threads in this pool
+	int GetNumberOfThreads() { return nPoolThreads; }
+
 private:
 	std::vector<pthread_t> thread_ids;
 
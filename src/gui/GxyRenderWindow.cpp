@@ -64,6 +64,9 @@ GxyRenderWindow::~GxyRenderWindow()
 
   if (frame_times) free(frame_times);
   frame_times = NULL;
+
+  if (samples) free(samples);
+  samples = NULL;
 }
 
 void
@@ -323,14 +326,17 @@ GxyRenderWindow::resizeGL(int w, int h)
     if (frameids) free(frameids);
     if (negative_frameids) free(negative_frameids);
     if (frame_times) free(frame_times);
+    if (samples) free(samples);
 
     pixels             = (float *)malloc(width*height*4*sizeof(float));
     negative_pixels    = (float *)malloc(width*height*4*sizeof(float));
     frameids           = (int *)malloc(width*height*sizeof(int));
     negative_frameids  = (int *)malloc(width*height*sizeof(int));
     frame_times        = (long *)malloc(width*height*sizeof(long));
+    samples            = (int *)malloc(width*height*sizeof(int));
 
     memset(frameids, 0, width*height*sizeof(int));
+    memset(samples, 0, width*height*sizeof(int));
     memset(negative_frameids, 0, width*height*sizeof(int));
 
     long now = my_time();
@@ -391,9 +397,7 @@ GxyRenderWindow::addPixels(gxy::Pixel *p, int n, int frame)
 
         if (frameids[offset] == frame)
         {
-          *pix++ += p->r;
-          *pix++ += p->g;
-          *pix++ += p->b;
+          gxy::AccumulateSample(pix, samples[offset], &p->r, p->samples, 3);
         }
         else
         {
@@ -425,6 +429,7 @@ GxyRenderWindow::addPixels(gxy::Pixel *p, int n, int frame)
             // first
 
             frameids[offset] = frame;
+            samples[offset] = p->samples;
             if (current_frame == negative_frameids[offset])
             {
               *pix++ = (*npix + p->r);
@@ -500,6 +505,7 @@ GxyRenderWindow::FrameBufferAger()
           {
             frame_times[offset] = now;
             frameids[offset] = current_frame;
+            samples[offset] = 0;
             *pix++ = 0.0, *pix++ = 0.0, *pix++ = 0.0, *pix++ = 1.0;
           }
           else
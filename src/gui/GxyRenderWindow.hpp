@@ -106,4 +106,5 @@ private:
   int* frameids = NULL;
   int* negative_frameids = NULL;
   long* frame_times = NULL;
+  int* samples = NULL;
 };
@@ -26,6 +26,7 @@
 using namespace std;
 
 #include <string.h>
+#include <time.h>
 
 #include "rapidjson/document.h"
 #include "rapidjson/prettywriter.h"
@@ -72,6 +73,130 @@ GuiClientServer::~GuiClientServer()
 {
 }
 
+static double
+milliseconds()
+{
+  timespec s;
+  clock_gettime(CLOCK_MONOTONIC, &s);
+  return 1000.0*s.tv_sec + s.tv_nsec / 1000000.0;
+}
+
+GuiClientServer::ClientWindow::ClientWindow(GuiClientServer *server, string id) : server(server), id(id)
+{
+  visualization = Visualization::NewP();
+  camera = Camera::NewP();
+
+  rendering = GuiRendering::NewP();
+  rendering->SetId(id);
+  rendering->SetHandler(server);
+
+  renderingSet = RenderingSet::NewP();
+  renderingSet->AddRendering(rendering);
+
+  frame = 0;
+
+  pending = false;
+  quit = false;
+  last_request = 0;
+  debounce = getenv("GXY_RENDER_DEBOUNCE") ? atof(getenv("GXY_RENDER_DEBOUNCE")) : 10.0;
+
+  pthread_mutex_init(&lock, NULL);
+  pthread_cond_init(&cond, NULL);
+  pthread_create(&tid, NULL, render_thread, (void *)this);
+}
+
+GuiClientServer::ClientWindow::~ClientWindow()
+{
+  Lock();
+  quit = true;
+  pthread_cond_signal(&cond);
+  Unlock();
+
+  pthread_join(tid, NULL);
+
+  // Stop pixels of a frame still in flight from being sent for a window 
+  // that's gone
+
+  if (frame > 0)
+    server->renderer->Cancel(renderingSet, frame + 1);
+
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&lock);
+}
+
+void
+GuiClientServer::ClientWindow::RequestRender()
+{
+  Lock();
+  pending = true;
+  last_request = milliseconds();
+  pthread_cond_signal(&cond);
+  Unlock();
+}
+
+void *
+GuiClientServer::ClientWindow::render_thread(void *d)
+{
+  ClientWindow *w = (ClientWindow *)d;
+
+  w->Lock();
+
+  while (! w->quit)
+  {
+    if (! w->pending)
+    {
+      pthread_cond_wait(&w->cond, &w->lock);
+      continue;
+    }
+
+    // Wait until requests stop arriving for the debounce interval; only 
+    // the latest matters
+
+    double wait = (w->last_request + w->debounce) - milliseconds();
+    if (wait > 0)
+    {
+      timespec t;
+      clock_gettime(CLOCK_REALTIME, &t);
+      long ns = t.tv_nsec + (long)(wait * 1000000.0);
+      t.tv_sec += ns / 1000000000;
+      t.tv_nsec = ns % 1000000000;
+      pthread_cond_timedwait(&w->cond, &w->lock, &t);
+      continue;
+    }
+
+    w->pending = false;
+    w->start_render();
+  }
+
+  w->Unlock();
+  pthread_exit(NULL);
+}
+
+void
+GuiClientServer::ClientWindow::start_render()
+{
+  // NeedInitialRays advances the RenderingSet to the next frame
+
+  int fnum = ++frame;
+
+  // Whatever earlier frame is still in flight is abandoned everywhere before
+  // the new one starts
+
+  if (fnum > 1)
+    server->renderer->Cancel(renderingSet, fnum);
+
+  rendering->SetTheSize(camera->get_width(), camera->get_height());
+  rendering->SetTheCamera(camera);
+  rendering->SetTheVisualization(visualization);
+  rendering->SetTheDatasets(datasets);
+  rendering->Commit();
+
+  renderingSet->SetRenderFrame(fnum - 1);
+  renderingSet->Commit();
+
+  server->renderer->Start(renderingSet);
+}
+
 static std::string 
 DocumentToString(rapidjson::Document& doc)
 {
@@ -315,7 +440,7 @@ GuiClientServer::handle(string line, string& reply)
     if (clientWindow)
       HANDLED_BUT_ERROR_RETURN("initWindow: window already initialized")
 
-    addClientWindow(id, new ClientWindow(id));
+    addClientWindow(id, new ClientWindow(this, id));
 
     HANDLED_OK;
   }
@@ -326,15 +451,15 @@ GuiClientServer::handle(string line, string& reply)
     if (! clientWindow)
       HANDLED_BUT_ERROR_RETURN("initWindow: window has not been initialized");
 
-    clientWindow->visualization  = Visualization::NewP();
-    clientWindow->datasets       = Datasets::NewP();
+    VisualizationP visualization = Visualization::NewP();
+    DatasetsP datasets = Datasets::NewP();
 
-    if (! clientWindow->visualization->LoadFromJSON(doc["Visualization"]))
+    if (! visualization->LoadFromJSON(doc["Visualization"]))
       HANDLED_BUT_ERROR_RETURN("visualization: error in LoadFromJson");
 
-    for (int i = 0; i < clientWindow->visualization->GetNumberOfVis(); i++)
+    for (int i = 0; i < visualization->GetNumberOfVis(); i++)
     {
-      auto v = clientWindow->visualization->GetVis(i);
+      auto v = visualization->GetVis(i);
 
       KeyedDataObjectP kdop = temporaries->Find(v->GetName());
       if (! kdop)
@@ -349,11 +474,17 @@ GuiClientServer::handle(string line, string& reply)
 
       v->SetTheData(kdop);
 
-      clientWindow->datasets->Insert(v->GetName(), kdop);
+      datasets->Insert(v->GetName(), kdop);
     }
 
-    clientWindow->datasets->Commit();
-    clientWindow->visualization->Commit(clientWindow->datasets);
+    clientWindow->Lock();
+
+    datasets->Commit();
+    visualization->Commit(datasets);
+
+    clientWindow->visualization = visualization;
+    clientWindow->datasets = datasets;
+    clientWindow->Unlock();
 
     HANDLED_OK;
   }
@@ -365,10 +496,16 @@ GuiClientServer::handle(string line, string& reply)
     if (! clientWindow)
       HANDLED_BUT_ERROR_RETURN("camera: window has not been initialized");
 
-    if (! clientWindow->camera->LoadFromJSON(doc["Camera"]))
-      HANDLED_BUT_ERROR_RETURN("camera: error in LoadFromJson");
+    clientWindow->Lock();
+
+    bool ok = clientWindow->camera->LoadFromJSON(doc["Camera"]);
+    if (ok)
+      clientWindow->camera->Commit();
 
-    clientWindow->camera->Commit();
+    clientWindow->Unlock();
+
+    if (! ok)
+      HANDLED_BUT_ERROR_RETURN("camera: error in LoadFromJson");
 
     HANDLED_OK;
   }
@@ -380,31 +517,10 @@ GuiClientServer::handle(string line, string& reply)
     if (! clientWindow)
       HANDLED_BUT_ERROR_RETURN("render: window has not been initialized");
     
-    GuiRenderingP rendering = GuiRendering::NewP();
-    clientWindow->renderingSet = RenderingSet::NewP();
-    clientWindow->renderingSet->SetRenderFrame(clientWindow->frame++);
-
-    CameraP camera = clientWindow->camera;
-    rendering->SetTheSize(camera->get_width(), camera->get_height());
-
-    float px, py, pz, dx, dy, dz;
-    camera->get_viewpoint(px, py, pz);
-    camera->get_viewdirection(dx, dy, dz);
-    std::cerr << px << " " << py << " " << pz << " :: " << dx << " " << dy << " " << dz << "\n";
-
-    rendering->SetTheCamera(camera);
-
-    rendering->SetHandler(this);
-    rendering->SetTheVisualization(clientWindow->visualization);
-    rendering->SetTheDatasets(clientWindow->datasets);
-    rendering->SetId(id);
-    rendering->Commit();
-
-    clientWindow->renderingSet->AddRendering(rendering);
-    clientWindow->renderingSet->SetRenderFrame(clientWindow->frame++);
-    clientWindow->renderingSet->Commit();
+    // Coalesced with any other requests for the window, and started
+    // by the window's render thread
 
-    renderer->Start(clientWindow->renderingSet);
+    clientWindow->RequestRender();
 
     HANDLED_OK;
   }
@@ -24,6 +24,7 @@
 #include <vector>
 #include <memory>
 #include <sstream>
+#include <pthread.h>
 
 #include "rapidjson/document.h"
 
@@ -41,21 +42,23 @@ namespace gxy
 
 class GuiClientServer : public MultiServerHandler
 {
+  //! the render session of a client window
+  /*! The Rendering and RenderingSet are created once and reused for every
+   * frame.   Render requests are coalesced: a thread waits until no request has
+   * arrived for GXY_RENDER_DEBOUNCE milliseconds (default 10), cancels the frame
+   * still in flight, if any, and starts the newest.
+   */
   struct ClientWindow
   {
-    ClientWindow(string id)
-    {
-      visualization = Visualization::NewP();
-      camera = Camera::NewP();
-
-      rendering = GuiRendering::NewP();
-      rendering->SetId(id);
+    ClientWindow(GuiClientServer *server, string id);
+    ~ClientWindow();
 
-      renderingSet = RenderingSet::NewP();
-      renderingSet->AddRendering(rendering);
+    //! ask for a frame of the window's current state
+    void RequestRender();
 
-      frame = 0;
-    }
+    //! hold off starting a frame while the window's state is changed
+    void Lock() { pthread_mutex_lock(&lock); }
+    void Unlock() { pthread_mutex_unlock(&lock); }
 
     VisualizationP   visualization;
     CameraP          camera;
@@ -64,6 +67,23 @@ class GuiClientServer : public MultiServerHandler
     DatasetsP        datasets;
 
     int frame;
+
+  private:
+    static void *render_thread(void *);
+
+    // Called with the lock held
+    void start_render();
+
+    GuiClientServer *server;
+    std::string id;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    pthread_t       tid;
+
+    bool   pending, quit;
+    double last_request;
+    double debounce;
   };
     
   
@@ -0,0 +1,174 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+/*! \file ShmTransport.h
+ *  \brief the shared-memory segment through which a simulation process on the 
+ *  same node as a Galaxy process hands it timesteps of a volume without copying
+ *
+ *  Galaxy creates one segment per process and variable, named by 
+ *  ShmSegmentName from the process's connection port and the variable name.  
+ *  The segment holds a ShmHeader followed by GXY_SHM_SLOTS page-aligned slots, 
+ *  each holding a full local partition.   Timesteps are numbered from 1; step n 
+ *  goes in slot (n-1) % GXY_SHM_SLOTS.   The simulation may write step n once 
+ *  n <= released, and announces it by setting written to n.   Galaxy maps the 
+ *  slot directly as the volume's samples; as each step is swapped in it advances
+ *  released past the steps it no longer references - one slot is being rendered,
+ *  one retired by the last swap, and one is free to be written.
+ *
+ *  A simulation process uses the segment like this:
+ *
+ *    ShmHeader *hdr = ShmAttach(ShmSegmentName(port, name), fd, size);
+ *    for (uint64_t n = 1; ...; n++)
+ *    {
+ *      send "accept <name>;" to the server
+ *      while (n > hdr->released) wait
+ *      fill ShmSlot(hdr, n)
+ *      hdr->written = n;
+ *    }
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace gxy
+{
+
+#define GXY_SHM_MAGIC  0x47585953
+#define GXY_SHM_SLOTS  3
+#define GXY_SHM_PAGE   4096
+
+//! header at the start of a shared-memory timestep segment
+struct ShmHeader
+{
+  std::atomic<uint32_t> magic;      //!< GXY_SHM_MAGIC, set by Galaxy once the segment is laid out
+  uint32_t              nslots;     //!< number of slots
+  uint64_t              slot_size;  //!< bytes in each slot, a multiple of GXY_SHM_PAGE
+  std::atomic<uint64_t> written;    //!< last step written by the simulation
+  std::atomic<uint64_t> released;   //!< last step the simulation may write
+};
+
+//! name of the segment for the given variable of the process listening on the given port
+inline std::string
+ShmSegmentName(int port, std::string variable)
+{
+  std::stringstream ss;
+  ss << "/gxy-" << port << "-" << variable;
+  return ss.str();
+}
+
+//! bytes in a slot able to hold the given number of bytes
+inline uint64_t ShmSlotSize(uint64_t bytes) { return ((bytes + GXY_SHM_PAGE - 1) / GXY_SHM_PAGE) * GXY_SHM_PAGE; }
+
+//! bytes in a segment with slots of the given size
+inline uint64_t ShmSegmentSize(uint64_t slot_size) { return GXY_SHM_PAGE + GXY_SHM_SLOTS*slot_size; }
+
+//! the slot holding step n
+inline unsigned char *
+ShmSlot(ShmHeader *hdr, uint64_t n)
+{
+  return ((unsigned char *)hdr) + GXY_SHM_PAGE + ((n - 1) % hdr->nslots)*hdr->slot_size;
+}
+
+//! create (Galaxy side) a segment able to hold steps of the given size, NULL on failure
+inline ShmHeader *
+ShmCreate(std::string name, uint64_t bytes, int& fd, uint64_t& size)
+{
+  uint64_t slot_size = ShmSlotSize(bytes);
+  size = ShmSegmentSize(slot_size);
+
+  shm_unlink(name.c_str());
+  fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+  if (fd < 0)
+    return NULL;
+
+  void *base = MAP_FAILED;
+  if (ftruncate(fd, size) == 0)
+    base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  if (base == MAP_FAILED)
+  {
+    close(fd);
+    shm_unlink(name.c_str());
+    return NULL;
+  }
+
+  ShmHeader *hdr = (ShmHeader *)base;
+  hdr->nslots    = GXY_SHM_SLOTS;
+  hdr->slot_size = slot_size;
+  hdr->written   = 0;
+  hdr->released  = GXY_SHM_SLOTS;
+  hdr->magic     = GXY_SHM_MAGIC;
+
+  return hdr;
+}
+
+//! attach (simulation side) to an existing segment, NULL if it is not (yet) ready
+inline ShmHeader *
+ShmAttach(std::string name, int& fd, uint64_t& size)
+{
+  fd = shm_open(name.c_str(), O_RDWR, 0600);
+  if (fd < 0)
+    return NULL;
+
+  struct stat st;
+  void *base = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size >= GXY_SHM_PAGE)
+  {
+    size = st.st_size;
+    base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+
+  if (base == MAP_FAILED)
+  {
+    close(fd);
+    return NULL;
+  }
+
+  ShmHeader *hdr = (ShmHeader *)base;
+  if (hdr->magic != GXY_SHM_MAGIC)
+  {
+    munmap(base, size);
+    close(fd);
+    return NULL;
+  }
+
+  return hdr;
+}
+
+//! unmap a segment, and if its creator, remove it
+inline void
+ShmDetach(ShmHeader *hdr, std::string name, int fd, uint64_t size, bool creator)
+{
+  munmap((void *)hdr, size);
+  close(fd);
+  if (creator)
+    shm_unlink(name.c_str());
+}
+
+} // namespace gxy
@@ -18,7 +18,9 @@
 //                                                                            //
 // ========================================================================== //
 
+#include <algorithm>
 #include <iostream>
+#include <set>
 #include <sstream>
 #include <cstdio>
 
@@ -52,7 +54,15 @@ SocketConnector::Register()
 
 KEYED_OBJECT_CLASS_TYPE(SocketConnector)
 
-SocketConnector::~SocketConnector() {}
+SocketConnector::~SocketConnector()
+{
+  Renderer::RemoveFrameStartHook(getkey());
+  stop_receiver();
+  release_segments(false, MPI_COMM_NULL);
+
+  for (auto b : spare) free(b.second);
+  for (auto b : retired) free(b.second);
+}
 
 void
 SocketConnector::initialize()
@@ -73,7 +83,7 @@ SocketConnector::findVariable(std::string name)
 int
 SocketConnector::serialSize()
 {
-  return super::serialSize() + 2*sizeof(int);
+  return super::serialSize() + 3*sizeof(int);
 }
 
 unsigned char *
@@ -87,6 +97,9 @@ SocketConnector::serialize(unsigned char *p)
   *(int *)p = wait_time;
   p += sizeof(int);
 
+  *(int *)p = (int)transport;
+  p += sizeof(int);
+
   return p;
 }
 
@@ -101,6 +114,9 @@ SocketConnector::deserialize(unsigned char *p)
   wait_time = *(int *)p;
   p += sizeof(int);
 
+  transport = (Transport)*(int *)p;
+  p += sizeof(int);
+
   return p;
 }
 
@@ -120,29 +136,103 @@ SocketConnector::has(std::string name)
 void
 SocketConnector::Open()
 {
+  Renderer::AddFrameStartHook(getkey(), [this]() { frame_start(); });
+
   ConnectionMsg msg(this, ConnectionMsg::Open);
   msg.Broadcast(true, false);
 }
 
+// Steps still waiting for a frame are swapped in before closing, whether or
+// not a frame is being rendered
+
 void
 SocketConnector::Close()
 {
+  Renderer::RemoveFrameStartHook(getkey());
+
+  pthread_mutex_lock(&ready_lock);
+
+  for (auto v : ready)
+  {
+    ConnectionMsg msg(this, v, ConnectionMsg::Swap);
+    msg.Broadcast(true, false);
+  }
+
+  ready.clear();
+  rendering = false;
+
+  pthread_mutex_unlock(&ready_lock);
+
   ConnectionMsg msg(this, ConnectionMsg::Close);
   msg.Broadcast(true, false);
 }
 
+// At the root, have everyone swap in a step of a volume that has arrived (or
+// failed to).   Once frames are being rendered, swapping waits for the next 
+// to be started so that the samples don't change under one in progress.   
+// Until then there's no frame to disturb and it's done at once.
+
+void
+SocketConnector::step_ready(VolumeP volume)
+{
+  pthread_mutex_lock(&ready_lock);
+
+  if (rendering)
+    ready.push_back(volume);
+  else
+  {
+    ConnectionMsg msg(this, volume, ConnectionMsg::Swap);
+    msg.Broadcast(true, false);
+  }
+
+  pthread_mutex_unlock(&ready_lock);
+}
+
+// Called at the root as a frame is started, before its RenderMsg is sent.
+// Swaps in the oldest waiting step of each volume.   Only one per volume, 
+// since a second would free the samples the previous frame may still be 
+// tracing through; the rest wait for later frames.
+
+void
+SocketConnector::frame_start()
+{
+  pthread_mutex_lock(&ready_lock);
+
+  rendering = true;
+
+  std::set<Key> swapped;
+  for (auto v = ready.begin(); v != ready.end(); )
+    if (swapped.insert((*v)->getkey()).second)
+    {
+      ConnectionMsg msg(this, *v, ConnectionMsg::Swap);
+      msg.Broadcast(true, false);
+      v = ready.erase(v);
+    }
+    else
+      v++;
+
+  pthread_mutex_unlock(&ready_lock);
+}
+
 bool
 SocketConnector::local_open(MPI_Comm c)
 {
   sskt = vtkServerSocket::New();
   sskt->CreateServer(port + GetTheApplication()->GetRank()) ;
 
+  kill_receiver = false;
+  if (pthread_create(&socket_t, NULL, receiver_thread, (void *)this) == 0)
+    receiver_running = true;
+
   return false;
 }
 
 bool
 SocketConnector::local_close(MPI_Comm c)
 {
+  stop_receiver();
+  release_segments(true, c);
+
   if (sskt)
   {
     sskt->CloseSocket();
@@ -154,52 +244,333 @@ SocketConnector::local_close(MPI_Comm c)
 }
 
 void
-SocketConnector::Accept(VolumeP var)
+SocketConnector::Accept(VolumeP var, std::string name)
 {
   waiter.busy = true;
   
-  ConnectionMsg msg(this, var, ConnectionMsg::Accept);
+  ConnectionMsg msg(this, var, ConnectionMsg::Accept, name);
   msg.Broadcast(true, false);
 }
 
-bool SocketConnector::local_accept(MPI_Comm c, VolumeP volume)
+// Queue a transfer of the local partition of the next timestep of a volume
+// to the receiver thread.   Returns without waiting for it.   With the SHM
+// transport, the volume's segment is created on its first accept.
+
+bool SocketConnector::local_accept(MPI_Comm c, VolumeP volume, std::string name)
+{
+  int i,j,k;
+  volume->get_ghosted_local_counts(i, j, k);
+
+  transfer *t = new transfer;
+  t->volume = volume;
+  t->size   = size_t(i)*j*k * (volume->isFloat() ? sizeof(float) : sizeof(unsigned char)) * volume->get_number_of_components();
+  t->done   = false;
+  t->ok     = false;
+  t->shm    = NULL;
+  t->seq    = 0;
+
+  pthread_mutex_lock(&transfer_lock);
+
+  auto s = spare.find(volume->getkey());
+  if (transport == SHM)
+  {
+    segment& seg = segments[volume->getkey()];
+    if (! seg.hdr)
+    {
+      seg.volume   = volume;
+      seg.name     = ShmSegmentName(local_port, name);
+      seg.bytes    = t->size;
+      seg.accepted = 0;
+      seg.hdr      = ShmCreate(seg.name, seg.bytes, seg.fd, seg.size);
+      if (! seg.hdr)
+        std::cerr << "error... unable to create shared memory segment " << seg.name << "\n";
+    }
+
+    t->buffer = NULL;
+    t->shm    = seg.hdr;
+    t->seq    = ++seg.accepted;
+
+    if (! t->shm)
+      t->done = true;
+  }
+  else if (s != spare.end())
+  {
+    t->buffer = s->second;
+    spare.erase(s);
+  }
+  else
+  {
+    // Page-aligned so the kernel can copy straight into it
+
+    void *b;
+    if (posix_memalign(&b, 4096, t->size))
+      b = NULL;
+    t->buffer = (unsigned char *)b;
+  }
+
+  if ((! t->buffer && ! t->shm) || ! receiver_running)
+  {
+    std::cerr << "error... unable to accept time step\n";
+    t->done = true;
+  }
+
+  transfers.push_back(t);
+  pthread_cond_broadcast(&transfer_cond);
+
+  bool failed = t->done;
+
+  pthread_mutex_unlock(&transfer_lock);
+
+  // The receiver thread won't take up a transfer that failed here, so if 
+  // it's the root's, nothing would follow it with the Swap that discards the 
+  // step everywhere and releases the waiter.   Do so now.
+
+  if (failed && GetTheApplication()->GetRank() == 0)
+    step_ready(volume);
+
+  return false;
+}
+
+void *
+SocketConnector::receiver_thread(void *p)
 {
-  vtkClientSocket *cskt = sskt->WaitForConnection(wait_time);
+  SocketConnector *me = (SocketConnector *)p;
 
-  int allflag, flag = cskt == NULL  ? 0 : 1;
-  MPI_Allreduce(&flag, &allflag, 1, MPI_INT, MPI_MIN, c);
+  pthread_mutex_lock(&me->transfer_lock);
+
+  while (! me->kill_receiver)
+  {
+    transfer *t = NULL;
+    for (auto x : me->transfers)
+      if (! x->done)
+      {
+        t = x;
+        break;
+      }
+
+    if (! t)
+    {
+      pthread_cond_wait(&me->transfer_cond, &me->transfer_lock);
+      continue;
+    }
+
+    pthread_mutex_unlock(&me->transfer_lock);
+    bool ok = me->receive(t);
+    pthread_mutex_lock(&me->transfer_lock);
+
+    t->ok = ok;
+    t->done = true;
+    pthread_cond_broadcast(&me->transfer_cond);
+
+    // When the root has its partition, the rest should be arriving too; 
+    // have everyone swap the received step in between frames
+
+    if (GetTheApplication()->GetRank() == 0 && ! me->kill_receiver)
+    {
+      VolumeP volume = t->volume;
+      pthread_mutex_unlock(&me->transfer_lock);
+
+      me->step_ready(volume);
+
+      pthread_mutex_lock(&me->transfer_lock);
+    }
+  }
 
-  if (allflag == 0)
+  pthread_mutex_unlock(&me->transfer_lock);
+  pthread_exit(NULL);
+}
+
+// Receive a transfer's timestep.  The connection is polled so that closing 
+// the connector need not wait out the full wait time.
+
+bool
+SocketConnector::receive(transfer *t)
+{
+  if (t->shm)
+  {
+    for (int waited = 0; t->shm->written < t->seq && waited < wait_time && !kill_receiver; waited++)
+      usleep(1000);
+
+    if (t->shm->written < t->seq)
+      return false;
+
+    t->buffer = ShmSlot(t->shm, t->seq);
+    return true;
+  }
+
+  if (! t->buffer)
     return false;
 
-  float min, max;
-  int point_count;
+  vtkClientSocket *cskt = NULL;
+  for (int waited = 0; !cskt && waited < wait_time && !kill_receiver; waited += 100)
+    cskt = sskt->WaitForConnection(100);
 
-  int i,j,k;
-  volume->get_ghosted_local_counts(i, j, k);
+  if (! cskt)
+    return false;
 
-  int sz = i*j*k * (volume->isFloat() ? sizeof(float) : sizeof(unsigned char)) * volume->get_number_of_components();
+  bool ok = true;
 
-  if (! cskt->Receive(volume->get_samples(), sz, 1))
+  if (! cskt->Receive(t->buffer, t->size, 1))
   {
     std::cerr << "error... unable to read time step\n";
-    exit(0);
+    ok = false;
   }
-
-  int one = 1;
-  if (! cskt->Send(&one, sizeof(one)))
+  else
   {
-    std::cerr << "error... sending ack\n";
-    exit(0);
+    int one = 1;
+    if (! cskt->Send(&one, sizeof(one)))
+    {
+      std::cerr << "error... sending ack\n";
+      ok = false;
+    }
   }
 
   cskt->CloseSocket();
   cskt->Delete();
 
+  return ok;
+}
+
+void
+SocketConnector::stop_receiver()
+{
+  if (! receiver_running)
+    return;
+
+  pthread_mutex_lock(&transfer_lock);
+  kill_receiver = true;
+  pthread_cond_broadcast(&transfer_cond);
+  pthread_mutex_unlock(&transfer_lock);
+
+  pthread_join(socket_t, NULL);
+  receiver_running = false;
+
+  // Anything still pending will never arrive
+
+  pthread_mutex_lock(&transfer_lock);
+  for (auto t : transfers)
+    t->done = true;
+  pthread_cond_broadcast(&transfer_cond);
+  pthread_mutex_unlock(&transfer_lock);
+}
+
+bool
+SocketConnector::in_segment(unsigned char *p)
+{
+  for (auto& s : segments)
+    if (s.second.hdr && p >= (unsigned char *)s.second.hdr && p < ((unsigned char *)s.second.hdr) + s.second.size)
+      return true;
+
   return false;
 }
 
-SocketConnector::ConnectionMsg::ConnectionMsg(SocketConnector* s, VolumeP v, todo t) : ConnectionMsg(2*sizeof(Key) + sizeof(todo))
+// Give volumes that are rendering from shared memory their own copies of 
+// their samples and drop the segments.   When closing, the volumes are 
+// recommitted collectively; from the destructor they are just marked modified.
+
+void
+SocketConnector::release_segments(bool commit, MPI_Comm c)
+{
+  for (auto& s : segments)
+  {
+    segment& seg = s.second;
+    if (! seg.hdr)
+      continue;
+
+    if (in_segment(seg.volume->get_samples()))
+    {
+      unsigned char *copy = (unsigned char *)malloc(seg.bytes);
+      memcpy(copy, seg.volume->get_samples(), seg.bytes);
+      seg.volume->swap_samples(copy, true);
+
+      if (commit)
+        seg.volume->local_commit(c);
+      else
+        seg.volume->setModified(true);
+    }
+
+    if (retired.count(s.first) && in_segment(retired[s.first]))
+      retired.erase(s.first);
+  }
+
+  for (auto& s : segments)
+    if (s.second.hdr)
+      ShmDetach(s.second.hdr, s.second.name, s.second.fd, s.second.size, true);
+
+  segments.clear();
+}
+
+// Install the oldest received timestep of a volume as its samples, if every 
+// process received its partition, and commit it.
+
+bool
+SocketConnector::local_swap(MPI_Comm c, VolumeP volume)
+{
+  pthread_mutex_lock(&transfer_lock);
+
+  transfer *t = NULL;
+  for (auto x : transfers)
+    if (x->volume->getkey() == volume->getkey())
+    {
+      t = x;
+      break;
+    }
+
+  while (t && ! t->done)
+    pthread_cond_wait(&transfer_cond, &transfer_lock);
+
+  pthread_mutex_unlock(&transfer_lock);
+
+  int allflag, flag = (t && t->ok) ? 1 : 0;
+  MPI_Allreduce(&flag, &allflag, 1, MPI_INT, MPI_MIN, c);
+
+  if (! t)
+    return false;
+
+  pthread_mutex_lock(&transfer_lock);
+
+  for (auto x = transfers.begin(); x != transfers.end(); x++)
+    if (*x == t)
+    {
+      transfers.erase(x);
+      break;
+    }
+
+  Key key = volume->getkey();
+  unsigned char *unused = t->buffer;
+
+  if (allflag)
+  {
+    unused = retired.count(key) ? retired[key] : NULL;
+    retired[key] = volume->swap_samples(t->buffer, t->shm == NULL);
+
+    // Everything before the retired step is free to be overwritten
+
+    if (t->shm)
+      t->shm->released = std::max(uint64_t(t->shm->nslots), t->seq + 1);
+  }
+
+  // Slots belong to the segment; only malloc'ed buffers are recycled
+
+  if (unused && ! in_segment(unused))
+  {
+    if (t->shm)
+      free(unused);
+    else
+    {
+      if (spare.count(key)) free(spare[key]);
+      spare[key] = unused;
+    }
+  }
+
+  pthread_mutex_unlock(&transfer_lock);
+
+  delete t;
+
+  return allflag ? volume->local_commit(c) : false;
+}
+
+SocketConnector::ConnectionMsg::ConnectionMsg(SocketConnector* s, VolumeP v, todo t, std::string name) : ConnectionMsg(2*sizeof(Key) + sizeof(todo) + name.length() + 1)
 {
   unsigned char *p = contents->get();
 
@@ -210,9 +581,12 @@ SocketConnector::ConnectionMsg::ConnectionMsg(SocketConnector* s, VolumeP v, tod
   p += sizeof(Key);
 
   *(todo *)p = t;
+  p += sizeof(todo);
+
+  memcpy(p, name.c_str(), name.length() + 1);
 }
 
-SocketConnector::ConnectionMsg::ConnectionMsg(SocketConnector* s, todo t) : ConnectionMsg(2*sizeof(Key) + sizeof(todo))
+SocketConnector::ConnectionMsg::ConnectionMsg(SocketConnector* s, todo t) : ConnectionMsg(2*sizeof(Key) + sizeof(todo) + 1)
 {
   unsigned char *p = contents->get();
 
@@ -223,6 +597,9 @@ SocketConnector::ConnectionMsg::ConnectionMsg(SocketConnector* s, todo t) : Conn
   p += sizeof(Key);
 
   *(todo *)p = t;
+  p += sizeof(todo);
+
+  *p = 0;
 }
 
 bool SocketConnector::ConnectionMsg::CollectiveAction(MPI_Comm comm, bool is_root)
@@ -240,6 +617,9 @@ bool SocketConnector::ConnectionMsg::CollectiveAction(MPI_Comm comm, bool is_roo
     v = Volume::GetByKey(vkey);
 
   todo t = *(todo *)p;
+  p += sizeof(todo);
+
+  std::string name((char *)p);
 
   bool r;
   std::string s;
@@ -255,9 +635,13 @@ bool SocketConnector::ConnectionMsg::CollectiveAction(MPI_Comm comm, bool is_roo
       s = "close";
       break;
     case Accept:
-      r = c->local_accept(comm, v);
+      r = c->local_accept(comm, v, name);
       s = "accept";
       break;
+    case Swap:
+      r = c->local_swap(comm, v);
+      s = "swap";
+      break;
   }
 
   /*
@@ -313,13 +697,19 @@ bool SocketConnector::ConnectionMsg::CollectiveAction(MPI_Comm comm, bool is_roo
   This also enables the caller to wait for the transfer to complete
   so that it can single buffer.
 
+  Now that the transfer itself is done by the receiver thread, the
+  Accept returns at once and the transfer completes with the Swap
+  that installs the received data, so that's where the waiter is
+  released.   While frames are being rendered, that waits for the
+  next frame to start.
+
   */
 
   Waiter *waiter = &c->waiter;
 
   c = NULL;
   
-  if (is_root)
+  if (is_root && t != Accept)
   {
     pthread_mutex_lock(&waiter->lock);
     waiter->busy = false;
@@ -22,11 +22,28 @@
  *  \brief manage a socket connection between each process and processes of an 
  *  external process - eg. a parallel simulation.   The SocketConnection expects
  *  to receive a set of volumes, each defined on a similar regular grid.
+ *
+ *  Timesteps are received in the background.  Accept() queues a transfer to a
+ *  receiver thread on each process, which receives the local partition into a
+ *  back buffer and acknowledges it, freeing the simulation to go on to the next
+ *  step.  Once the root has its partition, it broadcasts a swap that, on every 
+ *  process, installs the received buffer as the volume's samples and commits 
+ *  it.   Rendering therefore goes on with the previous step while the next is 
+ *  received, and never sees a partly received step.   Buffers rotate through 
+ *  three roles - being rendered, retired by the last swap (and possibly still 
+ *  referenced by the renderer until the volume is next rebuilt), and being 
+ *  received into.
+ *
+ *  With the SHM transport, a simulation process on the same node writes each 
+ *  timestep into a shared-memory segment (see ShmTransport.h) and the received
+ *  buffer is the segment's slot itself, so nothing is copied.
  */
 
 #pragma once
 
+#include <deque>
 #include <iostream>
+#include <map>
 #include <sstream>
 
 #include <string.h>
@@ -41,6 +58,8 @@
 
 #include "Application.h"
 #include "Datasets.h"
+#include "Renderer.h"
+#include "ShmTransport.h"
 #include "Volume.h"
 
 namespace gxy
@@ -72,7 +91,36 @@ class SocketConnector : public KeyedObject
     bool busy;
   };
 
+  // A timestep being received into a back buffer for a volume
+
+  struct transfer
+  {
+    VolumeP volume;
+    unsigned char *buffer;
+    size_t size;
+    bool done;
+    bool ok;
+    ShmHeader *shm;     // if the step arrives through shared memory, its segment
+    uint64_t seq;       // ... and its number there
+  };
+
+  // A shared-memory segment through which steps of a volume arrive
+
+  struct segment
+  {
+    VolumeP volume;
+    std::string name;
+    ShmHeader *hdr = NULL;
+    int fd;
+    uint64_t size;
+    uint64_t bytes;     // size of a step
+    uint64_t accepted;  // steps accepted so far
+  };
+
 public:
+  //! how timesteps reach Galaxy
+  enum Transport { SOCKET, SHM };
+
   virtual ~SocketConnector();
   virtual void initialize();
 
@@ -82,7 +130,7 @@ public:
 
   void Wait() { waiter.Wait(); }
   void Open();
-  void Accept(VolumeP);
+  void Accept(VolumeP, std::string name = "");
   void Close();
 
   bool has(std::string);
@@ -94,6 +142,9 @@ public:
   void set_wait(int w) { wait_time = w; }
   int get_wait() { return wait_time; }
 
+  void set_transport(Transport t) { transport = t; }
+  Transport get_transport() { return transport; }
+
   virtual int serialSize(); 
   virtual unsigned char *serialize(unsigned char *); 
   virtual unsigned char *deserialize(unsigned char *); 
@@ -108,7 +159,17 @@ protected:
 
   bool local_open(MPI_Comm c);
   bool local_close(MPI_Comm c);
-  bool local_accept(MPI_Comm c, VolumeP v);
+  bool local_accept(MPI_Comm c, VolumeP v, std::string name);
+  bool local_swap(MPI_Comm c, VolumeP v);
+
+  static void *receiver_thread(void *);
+  bool receive(transfer *);
+  void stop_receiver();
+  bool in_segment(unsigned char *);
+  void release_segments(bool commit, MPI_Comm c);
+
+  void step_ready(VolumeP);
+  void frame_start();
 
   int wait_time = 100000;  // msec
 
@@ -119,15 +180,33 @@ protected:
   int port = 1900;
   int local_port;
 
+  Transport transport = SOCKET;
+  std::map<Key, segment> segments;
+
   pthread_t socket_t;
+  bool receiver_running = false;
+  bool kill_receiver = false;
+
+  pthread_mutex_t transfer_lock = PTHREAD_MUTEX_INITIALIZER;
+  pthread_cond_t transfer_cond = PTHREAD_COND_INITIALIZER;
+  std::deque<transfer *> transfers;
+
+  std::map<Key, unsigned char *> spare;     // buffers free to receive into, by volume
+  std::map<Key, unsigned char *> retired;   // buffers replaced by the last swap, by volume
+
+  // At the root, steps that have arrived but wait for the next frame to be swapped in
+
+  pthread_mutex_t ready_lock = PTHREAD_MUTEX_INITIALIZER;
+  std::deque<VolumeP> ready;
+  bool rendering = false;   // whether a frame has been started since the connector opened
 
   class ConnectionMsg : public Work
   {
   public:
-    enum todo {Open, Close, Accept};
+    enum todo {Open, Close, Accept, Swap};
 
     ConnectionMsg(SocketConnector* s, todo t);
-    ConnectionMsg(SocketConnector* s, VolumeP v, todo t);
+    ConnectionMsg(SocketConnector* s, VolumeP v, todo t, std::string name = "");
 
     WORK_CLASS(ConnectionMsg, true);
 
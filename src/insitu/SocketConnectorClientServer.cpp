@@ -95,6 +95,12 @@ SocketConnectorClientServer::handle(string line, string& reply)
     connector = SocketConnector::NewP();
     connector->set_port(1900);                      // Each participant will bump this by their rank!
 
+    // Simulation processes sharing nodes with Galaxy processes can hand
+    // over timesteps through shared memory rather than sockets
+
+    if (json.HasMember("transport") && std::string(json["transport"].GetString()) == "shm")
+      connector->set_transport(SocketConnector::SHM);
+
     // For every incoming variable, create as fresh
     // Volume object.   Any operations that refer to
     // a prior value will be OK (I hope)
@@ -134,8 +140,9 @@ SocketConnectorClientServer::handle(string line, string& reply)
 
     if (connector)
     {
-      connector->Accept(variables[arg]);
-      variables[arg]->Commit();
+      // The connector commits the volume when the timestep has arrived
+
+      connector->Accept(variables[arg], arg);
       reply = "ok";
     }
     else
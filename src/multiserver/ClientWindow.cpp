@@ -25,6 +25,12 @@
 #include <pthread.h>
 #include <time.h>
 
+// Streamed tiles are noted in the ager's tile map directly
+
+#if GXY_AGER_TILE_SIZE != GXY_PIXEL_TILE_SIZE
+#error "ClientWindow requires the ager and pixel stream tile sizes to match"
+#endif
+
 namespace gxy
 {
 
@@ -44,17 +50,8 @@ ClientWindow::~ClientWindow()
     free(pixels);       
     pixels = NULL;
 
-    free(negative_pixels);
-    negative_pixels = NULL;
-
     free(frameids);
     frameids = NULL;
-
-    free(negative_frameids);
-    negative_frameids = NULL;
-
-    free(frame_times);
-    frame_times = NULL;
   }
 
 	if (ager_tid != (pthread_t)-1)
@@ -78,10 +75,7 @@ ClientWindow::Connect(std::string host, int port)
 	fadeout           = 1.0;
 
   pixels            = NULL;
-  negative_pixels   = NULL;
   frameids          = NULL;
-  negative_frameids = NULL;
-  frame_times       = NULL;
 
   kill_threads      = false;
 
@@ -119,31 +113,19 @@ ClientWindow::Resize(int w, int h)
   if (pixels)
   {
     free(pixels);
-    free(negative_pixels);
     free(frameids);
-    free(negative_frameids);
-    free(frame_times);
   }
 
   pixels             = (float *)malloc(width*height*4*sizeof(float));
-  negative_pixels    = (float *)malloc(width*height*4*sizeof(float));
   frameids           = (int *)malloc(width*height*sizeof(int));
-  negative_frameids  = (int *)malloc(width*height*sizeof(int));
-  frameids           = (int *)malloc(width*height*sizeof(int));
-  frame_times        = (long *)malloc(width*height*sizeof(long));
 
   memset(frameids, 0, width*height*sizeof(int));
-  memset(negative_frameids, 0, width*height*sizeof(int));
 
-  long now = my_time();
-  for (int i = 0; i < width*height; i++)
-    frame_times[i] = now;
+  frame_time = my_time();
+  ager.Resize(width, height);
 
   for (int i = 0; i < 4*width*height; i++)
-  {
     pixels[i] = (i & 0x3) == 0x3 ? 1.0 : 0.0;
-    negative_pixels[i] = (i & 0x3) == 0x3 ? 1.0 : 0.0;
-  }
 
   std::stringstream wndw;
   wndw << "window " << width << " " << height;
@@ -198,39 +180,33 @@ ClientWindow::ager_thread(void *p)
 	pthread_exit(NULL);
 }
 
+// Stale pixels all date from the start of the current frame, so whether
+// to fade or clear them is decided once per tick.   The lock is taken a
+// row of tiles at a time so arriving tiles are not held up for a whole
+// pass over the image.
+
 void
 ClientWindow::FrameBufferAger()
 {
-	if (pixels && frameids && frame_times)
-	{
-		pthread_mutex_lock(&lock);
-
-		long now = my_time();
-
-		for (int offset = 0; offset < width*height; offset++)
-		{
-			int fid = frameids[offset];
-			if (fid > 0 && fid < current_frame)
-			{
-				long tm = frame_times[offset];
-				float sec = (now - tm) / 1000000000.0;
-
-				float *pix = pixels + (offset*4);
-				if (sec > max_age)
-				{
-					if (sec > (max_age + fadeout))
-					{
-						frame_times[offset] = now;
-						frameids[offset] = current_frame;
-						*pix++ = 0.0, *pix++ = 0.0, *pix++ = 0.0, *pix++ = 1.0;
-					}
-					else
-						*pix++ *= 0.9, *pix++ *= 0.9, *pix++ *= 0.9, *pix++ = 1.0;
-				}
-			}
-		}
+  pthread_mutex_lock(&lock);
+  int nrows = (pixels && frameids) ? ager.GetNumberOfTileRows() : 0;
+  pthread_mutex_unlock(&lock);
+
+  for (int row = 0; row < nrows; row++)
+  {
+    pthread_mutex_lock(&lock);
+
+    // A resize may have taken effect since the row count was read
+
+    float sec = (my_time() - frame_time) / 1000000000.0;
+    bool  age = sec > max_age && row < ager.GetNumberOfTileRows();
+    if (age)
+      ager.AgeTileRow(row, pixels, frameids, current_frame, sec > (max_age + fadeout));
 
     pthread_mutex_unlock(&lock);
+
+    if (! age)
+      break;
   }
 }
 
@@ -248,16 +224,7 @@ ClientWindow::rcvr_thread(void *p)
       if (n <= 0)
         break;
 
-      char *ptr = buf;
-      int knt = *(int *)ptr;
-      ptr += sizeof(int);
-      int frame = *(int *)ptr;
-      ptr += sizeof(int);
-      int sndr = *(int *)ptr;
-      ptr += sizeof(int);
-      Pixel *p = (Pixel *)ptr;
-
-      me->AddPixels(p, knt, frame);
+      me->AddTiles((PixelStreamHeader *)buf, (unsigned char *)(buf + sizeof(PixelStreamHeader)));
   
       free(buf);
     }
@@ -266,160 +233,121 @@ ClientWindow::rcvr_thread(void *p)
 	pthread_exit(NULL);
 }
 
+// Decode a row of quantized pixels into the framebuffer.   Pixels whose fourth
+// channel is 0 have no sample yet in the current frame and are left alone.
+
+static inline int
+decode_row8(const unsigned char *src, float *dst, int *fids, int n, int frame)
+{
+  const float s = 1.0 / 255.0;
+  int k = 0;
+  for (int x = 0; x < n; x++, src += 4, dst += 4)
+    if (src[3])
+    {
+      dst[0] = src[0] * s;
+      dst[1] = src[1] * s;
+      dst[2] = src[2] * s;
+      fids[x] = frame;
+      k++;
+    }
+  return k;
+}
+
+static inline int
+decode_row16(const uint16_t *src, float *dst, int *fids, int n, int frame)
+{
+  int k = 0;
+  for (int x = 0; x < n; x++, src += 4, dst += 4)
+    if (src[3])
+    {
+      dst[0] = HalfToFloat(src[0]);
+      dst[1] = HalfToFloat(src[1]);
+      dst[2] = HalfToFloat(src[2]);
+      fids[x] = frame;
+      k++;
+    }
+  return k;
+}
+
 void
-ClientWindow::AddPixels(Pixel *p, int n, int frame)
+ClientWindow::AddTiles(PixelStreamHeader *hdr, unsigned char *ptr)
 {
 	pthread_mutex_lock(&lock);
 
-  // std::cerr << "n = " << n << " f = " << frame << "\n";
-  // std::cerr << "  p[0]: " << p[0].x << " " << p[0].y << "\n";
-  // std::cerr << "  p[n-1]: " << p[n-1].x << " " << p[n-1].y << "\n";
+  // Tiles of a framebuffer of a different size were sent before a resize took effect
+
+	if (hdr->width != width || hdr->height != height || hdr->frame < current_frame)
+  {
+    pthread_mutex_unlock(&lock);
+    return;
+  }
 
 	long now = my_time();
+	int frame = hdr->frame;
 
-	if (frame >= current_frame)
-	{
-		//  If frame is strictly greater than current_frame then
-		//  updating it will kick the ager to begin aging
-		//  any pixels from prior frames.   We want to start the 
-		//  aging process from the arrival of the first contribution
-		//  to the new frame rather than its updated time.
-		
-		if (frame > current_frame)
-		{
-      this_frame_pixel_count = 0;
-			current_frame = frame;
-
-			for (int offset = 0; offset < width*height; offset++)
-				frame_times[offset] = now;
-		}
-
-		// Only bump current frame IF this is a positive pixel
-
-		for (int i = 0; i < n; i++, p++, this_frame_pixel_count++)
-		{
-      if (p->x < 0 || p->x >= width || p->y < 0 || p->y >= height)
-      {
-        std::cerr << "pixel error: " << p->x << " " << p->y << "\n";
-        exit(1);
-      }
+  //  If frame is strictly greater than current_frame then
+  //  updating it will kick the ager to begin aging
+  //  any pixels from prior frames.   We want to start the 
+  //  aging process from the arrival of the first contribution
+  //  to the new frame rather than its updated time.
+  
+  if (frame > current_frame)
+  {
+    this_frame_pixel_count = 0;
+    current_frame = frame;
+    frame_time = now;
+  }
 
-			size_t offset = p->y*width + p->x;
-			float *pix = pixels + (offset<<2);
-			float *npix = negative_pixels + (offset<<2);
-
-			// If its a sample from the current frame, add it in.
-			// 
-			// If its a sample from a LATER frame then two possibilities:
-			// its a negative sample, in which case we DON'T want to update
-			// the visible pixel, so we stash it. If its a POSITIVE sample
-			// we stuff the visible pixel with the sample and any stashed
-			// negative samples.
-
-      if (frameids[offset] == frame)
-			{
-#if 1
-				*pix++ += p->r;
-				*pix++ += p->g;
-				*pix++ += p->b;
-#else
-				float r = pix[0] + p->r;
-				float g = pix[1] + p->g;
-				float b = pix[2] + p->b;
-
-				if (r < 0.01 && g < 0.01 && b < 0.01)
-					std::cerr << "A last " << pix[0] << " " << pix[1] << " " << pix[2] << "\n"
-										<< "  cont " << p->r << " " << p->g << " " << p->b << "\n"
-										<< "  next " << r << " " << g << " " << b << "\n";
-
-				*pix++ = r;
-				*pix++ = g;
-				*pix++ = b;
-#endif
+  int psz = PixelStreamPixelSize(hdr->format);
 
-			}
-			else
-			{
-        if (p->r < 0.0 || p->g < 0.0 || p->b < 0.0)
-				{
-					// If its a NEGATIVE sample and...
-
-					if (negative_frameids[offset] == frame)
-					{
-						// from the current frame, we add it to the stash
-						*npix++ += p->r;
-						*npix++ += p->g;
-						*npix++ += p->b;
-					}
-					else if (negative_frameids[offset] < frame)
-					{
-						// otherwise its from a LATER frame, so we init the stash so if
-						// we receive any POSITIVE samples we can add it in.
-						negative_frameids[offset] = frame;
-						*npix++ = p->r;
-						*npix++ = p->g;
-						*npix++ = p->b;
-					}
-				}
-				else
-				{
-					// its a POSITIVE sample from a NEW frame, so we stuff the visible
-					// pixel with the new sample and any negative samples that arrived 
-					// first
-					frameids[offset] = frame;
-					// frame_times[offset] = now;
-					if (current_frame == negative_frameids[offset])
-					{
-						*pix++ = (*npix + p->r);
-					  *npix = 0.0;
-					  npix++;
-						*pix++ = (*npix + p->g);
-					  *npix = 0.0;
-					  npix++;
-						*pix++ = (*npix + p->b);
-					  *npix = 0.0;
-					  npix++;
-#if 0
-						if (pix[-3] < 0.01 && pix[-2] < 0.01 && pix[-1] < 0.01) 
-							std::cerr << "B " << p->r << " " << p->g << " " << p->b << "\n";
-#endif
-					}
-					else
-					{
-#if 0
-						if (p->r < 0.01 && p->g < 0.01 && p->b < 0.01)
-							std::cerr << "C last is overridden by " << p->r << " " << p->g << " " << p->b << "\n";
-#endif
-						*pix++ = p->r;
-						*pix++ = p->g;
-						*pix++ = p->b;
-					}
-				}
-			}
-
-      if (save_partial_updates)
+  for (int t = 0; t < hdr->ntiles; t++)
+  {
+    PixelStreamTile *tile = (PixelStreamTile *)ptr;
+    ptr += sizeof(PixelStreamTile);
+
+    int tw, th;
+    PixelStreamTilePixels(tile->tx, tile->ty, width, height, tw, th);
+
+    int k = 0;
+    for (int y = 0; y < th; y++)
+    {
+      size_t offset = (tile->ty*GXY_PIXEL_TILE_SIZE + y)*width + tile->tx*GXY_PIXEL_TILE_SIZE;
+
+      if (hdr->format == PIXEL_STREAM_RGBA8)
+        k += decode_row8(ptr, pixels + (offset<<2), frameids + offset, tw, frame);
+      else
+        k += decode_row16((uint16_t *)ptr, pixels + (offset<<2), frameids + offset, tw, frame);
+
+      ptr += tw * psz;
+    }
+
+    if (k)
+      ager.TouchTile(tile->tx, tile->ty, frame);
+
+    this_frame_pixel_count += k;
+  }
+
+  if (save_partial_updates)
+  {
+    if (this_frame_pixel_count >= next_partial_frame_pixel_count)
+    {
+      std::stringstream s;
+      s << "partial-" << current_partial_frame_count << ".png";
+      ImageWriter writer;
+      writer.Write(width, height, pixels, s.str().c_str());
+
+      current_partial_frame_count ++;
+
+      if (current_partial_frame_count < (number_of_partial_frames - 1))
+        next_partial_frame_pixel_count += partial_frame_pixel_delta;
+      else if (current_partial_frame_count == (number_of_partial_frames - 1))
       {
-        if (this_frame_pixel_count >= next_partial_frame_pixel_count)
-        {
-          std::stringstream s;
-          s << "partial-" << current_partial_frame_count << ".png";
-          ImageWriter writer;
-          writer.Write(width, height, pixels, s.str().c_str());
-
-          current_partial_frame_count ++;
-
-          if (current_partial_frame_count < (number_of_partial_frames - 1))
-            next_partial_frame_pixel_count += partial_frame_pixel_delta;
-          else if (current_partial_frame_count == (number_of_partial_frames - 1))
-          {
-            next_partial_frame_pixel_count = partial_frame_pixel_count - 2;
-          }
-          else
-            save_partial_updates = false;
-        }
+        next_partial_frame_pixel_count = partial_frame_pixel_count - 2;
       }
-		}
-	}
+      else
+        save_partial_updates = false;
+    }
+  }
 
 	pthread_mutex_unlock(&lock);
 }
@@ -30,34 +30,32 @@
  * interactions that cause re-rendering, and b) update the actual
  * window pixels from the image buffer maintained by the ClientWindow.
  * 
- * The ClientWindow manages asynchronous update by using several 
- * pixel-resolution buffers:
+ * The server accumulates pixel contributions and streams the tiles of its
+ * framebuffer that change (see PixelStream.h).  The ClientWindow manages 
+ * asynchronous update by using several pixel-resolution buffers:
  * 
  * pixels, which contains the current pixel contents of the window
  * as (r,g,b,a) floats
  * 
  * - frameids, which contains the most advanced frame ID encountered
- *   for each pixel. This is used to recognize new frames and 
- *   therefore the new pixels will replace, rather than accumlate 
- *   with, prior values
+ *   for each pixel. This is used to recognize pixels left over from
+ *   prior frames, which are aged out
  * 
- * - negative_pixels, containing the sum of any negative pixels that
- *   arrive before the first positive values for the corresponding pixel
- * 
- * - negative_frameids, which are to negative_pixels as frameids are to pixels
- * 
- * - frame_times, holding the most recent modification time for each pixel
+ * - frame_time, the arrival time of the first tile of the current frame, from
+ *   which pixels left over from prior frames are aged
  * 
  * The ClientWindow implements two threads - the rcvr_thread, which watches the input
- * socket connection and modifies the above buffers when pixel messages arrive, and
- * the ager_thread, which runs every tenth of a second, looking for pixels that have 
- * not been updated recently and can be faded out.
+ * socket connection and modifies the above buffers when tile messages arrive, and
+ * the ager_thread, which runs every tenth of a second, fading out pixels left over
+ * from prior frames once they grow old.  A TileAger tracks which tiles hold such
+ * pixels so the ager only visits those.
  */
 
 #pragma once
 
-#include "Pixel.h"
+#include "PixelStream.h"
 #include "SocketHandler.h"
+#include "TileAger.h"
 
 #include <pthread.h>
 
@@ -137,7 +135,8 @@ public:
 private:
   int width, height;
 
-  void AddPixels(Pixel *, int, int);
+  //! Decode a message of framebuffer tiles into the pixel buffer
+  void AddTiles(PixelStreamHeader *, unsigned char *);
 
 	long	      my_time();
 	long        t_start;
@@ -153,10 +152,9 @@ private:
   int         next_partial_frame_pixel_count;
 
 	float*      pixels = NULL;
-	float*      negative_pixels = NULL;
 	int*        frameids = NULL;
-	int*        negative_frameids = NULL;
-	long*       frame_times = NULL;
+	long        frame_time;
+	TileAger    ager;
 
 	pthread_t	  ager_tid;
 	pthread_t	  rcvr_tid;
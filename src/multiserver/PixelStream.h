@@ -0,0 +1,74 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#pragma once
+
+/*! \file PixelStream.h
+ *  \brief the wire format in which a ServerRendering streams its framebuffer to a ClientWindow
+ *
+ * Rather than forwarding every pixel contribution, the ServerRendering accumulates 
+ * contributions into its own framebuffer and, on a fixed cadence, ships the tiles that 
+ * changed since the last update.   Each message is a PixelStreamHeader followed by 
+ * ntiles tiles, each a PixelStreamTile followed by the tile's pixels in row order,
+ * quantized to either 8 bits or half floats per channel.   Tiles along the right and
+ * top of the image are clipped to the image size.   The fourth channel of each
+ * quantized pixel is 0 if the server has no sample for the pixel in the current 
+ * frame, in which case the client leaves its pixel unchanged; otherwise it is 1.
+ */
+
+#include "Half.h"
+
+namespace gxy
+{
+
+#define GXY_PIXEL_TILE_SIZE 32
+
+//! quantization of the pixels of a tile
+enum PixelStreamFormat { PIXEL_STREAM_RGBA8, PIXEL_STREAM_RGBA16F };
+
+//! header of a message of framebuffer tiles
+struct PixelStreamHeader
+{
+  int frame;        //!< frame to which the tiles belong
+  int width;        //!< width of the framebuffer
+  int height;       //!< height of the framebuffer
+  int format;       //!< a PixelStreamFormat
+  int ntiles;       //!< number of tiles that follow
+};
+
+//! header of one tile within a message
+struct PixelStreamTile
+{
+  int tx, ty;       //!< tile coordinates, in units of GXY_PIXEL_TILE_SIZE pixels
+};
+
+//! number of bytes per pixel in the given format
+inline int PixelStreamPixelSize(int format) { return format == PIXEL_STREAM_RGBA8 ? 4 : 8; }
+
+//! number of pixels in tile (tx, ty) of a width x height image
+inline int
+PixelStreamTilePixels(int tx, int ty, int width, int height, int& tw, int& th)
+{
+  tw = width  - tx*GXY_PIXEL_TILE_SIZE; if (tw > GXY_PIXEL_TILE_SIZE) tw = GXY_PIXEL_TILE_SIZE;
+  th = height - ty*GXY_PIXEL_TILE_SIZE; if (th > GXY_PIXEL_TILE_SIZE) th = GXY_PIXEL_TILE_SIZE;
+  return tw * th;
+}
+
+} // namespace gxy
@@ -19,7 +19,11 @@
 // ========================================================================== //
 
 #include "ServerRendering.h"
+#include "PixelStream.h"
+
+#include <cstring>
 #include <pthread.h>
+#include <time.h>
 
 namespace gxy
 {
@@ -31,38 +35,207 @@ ServerRendering::initialize()
 {
   Rendering::initialize();
   pthread_mutex_init(&lock, NULL);
-	max_frame = -1;
   handler = NULL;
   owner = 0;
+
+  ntx = nty = 0;
+  changed = NULL;
+
+  sender_started = false;
+  kill_sender = false;
+
+  interval = getenv("GXY_PIXEL_STREAM_INTERVAL") ? atoi(getenv("GXY_PIXEL_STREAM_INTERVAL")) : 30;
+  if (interval < 1) interval = 1;
+
+  format = PIXEL_STREAM_RGBA8;
+  if (getenv("GXY_PIXEL_STREAM_FORMAT") && !strcmp(getenv("GXY_PIXEL_STREAM_FORMAT"), "half"))
+    format = PIXEL_STREAM_RGBA16F;
 }
 
 ServerRendering::~ServerRendering()
 {
+  // The sender thread uses everything below, so is stopped first
+
+  if (sender_started)
+  {
+    kill_sender = true;
+    pthread_join(sender_tid, NULL);
+  }
+
   handler = NULL;
+  if (changed) delete[] changed;
   pthread_mutex_destroy(&lock);
 }
 
+bool
+ServerRendering::local_commit(MPI_Comm c)
+{
+  pthread_mutex_lock(&lock);
+
+  bool r = super::local_commit(c);
+
+  if (! r && IsLocal())
+  {
+    ntx = (width + GXY_PIXEL_TILE_SIZE - 1) / GXY_PIXEL_TILE_SIZE;
+    nty = (height + GXY_PIXEL_TILE_SIZE - 1) / GXY_PIXEL_TILE_SIZE;
+
+    if (changed) delete[] changed;
+    changed = new unsigned char[ntx*nty];
+    memset(changed, 0, ntx*nty);
+
+    if (! sender_started)
+      sender_started = pthread_create(&sender_tid, NULL, sender_thread, (void *)this) == 0;
+  }
+
+  pthread_mutex_unlock(&lock);
+  return r;
+}
+
 void
 ServerRendering::AddLocalPixels(Pixel *p, int n, int f, int s)
 {
   pthread_mutex_lock(&lock);
 
-  if (f >= max_frame)
-	{
-		max_frame = f;
+  if (f >= frame && changed)
+  {
+    super::AddLocalPixels(p, n, f, s);
+
+    for (int i = 0; i < n; i++, p++)
+      changed[(p->y / GXY_PIXEL_TILE_SIZE)*ntx + (p->x / GXY_PIXEL_TILE_SIZE)] = 1;
+  }
+
+  pthread_mutex_unlock(&lock);
+}
+
+void *
+ServerRendering::sender_thread(void *d)
+{
+  ServerRendering *me = (ServerRendering *)d;
+
+  while (! me->kill_sender)
+  {
+    struct timespec rm, tm = {me->interval / 1000, (me->interval % 1000) * 1000000};
+    nanosleep(&tm, &rm);
+    me->SendChangedTiles();
+  }
+
+  pthread_exit(NULL);
+}
 
-		char* ptrs[] = {(char *)&n, (char *)&f, (char *)&s, (char *)p};
-		int   szs[] = {sizeof(int), sizeof(int), sizeof(int), static_cast<int>(n*sizeof(Pixel)), 0};
+// A pixel is shipped once a primary ray has retired into it in the 
+// current frame; until then the client keeps showing what it had
 
-    if (handler)
+static inline bool
+pixel_ready(int *sbuffer, int *kbuffer, int offset, int frame)
+{
+#ifdef GXY_WRITE_IMAGES
+  return sbuffer[offset] > 0;
+#else
+  return sbuffer[offset] > 0 && kbuffer[offset] == frame;
+#endif
+}
+
+static inline unsigned char
+quantize8(float v)
+{
+  return v <= 0.0 ? 0 : v >= 1.0 ? 255 : (unsigned char)(v * 255.0 + 0.5);
+}
+
+void
+ServerRendering::SendChangedTiles()
+{
+  pthread_mutex_lock(&lock);
+
+  if (! handler || ! changed || ! framebuffer)
+  {
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+
+  int ntiles = 0;
+  for (int i = 0; i < ntx*nty; i++)
+    if (changed[i]) ntiles++;
+
+  if (ntiles == 0)
+  {
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+
+  int psz = PixelStreamPixelSize(format);
+  message.resize(sizeof(PixelStreamHeader) + 
+      ntiles * (sizeof(PixelStreamTile) + GXY_PIXEL_TILE_SIZE*GXY_PIXEL_TILE_SIZE*psz));
+
+  PixelStreamHeader *hdr = (PixelStreamHeader *)message.data();
+  hdr->frame  = frame;
+  hdr->width  = width;
+  hdr->height = height;
+  hdr->format = format;
+  hdr->ntiles = ntiles;
+
+#ifdef GXY_WRITE_IMAGES
+  int *kbuffer = NULL;
+#endif
+
+  unsigned char *ptr = message.data() + sizeof(PixelStreamHeader);
+  for (int ty = 0; ty < nty; ty++)
+    for (int tx = 0; tx < ntx; tx++)
     {
-      handler->getTheSocketHandler()->DSendV(ptrs, szs);
+      if (! changed[ty*ntx + tx])
+        continue;
+
+      changed[ty*ntx + tx] = 0;
+
+      PixelStreamTile *tile = (PixelStreamTile *)ptr;
+      tile->tx = tx;
+      tile->ty = ty;
+      ptr += sizeof(PixelStreamTile);
+
+      int tw, th;
+      PixelStreamTilePixels(tx, ty, width, height, tw, th);
+
+      for (int y = 0; y < th; y++)
+      {
+        int offset = (ty*GXY_PIXEL_TILE_SIZE + y)*width + tx*GXY_PIXEL_TILE_SIZE;
+        float *src = framebuffer + (offset << 2);
+
+        if (format == PIXEL_STREAM_RGBA8)
+        {
+          unsigned char *dst = ptr;
+          for (int x = 0; x < tw; x++, src += 4, dst += 4)
+          {
+            dst[0] = quantize8(src[0]);
+            dst[1] = quantize8(src[1]);
+            dst[2] = quantize8(src[2]);
+            dst[3] = pixel_ready(sbuffer, kbuffer, offset + x, frame) ? 1 : 0;
+          }
+        }
+        else
+        {
+          uint16_t *dst = (uint16_t *)ptr;
+          for (int x = 0; x < tw; x++, src += 4, dst += 4)
+          {
+            dst[0] = FloatToHalf(src[0]);
+            dst[1] = FloatToHalf(src[1]);
+            dst[2] = FloatToHalf(src[2]);
+            dst[3] = pixel_ready(sbuffer, kbuffer, offset + x, frame) ? 1 : 0;
+          }
+        }
+
+        ptr += tw * psz;
+      }
     }
-    else
-      std::cerr << "no handler\n";
-	}
 
+  MultiServerHandler *h = handler;
   pthread_mutex_unlock(&lock);
+
+  // The message buffer is only touched by this thread, so it can
+  // be sent without holding the lock
+
+  char *ptrs[] = {(char *)message.data()};
+  int   szs[]  = {static_cast<int>(ptr - message.data()), 0};
+
+  h->getTheSocketHandler()->DSendV(ptrs, szs);
 }
 
 } // namespace gxy
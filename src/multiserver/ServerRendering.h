@@ -25,6 +25,9 @@
 #include "MultiServerHandler.h"
 #include "pthread.h"
 
+#include <vector>
+#include <atomic>
+
 /*! \file ServerRendering.h
  *  \brief  ServerRendering is a subclass of the Galaxy renderer's Rendering 
  *          class that knows to ship pixels that arrive from ray processing to
@@ -38,8 +41,13 @@
  * be exported to a file.   
  *
  * The ServerRendering is a simple specialization of Rendering that knows 
- * about a socket connetion (the MultiServerHandler) and to ship received 
- * pixel packets across the socket connection to a remote client.
+ * about a socket connetion (the MultiServerHandler) and streams its
+ * framebuffer across the socket connection to a remote client.  Pixel 
+ * contributions are accumulated locally, and a sender thread periodically
+ * ships the tiles that have changed, quantized as described in PixelStream.h.
+ * The interval between updates, in milliseconds, is taken from the 
+ * GXY_PIXEL_STREAM_INTERVAL environment variable (default 30) and the 
+ * quantization from GXY_PIXEL_STREAM_FORMAT ("rgba8", the default, or "half").
  */
 
 namespace gxy
@@ -57,16 +65,34 @@ public:
 
 	virtual void initialize();
 
-  //! Overload of AddLocalPixels to ship the pixels across the socket connection
+  //! Overload of local_commit to size the map of changed tiles and start the sender thread
+  virtual bool local_commit(MPI_Comm);
+
+  //! Overload of AddLocalPixels to accumulate the pixels and note the tiles they change
   virtual void AddLocalPixels(Pixel *p, int n, int f, int s);
 
   //! Set the socket connection (MultiServerHandler)
 	void SetHandler(MultiServerHandler *h) { handler = h; }
 
 private:
+  //! Thread that ships changed tiles on a fixed cadence
+  static void *sender_thread(void *);
+
+  //! Quantize the changed tiles into a message and ship it
+  void SendChangedTiles();
+
   pthread_mutex_t lock;
 	MultiServerHandler *handler;
-	int max_frame;
+
+  int format;
+  int interval;
+  int ntx, nty;
+  unsigned char *changed;
+  std::vector<unsigned char> message;
+
+  pthread_t sender_tid;
+  bool sender_started;
+  std::atomic<bool> kill_sender;
 };
  
 } // namespace gxy
@@ -0,0 +1,96 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#include <vector>
+#include <cmath>
+
+#include "OsprayAmrVolume.h"
+
+using namespace gxy;
+
+// Layout of the entries of an OSPRay amr_volume's brickInfo array
+
+struct BrickInfo
+{
+  osp::vec3i lower, upper;  // extent in the index space of the brick's level
+  int level;
+  float cellWidth;          // in level-0 cells
+};
+
+OsprayAmrVolume::OsprayAmrVolume(AmrVolumeP v)
+{
+  OSPVolume ospv = ospNewVolume("amr_volume");
+
+  osp::vec3f origin, spacing;
+  v->get_global_origin(origin.x, origin.y, origin.z);
+  v->get_deltas(spacing.x, spacing.y, spacing.z);
+
+  std::vector<BrickInfo> info;
+  std::vector<OSPData> bricks;
+
+  for (int i = 0; i < v->get_number_of_local_grids(); i++)
+  {
+    vec3f o, d;
+    vec3i n;
+    v->get_local_grid(i, o, d, n);
+
+    BrickInfo b;
+    b.level = v->get_local_grid_level(i);
+    b.cellWidth = d.x / spacing.x;
+    b.lower.x = (int)floor((o.x - origin.x) / d.x + 0.5);
+    b.lower.y = (int)floor((o.y - origin.y) / d.y + 0.5);
+    b.lower.z = (int)floor((o.z - origin.z) / d.z + 0.5);
+    b.upper.x = b.lower.x + n.x - 1;
+    b.upper.y = b.lower.y + n.y - 1;
+    b.upper.z = b.lower.z + n.z - 1;
+    info.push_back(b);
+
+    OSPData data = ospNewData(n.x*n.y*n.z, OSP_FLOAT, (void *)v->get_local_grid_samples(i), OSP_DATA_SHARED_BUFFER);
+    ospCommit(data);
+    bricks.push_back(data);
+  }
+
+  OSPData brickInfo = ospNewData(info.size() * sizeof(BrickInfo), OSP_RAW, info.data());
+  ospCommit(brickInfo);
+
+  OSPData brickData = ospNewData(bricks.size(), OSP_DATA, bricks.data());
+  ospCommit(brickData);
+
+  ospSetObject(ospv, "brickInfo", brickInfo);
+  ospSetObject(ospv, "brickData", brickData);
+  ospSetString(ospv, "voxelType", "float");
+  ospSetString(ospv, "amrMethod", "finest");
+  ospSetVec3f(ospv, "gridOrigin", origin);
+  ospSetVec3f(ospv, "gridSpacing", spacing);
+  ospSetf(ospv, "samplingRate", 1.0);
+
+  ospSetObject(ospv, "transferFunction", ospNewTransferFunction("piecewise_linear"));
+
+  ospCommit(ospv);
+
+  ospRelease(brickInfo);
+  ospRelease(brickData);
+
+  theOSPRayObject = ospv;
+}
+
+OsprayAmrVolume::~OsprayAmrVolume()
+{
+}
@@ -31,7 +31,10 @@ OsprayPathLines::OsprayPathLines(PathLinesP p)
     exit(1);
   }
 
-  int nv = p->GetNumberOfVertices();
+  nv = p->GetNumberOfVertices();
+  vertices = p->GetVertices();
+  data = p->GetData();
+
   if (nv > 0)
   {
     OSPData vdata = ospNewData(nv, OSP_FLOAT3, p->GetVertices(), OSP_DATA_SHARED_BUFFER);
@@ -69,3 +72,21 @@ OsprayPathLines::OsprayPathLines(PathLinesP p)
 
   theOSPRayObject = (OSPObject)ospg;
 }
+
+bool
+OsprayPathLines::Update(PathLinesP p)
+{
+  if (nv == 0 || p->GetNumberOfVertices() != nv || p->GetVertices() != vertices || p->GetData() != data)
+    return false;
+
+  OSPGeometry ospg = (OSPGeometry)theOSPRayObject;
+
+  OSPData sdata = ospNewData(p->GetConnectivitySize(), OSP_INT, p->GetConnectivity(), OSP_DATA_SHARED_BUFFER);
+  ospCommit(sdata);
+  ospSetData(ospg, "indices", sdata);
+  ospRelease(sdata);
+
+  ospCommit(ospg);
+
+  return true;
+}
@@ -45,10 +45,20 @@ class OsprayPathLines : public OsprayObject
 
 public:
   static OsprayPathLinesP NewP(PathLinesP p) { return OsprayPathLines::Cast(std::shared_ptr<OsprayPathLines>(new OsprayPathLines(p))); }
+
+  //! hand the current connectivity of `p` to the existing OSPRay geometry
+  /*! Returns false if the vertex or data buffers of `p` are not the ones
+   * this object was created from, in which case it must be recreated.
+   */
+  bool Update(PathLinesP p);
   
 private:
   OsprayPathLines(PathLinesP);
 
+  int    nv;
+  vec3f *vertices;
+  float *data;
+
 };
 
 }
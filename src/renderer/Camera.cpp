@@ -41,6 +41,7 @@
 #include "Renderer.h"
 #include "Rendering.h"
 #include "RenderingSet.h"
+#include "RenderTimings.h"
 #include "Threading.h"
 
 #include <boost/property_tree/ptree.hpp>
@@ -373,9 +374,24 @@ Camera::spawn_rays_task::work()
   if (! a->rs->IsActive(a->fnum))
     return 0;
 
+  RenderTimings::Scope t(RenderTimings::SPAWN);
   return a->camera->SpawnRays(a, start, count);
 }
 
+// Is pixel (x, y) sampled in the given progressive pass?  The first pass
+// takes a sparse lattice of pixels, the second the pixels the first skipped
+// and any later pass takes every pixel again
+
+static inline bool
+in_pass(int x, int y, int pass, int stride)
+{
+  if (stride <= 1 || pass > 1)
+    return true;
+
+  bool lattice = ((x % stride) == 0) && ((y % stride) == 0);
+  return (pass == 0) == lattice;
+}
+
 bool 
 Camera::SpawnRays(std::shared_ptr<spawn_rays_args> a, int start, int count)
 {
@@ -405,6 +421,9 @@ Camera::SpawnRays(std::shared_ptr<spawn_rays_args> a, int start, int count)
     x = a->ixmin + (p % a->iwidth);
     y = a->iymin + (p / a->iwidth);
 
+    if (! in_pass(x, y, a->pass, a->stride))
+      continue;
+
     // Get pixel location in (-1,1) space
 
     float fx = (x - a->off_x) * a->scaling;
@@ -440,7 +459,11 @@ Camera::SpawnRays(std::shared_ptr<spawn_rays_args> a, int start, int count)
     float d = fabs(lmin) - fabs(gmin);
     if (hit && (lmax >= 0) && (d < FUZZ) && (d > -FUZZ))
     {
-      if (!rlist) rlist = new RayList(a->renderer, a->rs, a->r, count, a->fnum, RayList::PRIMARY);
+      if (!rlist)
+      {
+        rlist = new RayList(a->renderer, a->rs, a->r, count, a->fnum, RayList::PRIMARY);
+        rlist->SetPass(a->pass);
+      }
 
       rlist->set_x(dst, x);
       rlist->set_y(dst, y);
@@ -526,9 +549,10 @@ void check_env(RendererP renderer, int width, int height)
 }
     
 void
-Camera::generate_initial_rays(RendererP renderer, RenderingSetP renderingSet, RenderingP rendering, Box* lbox, Box *gbox, std::vector<std::future<int>>& rvec, int fnum)
+Camera::generate_initial_rays(RendererP renderer, RenderingSetP renderingSet, RenderingP rendering, Box* lbox, Box *gbox, std::vector<std::future<int>>& rvec, int fnum, int pass)
 {
   int rays_per_packet = renderer->GetMaxRayListSize();
+  int stride = renderer->GetProgressivePasses() > 1 ? renderer->GetProgressiveStride() : 1;
 
   int width, height;
   rendering->GetTheSize(width, height);
@@ -673,6 +697,11 @@ Camera::generate_initial_rays(RendererP renderer, RenderingSetP renderingSet, Re
   
   if (raydebug)
   {
+    // Debug rays are not refined progressively
+
+    if (pass > 0)
+      return;
+
     if ((Xmin > ixmax) || (Xmax < ixmin) || (Ymin > iymax) || (Ymax < iymin))
       return;
 
@@ -807,7 +836,7 @@ Camera::generate_initial_rays(RendererP renderer, RenderingSetP renderingSet, Re
 
     ThreadPool *threadpool = GetTheApplication()->GetTheThreadPool();
     shared_ptr<spawn_rays_args> a = shared_ptr<spawn_rays_args>(new spawn_rays_args(
-      fnum, pixel_scaling, iwidth, 
+      fnum, pass, stride, pixel_scaling, iwidth, 
       ixmin, iymin,
       off_x, off_y, 
       vr, vu, veye, center, 
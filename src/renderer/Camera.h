@@ -59,16 +59,17 @@ class Camera : public KeyedObject
 
   struct spawn_rays_args
   { 
-    spawn_rays_args(int fnum, float pixel_scaling, int iw, int ixmin, int iymin, float ox, float oy,
+    spawn_rays_args(int fnum, int pass, int stride, float pixel_scaling, int iw, int ixmin, int iymin, float ox, float oy,
        vec3f& vr, vec3f& vu, vec3f& veye, vec3f center,
        Box *lb, Box *gb, RendererP rndr, RenderingSetP rs, RenderingP r, Camera *c) :
-       fnum(fnum), iwidth(iw), ixmin(ixmin), iymin(iymin),
+       fnum(fnum), pass(pass), stride(stride), iwidth(iw), ixmin(ixmin), iymin(iymin),
        scaling(1.0 / pixel_scaling), off_x(ox), off_y(oy),
        vr(vr), vu(vu), veye(veye), center(center), lbox(lb), gbox(gb),
        renderer(rndr), rs(rs), r(r), camera(c) {}
     ~spawn_rays_args() {}
 
     int fnum;
+    int pass, stride;
     float scaling;
     int iwidth, ixmin, iymin;
     float off_x, off_y;
@@ -179,8 +180,12 @@ public:
 	 * @param gbox a pointer to the Box bounding the global data extent (i.e. data across all nodes)
 	 * @param rvec a vector of return values for worker threads processing RayLists of these primary rays
 	 * @param fnum the frame number for these rays
+	 * @param pass the progressive pass of the frame these rays sample.  When the Renderer 
+	 *        makes more than one pass per frame, pass 0 covers every Nth pixel in each
+	 *        direction (N being the Renderer's progressive stride), pass 1 the remaining
+	 *        pixels, and later passes every pixel again.
 	 */
-	void generate_initial_rays(RendererP renderer, RenderingSetP renderingSet, RenderingP rendering, Box* lbox, Box *gbox, std::vector<std::future<int>>& rvec, int fnum);
+	void generate_initial_rays(RendererP renderer, RenderingSetP renderingSet, RenderingP rendering, Box* lbox, Box *gbox, std::vector<std::future<int>>& rvec, int fnum, int pass = 0);
 
 	//! the size in bytes for the serialization of this Camera object
   virtual int serialSize();
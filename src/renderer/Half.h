@@ -0,0 +1,83 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#pragma once
+
+/*! \file Half.h 
+ * \brief conversion between floats and IEEE half-precision floats
+ * \ingroup render
+ */
+
+#include <cstdint>
+#include <cstring>
+
+namespace gxy
+{
+
+//! convert a float to IEEE half precision, rounding to nearest
+inline uint16_t
+FloatToHalf(float f)
+{
+  uint32_t x; memcpy(&x, &f, sizeof(x));
+  uint32_t sign = (x >> 16) & 0x8000;
+  int32_t  e    = ((x >> 23) & 0xff) - 127 + 15;
+  uint32_t m    = x & 0x7fffff;
+
+  if (e >= 31)                  // overflow, inf and nan all go to inf
+    return sign | 0x7c00;
+  if (e <= 0)                   // denormal or zero
+  {
+    if (e < -10) return sign;
+    m = (m | 0x800000) >> (1 - e);
+    return sign | ((m + 0x1000) >> 13);
+  }
+  return sign | (((e << 10) | (m >> 13)) + ((m >> 12) & 1));
+}
+
+//! convert an IEEE half to a float
+inline float
+HalfToFloat(uint16_t h)
+{
+  uint32_t sign = (h & 0x8000) << 16;
+  uint32_t e    = (h >> 10) & 0x1f;
+  uint32_t m    = h & 0x3ff;
+  uint32_t x;
+
+  if (e == 0)
+  {
+    if (m == 0)
+      x = sign;
+    else
+    {
+      e = 127 - 15 + 1;
+      while (! (m & 0x400)) { m <<= 1; e--; }
+      x = sign | (e << 23) | ((m & 0x3ff) << 13);
+    }
+  }
+  else if (e == 31)
+    x = sign | 0x7f800000 | (m << 13);
+  else
+    x = sign | ((e - 15 + 127) << 23) | (m << 13);
+
+  float f; memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+} // namespace gxy
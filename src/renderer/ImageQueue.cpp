@@ -0,0 +1,176 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#include <cstdlib>
+#include <cstring>
+
+#include "ImageQueue.h"
+#include "ImageWriter.h"
+
+namespace gxy
+{
+
+ImageQueue *
+ImageQueue::GetTheImageQueue()
+{
+  // Destroyed, and so drained, at exit
+
+  static ImageQueue theImageQueue;
+  return &theImageQueue;
+}
+
+ImageQueue::ImageQueue()
+{
+  int nwriters = getenv("GXY_IMAGE_WRITERS") ? atoi(getenv("GXY_IMAGE_WRITERS")) : 2;
+  depth = getenv("GXY_IMAGE_QUEUE_DEPTH") ? atoi(getenv("GXY_IMAGE_QUEUE_DEPTH")) : 4;
+  if (depth < 1) depth = 1;
+
+  busy = 0;
+  kill_writers = false;
+
+  pthread_mutex_init(&lock, NULL);
+  pthread_cond_init(&cond, NULL);
+
+  for (int i = 0; i < nwriters; i++)
+  {
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, writer_thread, (void *)this) == 0)
+      writers.push_back(tid);
+  }
+}
+
+ImageQueue::~ImageQueue()
+{
+  Flush();
+
+  pthread_mutex_lock(&lock);
+  kill_writers = true;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&lock);
+
+  for (auto tid : writers)
+    pthread_join(tid, NULL);
+
+  pthread_mutex_destroy(&lock);
+  pthread_cond_destroy(&cond);
+}
+
+void
+ImageQueue::Write(int w, int h, float *rgba, std::string name, ImageFormat format)
+{
+  Image image;
+  image.w = w;
+  image.h = h;
+  image.name = name;
+  image.format = format;
+  image.rgba = (float *)malloc(w*h*4*sizeof(float));
+  memcpy(image.rgba, rgba, w*h*4*sizeof(float));
+
+  if (writers.empty())
+  {
+    write(image);
+    return;
+  }
+
+  pthread_mutex_lock(&lock);
+
+  while (images.size() >= (size_t)depth)
+    pthread_cond_wait(&cond, &lock);
+
+  images.push_back(image);
+  pthread_cond_broadcast(&cond);
+
+  pthread_mutex_unlock(&lock);
+}
+
+void
+ImageQueue::Flush()
+{
+  pthread_mutex_lock(&lock);
+
+  while (! images.empty() || busy)
+    pthread_cond_wait(&cond, &lock);
+
+  pthread_mutex_unlock(&lock);
+}
+
+void *
+ImageQueue::writer_thread(void *p)
+{
+  ImageQueue *me = (ImageQueue *)p;
+
+  pthread_mutex_lock(&me->lock);
+
+  while (true)
+  {
+    while (me->images.empty() && ! me->kill_writers)
+      pthread_cond_wait(&me->cond, &me->lock);
+
+    if (me->images.empty())
+      break;
+
+    Image image = me->images.front();
+    me->images.pop_front();
+    me->busy++;
+    pthread_cond_broadcast(&me->cond);
+
+    pthread_mutex_unlock(&me->lock);
+    write(image);
+    pthread_mutex_lock(&me->lock);
+
+    me->busy--;
+    pthread_cond_broadcast(&me->cond);
+  }
+
+  pthread_mutex_unlock(&me->lock);
+  pthread_exit(NULL);
+}
+
+void
+ImageQueue::write(Image& image)
+{
+  switch (image.format)
+  {
+    case IMAGE_PNG:
+    {
+      ColorImageWriter writer;
+      writer.Write(image.w, image.h, image.rgba, image.name.c_str());
+      break;
+    }
+
+    case IMAGE_FITS:
+    {
+      FloatImageWriter writer;
+      writer.Write(image.w, image.h, image.rgba, image.name.c_str());
+      break;
+    }
+
+    case IMAGE_EXR:
+    {
+      HalfImageWriter writer;
+      writer.Write(image.w, image.h, image.rgba, image.name.c_str());
+      break;
+    }
+  }
+
+  free(image.rgba);
+}
+
+} // namespace gxy
@@ -0,0 +1,91 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#pragma once
+
+/*! \file ImageQueue.h 
+ * \brief writes images on background threads so that rendering can continue
+ * \ingroup render
+ */
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+namespace gxy
+{
+
+//! image file formats written by the ImageQueue
+enum ImageFormat { IMAGE_PNG, IMAGE_FITS, IMAGE_EXR };
+
+//! writes images on background threads so that rendering can continue
+/*! \ingroup render
+ * Write() snapshots the given image into a bounded queue and returns; a pool 
+ * of writer threads encodes and writes queued images concurrently, so the next
+ * frame renders while this one is written.  When the queue is full, Write() 
+ * waits for a writer to take an image.   The queue is drained before the 
+ * process exits.
+ *
+ * GXY_IMAGE_WRITERS sets the number of writer threads (default 2; 0 writes 
+ * synchronously) and GXY_IMAGE_QUEUE_DEPTH the number of images that may be
+ * waiting (default 4).
+ */
+class ImageQueue
+{
+public:
+  //! the process's image queue
+  static ImageQueue *GetTheImageQueue();
+
+  //! queue a w x h float RGBA image to be written in the given format
+  /*! \param name the filename base; the writer for the format adds the extension */
+  void Write(int w, int h, float *rgba, std::string name, ImageFormat format);
+
+  //! wait until every queued image has been written
+  void Flush();
+
+  ~ImageQueue();
+
+private:
+  ImageQueue();
+
+  struct Image
+  {
+    int w, h;
+    float *rgba;
+    std::string name;
+    ImageFormat format;
+  };
+
+  static void *writer_thread(void *);
+  static void write(Image&);
+
+  std::deque<Image> images;
+  int depth;
+  int busy;
+  bool kill_writers;
+
+  std::vector<pthread_t> writers;
+  pthread_mutex_t lock;
+  pthread_cond_t  cond;
+};
+
+} // namespace gxy
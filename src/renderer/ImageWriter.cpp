@@ -18,29 +18,41 @@
 //                                                                            //
 // ========================================================================== //
 
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <vector>
 
+#include "Half.h"
 #include "ImageWriter.h"
 
 namespace gxy
 {
 
+// Clamped and branch-free so the conversion loop vectorizes
+
+static inline unsigned char
+to_byte(float v)
+{
+  v = v < 0.0f ? 0.0f : v > 1.0f ? 1.0f : v;
+  return (unsigned char)(255.0f*v + 0.5f);
+}
+
 void 
 ColorImageWriter::Write(int w, int h, float *rgba, const char *name)
 { 
   unsigned char *buf = new unsigned char[w*h*4];
-  float *p = rgba;  
   for (int y = 0; y < h; y++)
   { 
+    const float *p = rgba + y*w*4;
     unsigned char *b = buf + ((h-1)-y)*w*4;
-    for (int x = 0; x < w; x++)
+    for (int x = 0; x < w; x++, p += 4, b += 4)
     { 
-      *b++ = (unsigned char)(255*(*p++));
-      *b++ = (unsigned char)(255*(*p++));
-      *b++ = (unsigned char)(255*(*p++));
-      *b++ = 0xff ; p ++;
+      b[0] = to_byte(p[0]);
+      b[1] = to_byte(p[1]);
+      b[2] = to_byte(p[2]);
+      b[3] = 0xff;
     }
   }
   Write(w, h, (unsigned int *)buf, name);
@@ -98,56 +110,36 @@ FloatImageWriter::Write(int w, int h, float *rgba, const char *name)
   APPEND("END", "")
   header.insert(header.size(), 2880-header.size(), ' ');
 
-  unsigned char *rbuf = new unsigned char[w*h*4];
-  unsigned char *gbuf = new unsigned char[w*h*4];
-  unsigned char *bbuf = new unsigned char[w*h*4];
-  unsigned char *abuf = new unsigned char[w*h*4];
-
-  unsigned char *rptr = rbuf;
-  unsigned char *gptr = gbuf;
-  unsigned char *bptr = bbuf;
-  unsigned char *aptr = abuf;
-  unsigned char *rgbaptr = (unsigned char *)rgba;
-  for (int i = 0; i < w*h; i++)
-  {
-    SWAP(rptr, rgbaptr), rptr += 4, rgbaptr += 4;
-    SWAP(gptr, rgbaptr), gptr += 4, rgbaptr += 4;
-    SWAP(bptr, rgbaptr), bptr += 4, rgbaptr += 4;
-    SWAP(aptr, rgbaptr), aptr += 4, rgbaptr += 4;
-  }
-    
   int padsz = 2880 - (w*h*4 % 2880);
-  char *pad = new char[padsz];
-
-  for (auto i = 0; i < padsz; i++)
-    pad[i] = ' ';
-
-#define WRITE_CHANNEL(channel, buffer)                                  \
-  {                                                                     \
-    char fullname[1024];                                                \
-    sprintf(fullname, "%s_%c.fits", fn.c_str(), channel);               \
-    f.open(fullname, std::ios::out | std::ios::binary);                 \
-    if (!f.good())                                                      \
-    {                                                                   \
-      std::cerr << "error opening file: " << fullname << "\n";          \
-      return;                                                           \
-    }                                                                   \
-    f.write(header.c_str(), 2880);                                      \
-    f.write((char *)buffer, w*h*4);                                     \
-    f.write(pad, padsz);                                                \
-    f.close();                                                          \
-  }
+  std::vector<char> pad(padsz, ' ');
 
-  WRITE_CHANNEL('r', rbuf);
-  WRITE_CHANNEL('g', gbuf);
-  WRITE_CHANNEL('b', bbuf);
-  WRITE_CHANNEL('a', abuf);
+  // One plane buffer is byte-swapped and written for each channel in turn
+
+  std::vector<unsigned char> plane(w*h*4);
+  const char *channels = "rgba";
+
+  for (int c = 0; c < 4; c++)
+  {
+    unsigned char *dst = plane.data();
+    unsigned char *src = ((unsigned char *)rgba) + c*4;
+    for (int i = 0; i < w*h; i++, dst += 4, src += 16)
+      SWAP(dst, src);
+
+    char fullname[1024];
+    sprintf(fullname, "%s_%c.fits", fn.c_str(), channels[c]);
+    f.open(fullname, std::ios::out | std::ios::binary);
+    if (!f.good())
+    {
+      std::cerr << "error opening file: " << fullname << "\n";
+      return;
+    }
+    f.write(header.c_str(), 2880);
+    f.write((char *)plane.data(), w*h*4);
+    f.write(pad.data(), padsz);
+    f.close();
+  }
 
   frame++;
-  delete[] rbuf;
-  delete[] gbuf;
-  delete[] bbuf;
-  delete[] abuf;
 }
 
 void
@@ -156,4 +148,108 @@ FloatImageWriter::Write(int w, int h, unsigned int *rgba, const char *name)
   std::cerr << "cannot wtite int image buffer to float image file\n";
 }
 
+// A single-part, scanline OpenEXR file with no compression: the header 
+// attributes, a table of offsets to the scanlines, then each scanline as
+// its y followed by the A, B, G and R halves of its pixels.  EXR scanlines
+// run top to bottom; the framebuffer's rows run bottom to top.
+
+static void exr_int(std::string& s, int v)     { s.append((char *)&v, sizeof(v)); }
+static void exr_float(std::string& s, float v) { s.append((char *)&v, sizeof(v)); }
+
+static void
+exr_attribute(std::string& s, const char *name, const char *type, int size)
+{
+  s.append(name, strlen(name)+1);
+  s.append(type, strlen(type)+1);
+  exr_int(s, size);
+}
+
+void
+HalfImageWriter::Write(int w, int h, float *rgba, const char *name)
+{
+  std::string fn = std::string(name ? name : basename.c_str()) + ".exr";
+
+  std::string header;
+  exr_int(header, 20000630);
+  exr_int(header, 2);
+
+  exr_attribute(header, "channels", "chlist", 4*(2 + 16) + 1);
+  for (const char *c : {"A", "B", "G", "R"})
+  {
+    header.append(c, 2);
+    exr_int(header, 1);               // HALF
+    exr_int(header, 0);               // pLinear and reserved
+    exr_int(header, 1);               // x sampling
+    exr_int(header, 1);               // y sampling
+  }
+  header.push_back(0);
+
+  exr_attribute(header, "compression", "compression", 1);
+  header.push_back(0);
+
+  for (const char *window : {"dataWindow", "displayWindow"})
+  {
+    exr_attribute(header, window, "box2i", 16);
+    exr_int(header, 0); exr_int(header, 0); exr_int(header, w-1); exr_int(header, h-1);
+  }
+
+  exr_attribute(header, "lineOrder", "lineOrder", 1);
+  header.push_back(0);
+
+  exr_attribute(header, "pixelAspectRatio", "float", 4);
+  exr_float(header, 1.0);
+
+  exr_attribute(header, "screenWindowCenter", "v2f", 8);
+  exr_float(header, 0.0); exr_float(header, 0.0);
+
+  exr_attribute(header, "screenWindowWidth", "float", 4);
+  exr_float(header, 1.0);
+
+  header.push_back(0);
+
+  int linesz = 2*sizeof(int) + 4*w*sizeof(uint16_t);
+
+  std::vector<uint64_t> offsets(h);
+  for (int y = 0; y < h; y++)
+    offsets[y] = header.size() + h*sizeof(uint64_t) + (uint64_t)y*linesz;
+
+  std::ofstream f(fn, std::ios::out | std::ios::binary);
+  if (!f.good())
+  {
+    std::cerr << "error opening file: " << fn << "\n";
+    return;
+  }
+
+  f.write(header.data(), header.size());
+  f.write((char *)offsets.data(), h*sizeof(uint64_t));
+
+  std::vector<char> line(linesz);
+  for (int y = 0; y < h; y++)
+  {
+    *(int *)line.data() = y;
+    *(int *)(line.data() + sizeof(int)) = 4*w*sizeof(uint16_t);
+
+    uint16_t *dst = (uint16_t *)(line.data() + 2*sizeof(int));
+    const float *src = rgba + ((h-1)-y)*w*4;
+    for (int x = 0; x < w; x++, src += 4)
+    {
+      dst[x]       = FloatToHalf(src[3]);
+      dst[w + x]   = FloatToHalf(src[2]);
+      dst[2*w + x] = FloatToHalf(src[1]);
+      dst[3*w + x] = FloatToHalf(src[0]);
+    }
+
+    f.write(line.data(), linesz);
+  }
+
+  f.close();
+  frame++;
+}
+
+void
+HalfImageWriter::Write(int w, int h, unsigned int *rgba, const char *name)
+{ 
+  std::cerr << "cannot write int image buffer to half-float image file\n";
+}
+
 }
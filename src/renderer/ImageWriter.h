@@ -21,10 +21,11 @@
 #pragma once
 
 /*! \file ImageWriter.h 
- * \brief writes PNG format images 
+ * \brief writes PNG, FITS and OpenEXR format images 
  * \ingroup data
  */
 
+#include <cstdlib>
 #include <iostream>
 #include <string>
 #include <png.h>
@@ -127,6 +128,11 @@ private:
 
 		png_init_io(png_ptr, fp);
 
+		// GXY_PNG_COMPRESSION trades file size for encoding time (0-9, default zlib's)
+
+		if (getenv("GXY_PNG_COMPRESSION"))
+			png_set_compression_level(png_ptr, atoi(getenv("GXY_PNG_COMPRESSION")));
+
 		png_set_IHDR(png_ptr, info_ptr, w, h, 8, PNG_COLOR_TYPE_RGB_ALPHA,
 				PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
 
@@ -139,7 +145,7 @@ private:
 		png_write_png(png_ptr, info_ptr, PNG_TRANSFORM_IDENTITY, NULL);
 
 		png_destroy_write_struct(&png_ptr, &info_ptr);
-		free(rows);
+		delete[] rows;
 
 		fclose(fp);
 
@@ -155,4 +161,13 @@ public:
   void Write(int w, int h, unsigned int *rgba, const char *name=NULL);
 };
 
+//! writes float RGBA images as uncompressed half-float OpenEXR files
+class HalfImageWriter : public ImageWriter
+{
+public:
+
+	void Write(int w, int h, float *rgba, const char *name=NULL);
+  void Write(int w, int h, unsigned int *rgba, const char *name=NULL);
+};
+
 }
@@ -60,6 +60,8 @@ MappedVis::initialize()
 
   opacitymap.push_back(vec2f(0.0, 1.0));
   opacitymap.push_back(vec2f(1.0, 1.0));
+
+  preintegrated = false;
   
   transferFunction = NULL;
 }
@@ -99,6 +101,9 @@ MappedVis::LoadFromJSON(Value& v)
         data_range = false;
     }
 
+  if (v.HasMember("preintegrate"))
+    preintegrated = v["preintegrate"].GetBool();
+
 	if (v.HasMember("transfer function") || v.HasMember("colormap"))
 	{
     const Value& m = v.HasMember("transfer function") ? v["transfer function"] : v["colormap"];
@@ -217,7 +222,7 @@ MappedVis::serialSize()
 	return super::serialSize() + sizeof(Key) +
 				 sizeof(int) + colormap.size()*sizeof(vec4f) +
 				 sizeof(int) + opacitymap.size()*sizeof(vec2f) +
-                 sizeof(float) + sizeof(float) + sizeof(bool);
+                 sizeof(float) + sizeof(float) + sizeof(bool) + sizeof(bool);
 }
 
 unsigned char *
@@ -244,6 +249,9 @@ MappedVis::deserialize(unsigned char *ptr)
   data_range = *(bool *)ptr;
   ptr += sizeof(bool);
 
+  preintegrated = *(bool *)ptr;
+  ptr += sizeof(bool);
+
   return ptr;
 }
 
@@ -271,6 +279,9 @@ MappedVis::serialize(unsigned char *ptr)
   *(bool *)ptr = data_range; 
   ptr += sizeof(bool);
 
+  *(bool *)ptr = preintegrated; 
+  ptr += sizeof(bool);
+
   return ptr;
 }
 
@@ -327,16 +338,91 @@ MappedVis::local_commit(MPI_Comm c)
   OSPData oAlphas = ospNewData(256, OSP_FLOAT, opacity);
   ospSetData(transferFunction, "opacities", oAlphas);
   ospRelease(oAlphas);
-  if (data_range)
-      ospSet2f(transferFunction, "valueRange", data_range_min, data_range_max);
-  else
-      ospSet2f(transferFunction, "valueRange", colormap[0].x, colormap[n_colors-1].x);
+
+  float vmin = data_range ? data_range_min : colormap[0].x;
+  float vmax = data_range ? data_range_max : colormap[n_colors-1].x;
+
+  ospSet2f(transferFunction, "valueRange", vmin, vmax);
   ospCommit(transferFunction);
   
   ispc::MappedVis_set_transferFunction(ispc, ospray_util::GetIE(transferFunction));
+
+  // The table spans the same value range as the transfer function, so a
+  // degenerate range leaves rendering to the transfer function
+
+  if (preintegrated && vmax > vmin)
+  {
+    build_preintegration_table(color, opacity);
+    ispc::MappedVis_set_preintegration(ispc, 256, preintegration_table.data(), vmin, vmax);
+  }
+  else
+  {
+    preintegration_table.clear();
+    ispc::MappedVis_set_preintegration(ispc, 0, NULL, 0, 0);
+  }
+
   return false;
 }
 
+// Pre-integration treats the data as varying linearly between the samples at 
+// the front and back of a ray segment, and integrates the transfer function 
+// over the values in between.   Entry (b, f) of the table holds the 
+// extinction-weighted mean color and the mean extinction over bins f through b, 
+// taking the opacity map's values as the opacity of one step.   The renderer 
+// scales the mean extinction by the segment length, so the table is independent
+// of the step size.
+
+void
+MappedVis::build_preintegration_table(vec3f *color, float *opacity)
+{
+  float tau[256];
+  for (int i = 0; i < 256; i++)
+  {
+    float o = opacity[i] < 0 ? 0 : opacity[i] > 0.9999 ? 0.9999 : opacity[i];
+    tau[i] = -log(1.0 - o);
+  }
+
+  // Running (trapezoidal) integrals of extinction and extinction-weighted color
+
+  double T[256], R[256], G[256], B[256];
+  T[0] = R[0] = G[0] = B[0] = 0;
+  for (int i = 1; i < 256; i++)
+  {
+    T[i] = T[i-1] + 0.5*(tau[i-1] + tau[i]);
+    R[i] = R[i-1] + 0.5*(tau[i-1]*color[i-1].x + tau[i]*color[i].x);
+    G[i] = G[i-1] + 0.5*(tau[i-1]*color[i-1].y + tau[i]*color[i].y);
+    B[i] = B[i-1] + 0.5*(tau[i-1]*color[i-1].z + tau[i]*color[i].z);
+  }
+
+  preintegration_table.resize(256*256);
+
+  for (int i = 0; i < 256; i++)
+  {
+    preintegration_table[i*256 + i] = vec4f(color[i].x, color[i].y, color[i].z, tau[i]);
+
+    for (int j = i + 1; j < 256; j++)
+    {
+      double dT = T[j] - T[i];
+      vec4f e;
+      if (dT > 0)
+        e = vec4f(
+          (R[j] - R[i]) / dT, 
+          (G[j] - G[i]) / dT, 
+          (B[j] - B[i]) / dT, 
+          dT / (j - i));
+      else
+        e = vec4f(
+          0.5*(color[i].x + color[j].x), 
+          0.5*(color[i].y + color[j].y),
+          0.5*(color[i].z + color[j].z), 
+          0.0);
+
+      preintegration_table[j*256 + i] = e;
+      preintegration_table[i*256 + j] = e;
+    }
+  }
+}
+
 void 
 MappedVis::SetColorMap(int n, vec4f *ptr)
 {
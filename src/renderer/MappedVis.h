@@ -78,6 +78,14 @@ public:
   //! scale mapping to a given range
   virtual void ScaleMaps(float xmin, float xmax);
 
+  //! set whether volume rendering uses pre-integrated transfer function tables
+  /*! Pre-integration accounts for the whole of the transfer function between 
+   * successive samples, so sharp features are not missed at larger step sizes.
+   */
+  void SetPreintegrated(bool p) { preintegrated = p; }
+  //! does volume rendering use pre-integrated transfer function tables?
+  bool IsPreintegrated() { return preintegrated; }
+
  protected:
   virtual void allocate_ispc();
   virtual void initialize_ispc();
@@ -88,6 +96,10 @@ public:
   std::vector<vec4f> colormap;
   std::vector<vec2f> opacitymap;
 
+  bool preintegrated;
+  std::vector<vec4f> preintegration_table;
+  void build_preintegration_table(vec3f *color, float *opacity);
+
   virtual int serialSize();
   virtual unsigned char *serialize(unsigned char *);
   virtual unsigned char *deserialize(unsigned char *);
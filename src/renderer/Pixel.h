@@ -34,6 +34,24 @@ struct Pixel
 {
   int x, y;
   float r, g, b, o;
+  int samples;  //!< 1 if this contribution retires a primary ray, 0 for shadow and AO contributions
 };
 
+//! fold a contribution into n color channels holding the mean of `knt` samples
+/*! A pixel holds the mean of the samples whose primary rays have retired.  Since
+ * shadow and AO contributions may arrive before or after the primary ray they 
+ * belong to, the running sum is recovered from the mean, the contribution added in,
+ * and the mean recomputed with the updated count.   With one sample per pixel the 
+ * scale factors are 1 and this reduces to a plain sum.
+ */
+inline void
+AccumulateSample(float *pix, int& knt, const float *contribution, int samples, int n)
+{
+  float w = knt > 1 ? knt : 1;
+  knt += samples;
+  float s = knt > 1 ? 1.0 / knt : 1.0;
+  for (int i = 0; i < n; i++)
+    pix[i] = (pix[i] * w + contribution[i]) * s;
+}
+
 } // namespace gxy
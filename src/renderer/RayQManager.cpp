@@ -21,11 +21,15 @@
 #include <iostream>
 #include <sstream>
 #include <pthread.h>
+#include <vector>
+#include <climits>
+#include <stdlib.h>
 
 #include "Application.h"
 #include "Threading.h"
 #include "Renderer.h"
 #include "RayQManager.h"
+#include "RenderingSet.h"
 #include "Rays.h"
 
 using namespace std;
@@ -87,10 +91,19 @@ RayQManager::RayQManager(Renderer *r)
 
 	pthread_mutex_init(&lock, NULL);
 	pthread_cond_init(&wait, NULL);
+	pthread_cond_init(&drained, NULL);
 
 	paused = false;
   done = false;
 
+  regions = getenv("GXY_RAYQ_REGIONS") ? atoi(getenv("GXY_RAYQ_REGIONS")) : 2;
+  if (regions < 1) regions = 1;
+
+  current_region = 0;
+  in_flight = 0;
+  window = regions > 1 ? GetTheApplication()->GetTheThreadPool()->GetNumberOfThreads() : INT_MAX;
+  if (window < 1) window = 1;
+
   GetTheApplication()->GetTheThreadManager()->create_thread(string("rayQWorker"), &tid, NULL, RayQManager::theRayQWorker, this);
 }
 
@@ -108,6 +121,7 @@ RayQManager::~RayQManager()
   Kill();
 	pthread_mutex_destroy(&lock);
 	pthread_cond_destroy(&wait);
+	pthread_cond_destroy(&drained);
 	pthread_join(tid, NULL);
 }
 
@@ -148,7 +162,7 @@ RayQManager::Dequeue()
 	{
 		double t0 = EventTracker::gettime();
 
-		while (!paused && !done && rayQ.empty())
+		while (!paused && !done && (rayQ.empty() || in_flight >= window))
 			Wait();
 
 		double t1 = EventTracker::gettime();
@@ -174,15 +188,54 @@ RayQManager::Dequeue()
 
 #else
 
-	while (!done && (paused || rayQ.empty()))
+	while (!done && (paused || rayQ.empty() || in_flight >= window))
 		Wait();
 
 #endif
 
+	vector<RayList*> merged;
+
 	if (! rayQ.empty())
 	{
-		r = rayQ.front();
-		rayQ.pop_front();
+		// Stay in the current region while it has ray lists, then move on
+
+		auto q = rayQ.lower_bound(current_region);
+		if (q == rayQ.end())
+			q = rayQ.begin();
+
+		current_region = q->first;
+		list<RayList*>& l = q->second;
+
+		r = l.front();
+		l.pop_front();
+
+		// Fold in the lists that follow it in the region if they are bound for
+		// the same frame and pass
+
+		if (regions > 1)
+		{
+			int n = r->GetRayCount();
+			while (! l.empty())
+			{
+				RayList *s = l.front();
+				if (s->GetTheRendering() != r->GetTheRendering() || s->GetFrame() != r->GetFrame() ||
+						s->GetPass() != r->GetPass() || s->GetType() != r->GetType() ||
+						(n + s->GetRayCount()) > renderer->GetMaxRayListSize())
+					break;
+
+				if (merged.empty())
+					merged.push_back(r);
+
+				merged.push_back(s);
+				n += s->GetRayCount();
+				l.pop_front();
+			}
+		}
+
+		if (l.empty())
+			rayQ.erase(q);
+
+		in_flight++;
 	}
 
   if (!r && !done)
@@ -190,9 +243,91 @@ RayQManager::Dequeue()
 
 	Unlock();
 
+	if (! merged.empty())
+	{
+		r = RayList::Merge(merged);
+		for (auto s : merged)
+			delete s;
+	}
+
 	return r;
 }
 
+void
+RayQManager::Finished()
+{
+	Lock();
+	in_flight--;
+	Signal();
+	pthread_cond_broadcast(&drained);
+	Unlock();
+}
+
+void
+RayQManager::WaitUntilDrained(std::function<bool()> stop)
+{
+	Lock();
+	while (! stop() && ! (rayQ.empty() && in_flight == 0))
+		pthread_cond_wait(&drained, &lock);
+	Unlock();
+}
+
+void
+RayQManager::Wake()
+{
+	Lock();
+	pthread_cond_broadcast(&drained);
+	Unlock();
+}
+
+int
+RayQManager::region_of(RayList *r)
+{
+	if (regions < 2 || r->GetRayCount() == 0)
+		return 0;
+
+	Box *box = r->GetTheRendering()->GetTheVisualization()->get_local_box();
+
+	// The mean of the points at which a sample of the rays enter the local box
+
+	int step = r->GetRayCount() > 8 ? r->GetRayCount() / 8 : 1;
+
+	vec3f sum(0.0, 0.0, 0.0);
+	int k = 0;
+	for (int i = 0; i < r->GetRayCount(); i += step)
+	{
+		vec3f o(r->get_ox(i), r->get_oy(i), r->get_oz(i));
+		vec3f d(r->get_dx(i), r->get_dy(i), r->get_dz(i));
+
+		float tmin, tmax;
+		if (box->intersect(o, d, tmin, tmax))
+		{
+			sum = sum + (o + d * tmin);
+			k++;
+		}
+	}
+
+	if (k == 0)
+		return 0;
+
+	vec3f c = sum * (1.0 / k);
+	float *cp = (float *)&c;
+
+	// z-major, so successive regions are successive z slabs
+
+	int key = 0;
+	for (int a = 2; a >= 0; a--)
+	{
+		float extent = box->get_max()[a] - box->get_min()[a];
+		int i = extent > 0 ? (int)(regions * (cp[a] - box->get_min()[a]) / extent) : 0;
+		if (i < 0) i = 0;
+		if (i >= regions) i = regions - 1;
+		key = key * regions + i;
+	}
+
+	return key;
+}
+
 #ifdef GXY_WRITE_IMAGES
 void
 RayQManager::Pause()
@@ -221,6 +356,7 @@ RayQManager::Resume()
 	Signal();
 	Unlock();
 }
+#endif
 
 void
 RayQManager::GetQueuedRayCount(int& n, int& k)
@@ -228,15 +364,54 @@ RayQManager::GetQueuedRayCount(int& n, int& k)
 	Lock();
 
 	n = 0, k = 0;
-	for (auto a : rayQ)
+	for (auto& q : rayQ)
+		for (auto a : q.second)
+		{
+			n ++;
+			k = k + a->GetRayCount();
+		}
+
+	Unlock();
+}
+
+int
+RayQManager::Purge(RenderingSet *rs, int fnum)
+{
+	std::vector<RayList*> purged;
+
+	Lock();
+
+	for (auto q = rayQ.begin(); q != rayQ.end(); )
 	{
-		n ++;
-		k = k + a->GetRayCount();
+		list<RayList*>& l = q->second;
+		for (auto i = l.begin(); i != l.end(); )
+			if ((*i)->GetTheRenderingSet().get() == rs && (*i)->GetFrame() < fnum)
+			{
+				purged.push_back(*i);
+				i = l.erase(i);
+			}
+			else
+				i++;
+
+		if (l.empty())
+			q = rayQ.erase(q);
+		else
+			q++;
 	}
 
+	pthread_cond_broadcast(&drained);
 	Unlock();
+
+	for (auto r : purged)
+	{
+		delete r;
+#ifdef GXY_WRITE_IMAGES
+		rs->DecrementRayListCount();
+#endif // GXY_WRITE_IMAGES
+	}
+
+	return purged.size();
 }
-#endif
 
 void
 RayQManager::Enqueue(RayList *r)
@@ -244,19 +419,29 @@ RayQManager::Enqueue(RayList *r)
 	// This is called when a ray list is introduced - either
 	// the initial local rays or from another process.
 
-	
+  if (! r)
+  {
+    cerr << "WARNING: Enqueuing NULL raylist!" << endl;
+    return;
+  }
+
   if (r->GetTheRenderingSet()->IsActive(r->GetFrame()))
   {
-    if (! r)
-			cerr << "WARNING: Enqueuing NULL raylist!" << endl;
+		// The queued ray lists are the lookahead for paged volumes
+
+		renderer->Prefetch(r);
+
+		int region = region_of(r);
 
 		Lock();
 
-		rayQ.push_back(r);
+		rayQ[region].push_back(r);
 
 		if (! paused)
 			Signal();
 
+		pthread_cond_broadcast(&drained);
+
 		Unlock();
 	}
 	else
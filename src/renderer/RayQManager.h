@@ -25,7 +25,9 @@
  * \ingroup render
  */
 
+#include <functional>
 #include <list>
+#include <map>
 #include <pthread.h>
 #include <time.h>
 
@@ -40,7 +42,15 @@ namespace gxy
 class Renderer;
 
 //! the manager for RayList processing at each node
-/*! \ingroup render */
+/*! \ingroup render 
+ * Queued RayLists are keyed by the region of the local box their rays enter, on a 
+ * grid of GXY_RAYQ_REGIONS (default 2) regions per axis.   The lists of one region are
+ * dispatched before moving on to the next, and consecutive lists of a region bound for
+ * the same frame and pass are merged up to the Renderer's maximum RayList size.   At
+ * most as many lists as there are pool threads are in progress at once, so the order
+ * isn't lost in the thread pool's queue.   GXY_RAYQ_REGIONS=1 restores first-in, 
+ * first-out dispatch without merging or throttling.
+ */
 class RayQManager
 {
 public:
@@ -61,6 +71,10 @@ public:
 
 	void Enqueue(RayList *r); //!< add the given RayList to this ray queue
 	RayList *Dequeue(); //!< remove a RayList from this ray queue
+	void Finished(); //!< note that the processing of a RayList from Dequeue is complete
+
+	//! drop the queued RayLists of the given RenderingSet from frames before fnum, returning how many were dropped
+	int Purge(RenderingSet *rs, int fnum);
 
 	//! global check across all processes whether the rendering is done
 	/*! this call is used when Galaxy writes images to determine if a frame is done and the image can be written
@@ -84,18 +98,29 @@ public:
 #ifdef GXY_WRITE_IMAGES
 	void Pause(); //!< pause queue processing, used when writing an image
 	void Resume(); //!< resume queue processing after a Pause
+#endif
+
 	//! put the number of RayList objects and the total number of Rays into the given ints
 	/*! \param n receives the number of RayList objects
 	 * \param k receives the total number of Rays
 	 */
 	void  GetQueuedRayCount(int& n, int& k); 
-#endif
+
+	//! wait until no RayLists are queued or in progress at this process, or until `stop` returns true
+	/*! `stop` is tested with the queue locked, and again whenever a RayList is enqueued,
+	 * finished or purged, or Wake is called.
+	 */
+	void WaitUntilDrained(std::function<bool()> stop);
+
+	//! have any WaitUntilDrained retest its stop condition
+	void Wake();
     
 private:
     Renderer *renderer;
 
 	pthread_mutex_t lock;
 	pthread_cond_t  wait;
+	pthread_cond_t  drained;    // broadcast when the queue or in_flight changes
 	pthread_t       tid;
 	
 	bool paused;
@@ -113,6 +138,14 @@ private:
 	bool done;
 	static void   			*theRayQWorker(void *d);
 
+	//! the region of the local box the rays of the RayList enter
+	int region_of(RayList *r);
+
+	int regions;        // per axis; 1 for FIFO dispatch
+	int current_region;
+	int in_flight;      // lists dequeued and not yet Finished
+	int window;         // limit on in_flight
+
 	class SendStateMsg : public Work
   {
   public:
@@ -141,7 +174,7 @@ private:
     bool CollectiveAction(MPI_Comm c, bool isRoot);
   };
 
-	std::list<RayList*> rayQ;
+	std::map<int, std::list<RayList*>> rayQ;   // by region; no empty lists
 };
 
 } // namespace gxy
@@ -65,10 +65,13 @@ RayList::RayList(RendererP renderer, RenderingSetP rs, RenderingP r, int nrays,
 	h->size 						= nrays;
 	h->aligned_size 		= nn;
 	h->type 						= type;
+	h->pass 						= 0;
 
 	ispc = malloc(sizeof(ispc::RayList_ispc));
 	setup_ispc_pointers();
 
+	weight = 1;
+
 	pthread_mutex_lock(&raylist_lock);
 	h->id = raylist_id++;
 	pthread_mutex_unlock(&raylist_lock);
@@ -85,6 +88,8 @@ RayList::RayList(SharedP c)
 
 	ispc = malloc(sizeof(ispc::RayList_ispc));
 	setup_ispc_pointers();
+
+	weight = 1;
 }
 
 RayList::~RayList()
@@ -212,6 +217,7 @@ RayList::Split(vector<RayList*>& subsets)
     int this_rpp = ((i + rpp) > GetRayCount()) ? GetRayCount() - i : rpp;
  
     RayList *part = new RayList(GetTheRenderer(), GetTheRenderingSet(), GetTheRendering(), this_rpp, GetFrame(), GetType());
+    part->SetPass(GetPass());
 
     memcpy(part->get_ox_base(),     get_ox_base()     + i, this_rpp*sizeof(float));
     memcpy(part->get_oy_base(),     get_oy_base()     + i, this_rpp*sizeof(float));
@@ -242,6 +248,55 @@ RayList::Split(vector<RayList*>& subsets)
   }
 } 
 
+RayList *
+RayList::Merge(vector<RayList*>& lists)
+{
+  RayList *first = lists[0];
+
+  int n = 0, w = 0;
+  for (auto l : lists)
+  {
+    n += l->GetRayCount();
+    w += l->weight;
+  }
+
+  RayList *merged = new RayList(first->GetTheRenderer(), first->GetTheRenderingSet(), first->GetTheRendering(), n, first->GetFrame(), first->GetType());
+  merged->SetPass(first->GetPass());
+  merged->weight = w;
+
+  // The 20 float arrays then the 5 int arrays, each of aligned_size entries
+
+  int dst_aligned = ((hdr *)merged->contents->get())->aligned_size;
+
+  int k = 0;
+  for (auto l : lists)
+  {
+    int m = l->GetRayCount();
+    int src_aligned = ((hdr *)l->contents->get())->aligned_size;
+
+    unsigned char *src = l->contents->get() + HDRSZ;
+    unsigned char *dst = merged->contents->get() + HDRSZ;
+
+    for (int i = 0; i < 20; i++)
+    {
+      memcpy(dst + k*sizeof(float), src, m*sizeof(float));
+      src += src_aligned*sizeof(float);
+      dst += dst_aligned*sizeof(float);
+    }
+
+    for (int i = 0; i < 5; i++)
+    {
+      memcpy(dst + k*sizeof(int), src, m*sizeof(int));
+      src += src_aligned*sizeof(int);
+      dst += dst_aligned*sizeof(int);
+    }
+
+    k += m;
+  }
+
+  return merged;
+}
+
 void
 RayList::Truncate(int n)
 {
@@ -259,6 +314,7 @@ RayList::Truncate(int n)
 		new_h->renderingSetKey  = old_h->renderingSetKey;
 		new_h->renderingKey     = old_h->renderingKey;
 		new_h->frame         		= old_h->frame;
+		new_h->pass         		= old_h->pass;
 		new_h->size         		= n;
 		new_h->aligned_size 		= new_aligned_size;
 
@@ -56,6 +56,7 @@ private:
 		int aligned_size;
 		int id;
 	  RayListType type;
+		int pass;
 	};
 
 public:
@@ -99,6 +100,8 @@ public:
 	void SetType(RayListType t) { ((struct hdr *)contents->get())->type = t; }; //!< set the type of rays in this RayList
 
 	int GetFrame() { return ((struct hdr *)contents->get())->frame; } //!< returns which frame this RayList renders into
+	int GetPass() { return ((struct hdr *)contents->get())->pass; } //!< returns which progressive pass of the frame these rays sample
+	void SetPass(int p) { ((struct hdr *)contents->get())->pass = p; } //!< set which progressive pass of the frame these rays sample
 	int GetRayCount() { return ((struct hdr *)contents->get())->size; } //!< returns the number of rays in this RayList
 	int GetId() { return ((struct hdr *)contents->get())->id; } //!< return the pixel id this RayList renders into
 	SharedP get_ptr() { return contents; }; //!< returns a shared pointer to the ISPC contents of this ray list
@@ -121,6 +124,13 @@ public:
 	 * The last RayList of the set contains any remaining rays, and thus may have fewer than the maximum number.
 	 */
 	void Split(std::vector<RayList*>& subsets);
+	//! concatenate RayLists into a single new RayList
+	/*! The lists must be of the same frame, pass and type of the same Rendering.   The 
+	 * new RayList's weight is the sum of theirs; the lists themselves are left to the caller.
+	 */
+	static RayList *Merge(std::vector<RayList*>& lists);
+	//! get the number of queued RayLists this RayList stands for; more than one if they were merged into it
+	int GetWeight() { return weight; }
 
 	//! configure pointers for the ISPC representation of this RayList
 	void setup_ispc_pointers();
@@ -224,6 +234,7 @@ private:
 
 	SharedP contents;
 	void* ispc;
+	int weight;
 };
 
 } // namespace gxy
@@ -0,0 +1,80 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+
+#include "RenderTimings.h"
+
+namespace gxy
+{
+
+std::atomic<long> RenderTimings::nanoseconds[RenderTimings::NUMBER_OF_PHASES];
+std::atomic<long> RenderTimings::counts[RenderTimings::NUMBER_OF_PHASES];
+std::atomic<long> RenderTimings::bytes_sent;
+std::atomic<long> RenderTimings::bytes_received;
+
+static const char *phase_names[] = 
+{
+  "camera_spawn",
+  "trace",
+  "classify",
+  "assign_destinations",
+  "handle_terminated_rays",
+  "send",
+  "receive",
+  "composite"
+};
+
+const char *
+RenderTimings::Name(int phase)
+{
+  return (phase >= 0 && phase < NUMBER_OF_PHASES) ? phase_names[phase] : "unknown";
+}
+
+void
+RenderTimings::Get(double *seconds, long *runs)
+{
+  for (int i = 0; i < NUMBER_OF_PHASES; i++)
+  {
+    seconds[i] = nanoseconds[i].load(std::memory_order_relaxed) / 1e9;
+    runs[i] = counts[i].load(std::memory_order_relaxed);
+  }
+}
+
+void
+RenderTimings::GetBytes(long& sent, long& received)
+{
+  sent = bytes_sent.load(std::memory_order_relaxed);
+  received = bytes_received.load(std::memory_order_relaxed);
+}
+
+void
+RenderTimings::Reset()
+{
+  for (int i = 0; i < NUMBER_OF_PHASES; i++)
+  {
+    nanoseconds[i].store(0, std::memory_order_relaxed);
+    counts[i].store(0, std::memory_order_relaxed);
+  }
+
+  bytes_sent.store(0, std::memory_order_relaxed);
+  bytes_received.store(0, std::memory_order_relaxed);
+}
+
+} // namespace gxy
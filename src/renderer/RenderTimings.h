@@ -0,0 +1,111 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+
+#pragma once
+
+/*! \file RenderTimings.h 
+ * \brief accumulated time spent in each phase of ray processing
+ * \ingroup render
+ */
+
+#include <atomic>
+#include <chrono>
+
+namespace gxy
+{
+
+//! accumulated time spent in each phase of ray processing at this process
+/*! \ingroup render
+ * Each phase counts the time spent in it, summed over the threads that ran it,
+ * and the number of times it ran.   The counts are kept from process start or
+ * the last Reset, across frames and RenderingSets.   Phases nest where the 
+ * work does: handle terminated rays includes the compositing of pixels that 
+ * stay at this process, and send and receive cover packing a RayList into its 
+ * message and unpacking and queueing it, not the MPI transfer done by the 
+ * message thread.   The bytes of ray messages sent and received are counted
+ * alongside.
+ */
+class RenderTimings
+{
+public:
+  //! the timed phases
+  enum Phase
+  {
+    SPAWN,          //!< generating camera rays
+    TRACE,          //!< Renderer::Trace
+    CLASSIFY,       //!< Renderer::Classify
+    ASSIGN,         //!< Renderer::AssignDestinations
+    TERMINATE,      //!< Renderer::HandleTerminatedRays
+    SEND,           //!< Renderer::SendRays
+    RECEIVE,        //!< the Action of a SendRaysMsg
+    COMPOSITE,      //!< accumulating pixels into an owned Rendering's framebuffer
+    NUMBER_OF_PHASES
+  };
+
+  //! the name of a phase, as used in reports
+  static const char *Name(int phase);
+
+  //! add `seconds` to a phase and count one run of it
+  static void Add(int phase, double seconds)
+  {
+    nanoseconds[phase].fetch_add((long)(seconds * 1e9), std::memory_order_relaxed);
+    counts[phase].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  //! get the seconds spent in and run counts of every phase
+  /*! each array receives NUMBER_OF_PHASES values */
+  static void Get(double *seconds, long *runs);
+
+  //! count the bytes of a ray message sent by this process
+  static void AddBytesSent(long n) { bytes_sent.fetch_add(n, std::memory_order_relaxed); }
+  //! count the bytes of a ray message received by this process
+  static void AddBytesReceived(long n) { bytes_received.fetch_add(n, std::memory_order_relaxed); }
+
+  //! get the bytes of ray messages sent and received
+  static void GetBytes(long& sent, long& received);
+
+  //! zero all phases and byte counts
+  static void Reset();
+
+  //! adds the time from its construction to its destruction to a phase
+  class Scope
+  {
+  public:
+    Scope(int p) : phase(p), t0(std::chrono::steady_clock::now()) {}
+    ~Scope()
+    {
+      std::chrono::duration<double> d = std::chrono::steady_clock::now() - t0;
+      Add(phase, d.count());
+    }
+
+  private:
+    int phase;
+    std::chrono::steady_clock::time_point t0;
+  };
+
+private:
+  static std::atomic<long> nanoseconds[NUMBER_OF_PHASES];
+  static std::atomic<long> counts[NUMBER_OF_PHASES];
+  static std::atomic<long> bytes_sent;
+  static std::atomic<long> bytes_received;
+};
+
+} // namespace gxy
@@ -25,7 +25,9 @@
 #include <sstream>
 #include <fstream>
 #include <vector>
+#include <algorithm>
 #include <math.h>
+#include <time.h>
 
 #include <ospray/ospray.h>
 
@@ -38,6 +40,7 @@
 #include "RayFlags.h"
 #include "RayQManager.h"
 #include "Renderer.h"
+#include "RenderTimings.h"
 #include "TraceRays.h"
 #include "Work.h"
 #include "Threading.h"
@@ -64,14 +67,11 @@ using namespace std;
 namespace gxy
 {
 WORK_CLASS_TYPE(Renderer::RenderMsg);
+WORK_CLASS_TYPE(Renderer::CancelMsg);
 WORK_CLASS_TYPE(Renderer::StatisticsMsg);
 WORK_CLASS_TYPE(Renderer::SendRaysMsg);
 WORK_CLASS_TYPE(Renderer::SendPixelsMsg);
 
-#ifdef GXY_WRITE_IMAGES
-WORK_CLASS_TYPE(Renderer::AckRaysMsg);
-#endif // GXY_WRITE_IMAGES
-
 KEYED_OBJECT_CLASS_TYPE(Renderer)
 
 // define class static variables
@@ -81,6 +81,9 @@ int Renderer::KEEP_HERE     = -3;
 int Renderer::UNDETERMINED  = -4;
 int Renderer::NO_NEIGHBOR   = -1;
 
+pthread_mutex_t Renderer::hook_lock = PTHREAD_MUTEX_INITIALIZER;
+std::map<Key, Renderer::FrameStartHook> Renderer::frame_start_hooks;
+
 void
 Renderer::Initialize()
 {
@@ -97,6 +100,7 @@ Renderer::Initialize()
   RenderingSet::Register();
  
   RenderMsg::Register();
+  CancelMsg::Register();
   SendRaysMsg::Register();
   SendPixelsMsg::Register();
   StatisticsMsg::Register();
@@ -105,10 +109,6 @@ Renderer::Initialize()
 
   Vis::Register();
   Visualization::Register();
-
-#ifdef GXY_WRITE_IMAGES
-  AckRaysMsg::Register();
-#endif // GXY_WRITE_IMAGES
 }
 
 static  void
@@ -125,6 +125,8 @@ Renderer::initialize()
   epsilon = 0.001;
 
   frame = 0;
+  progressive_running = false;
+  progressive_stop = false;
   rayQmanager = new RayQManager(this);
   pthread_mutex_init(&lock, NULL);
 
@@ -146,6 +148,15 @@ Renderer::initialize()
     SetPermutePixels(true);
 #endif
 
+  char *passes = getenv("GXY_PROGRESSIVE_PASSES");
+  SetProgressivePasses(passes ? atoi(passes) : 1);
+
+  char *stride = getenv("GXY_PROGRESSIVE_STRIDE");
+  SetProgressiveStride(stride ? atoi(stride) : 4);
+
+  char *budget = getenv("GXY_FRAME_BUDGET");
+  SetFrameBudget(budget ? atof(budget) : 0.0);
+
   char *ospMsgs = getenv("GXY_SHOW_OSPRAY_MESSAGES");
   if (ospMsgs && atoi(ospMsgs) > 0)
     ospDeviceSetStatusFunc(ospGetCurrentDevice(), print_ospray_error_messages);
@@ -153,6 +164,7 @@ Renderer::initialize()
 
 Renderer::~Renderer()
 {
+    stop_progressive();
     rayQmanager->Kill();
     delete rayQmanager;
 }
@@ -176,9 +188,84 @@ Renderer::local_commit(MPI_Comm c)
   return false;
 }
 
+static double
+milliseconds()
+{
+  timespec s;
+  clock_gettime(CLOCK_MONOTONIC, &s);
+  return 1000.0*s.tv_sec + s.tv_nsec / 1000000.0;
+}
+
+struct progressive_args
+{
+  progressive_args(RendererP r, RenderingSetP rs, int fnum, double t) : renderer(r), renderingSet(rs), fnum(fnum), t_start(t) {}
+
+  RendererP renderer;
+  RenderingSetP renderingSet;
+  int fnum;
+  double t_start;
+  std::vector<std::future<int>> rvec;
+};
+
+void *
+Renderer::progressive_thread(void *d)
+{
+  progressive_args *a = (progressive_args *)d;
+  RendererP renderer = a->renderer;
+  RenderingSetP renderingSet = a->renderingSet;
+
+  auto stopped = [&]() {
+    return renderer->progressive_stop || renderingSet->GetCurrentFrame() != a->fnum;
+  };
+
+  for (int pass = 1; pass < renderer->GetProgressivePasses(); pass++)
+  {
+    // Wait for the previous pass to be spawned and for its rays to drain
+    // from this process: none queued and none being traced.  Give up if a 
+    // later frame has begun or the Renderer is stopping the thread.
+
+    for (auto& r : a->rvec)
+      r.get();
+    a->rvec.clear();
+
+    renderer->GetTheRayQManager()->WaitUntilDrained(stopped);
+
+    if (stopped())
+      break;
+
+    // The budget only limits refinement; the second pass completes the 
+    // coverage of the image and is always issued
+
+    float budget = renderer->GetFrameBudget();
+    if (pass > 1 && budget > 0 && (milliseconds() - a->t_start) > budget)
+      break;
+
+    for (int i = 0; i < renderingSet->GetNumberOfRenderings(); i++)
+    {
+      RenderingP rendering = renderingSet->GetRendering(i);
+      VisualizationP visualization = rendering->GetTheVisualization();
+
+      rendering->GetTheCamera()->generate_initial_rays(renderer, renderingSet, rendering, 
+          visualization->get_local_box(), visualization->get_global_box(), a->rvec, a->fnum, pass);
+    }
+  }
+
+  for (auto& r : a->rvec)
+    r.get();
+
+#ifdef GXY_WRITE_IMAGES
+  renderingSet->DecrementActiveCameraCount(0);
+#endif
+
+  delete a;
+  pthread_exit(NULL);
+}
+
 void
 Renderer::local_render(RendererP renderer, RenderingSetP renderingSet)
 {
+  double t_start = milliseconds();
+
 #ifdef GXY_EVENT_TRACKING
   GetTheEventTracker()->Add(new StartRenderingEvent);
 #endif
@@ -250,6 +337,26 @@ Renderer::local_render(RendererP renderer, RenderingSetP renderingSet)
       camera->generate_initial_rays(renderer, renderingSet, rendering, lBox, gBox, rvec, fnum);
     }
 
+    // The later passes of a progressive frame are issued from a separate thread
+    // as this process works through the rays of the earlier ones
+
+    if (progressive_passes > 1)
+    {
+#ifdef GXY_WRITE_IMAGES
+      renderingSet->IncrementActiveCameraCount();     // Matching Decrement in progressive_thread
+#endif
+
+      progressive_args *a = new progressive_args(renderer, renderingSet, fnum, t_start);
+      a->rvec.swap(rvec);
+
+      // Only one progressive frame is refined at a time
+
+      stop_progressive();
+
+      pthread_create(&progressive_tid, NULL, progressive_thread, (void *)a);
+      progressive_running = true;
+    }
+
 #ifdef GXY_PRODUCE_STATUS_MESSAGES
     renderingSet->_dumpState(c, "status"); // Note this will sync after cameras, I think
 #endif
@@ -268,6 +375,26 @@ Renderer::local_render(RendererP renderer, RenderingSetP renderingSet)
   
 }
 
+void
+Renderer::stop_progressive()
+{
+  if (! progressive_running)
+    return;
+
+  progressive_stop = true;
+  GetTheRayQManager()->Wake();
+
+  // The thread holds a reference to the Renderer, so may be the one destroying it
+
+  if (pthread_equal(progressive_tid, pthread_self()))
+    pthread_detach(progressive_tid);
+  else
+    pthread_join(progressive_tid, NULL);
+
+  progressive_running = false;
+  progressive_stop = false;
+}
+
 bool
 Renderer::LoadStateFromDocument(Document& doc)
 {
@@ -292,6 +419,15 @@ Renderer::LoadStateFromValue(Value& v)
   if (v.HasMember("epsilon"))
     SetEpsilon(v["epsilon"].GetDouble());
 
+  if (v.HasMember("progressive passes"))
+    SetProgressivePasses(v["progressive passes"].GetInt());
+
+  if (v.HasMember("progressive stride"))
+    SetProgressiveStride(v["progressive stride"].GetInt());
+
+  if (v.HasMember("frame budget"))
+    SetFrameBudget(v["frame budget"].GetDouble());
+
   return true;
 }
 
@@ -299,6 +435,9 @@ void
 Renderer::SaveStateToValue(Value& v, Document& doc)
 {
   v.AddMember("epsilon", Value().SetDouble(GetEpsilon()), doc.GetAllocator());
+  v.AddMember("progressive passes", Value().SetInt(GetProgressivePasses()), doc.GetAllocator());
+  v.AddMember("progressive stride", Value().SetInt(GetProgressiveStride()), doc.GetAllocator());
+  v.AddMember("frame budget", Value().SetDouble(GetFrameBudget()), doc.GetAllocator());
 }
 
 void
@@ -420,6 +559,46 @@ Renderer::Classify(RayList *raylist)
   }
 }
 
+void
+Renderer::Prefetch(RayList *raylist)
+{
+  VisualizationP visualization = raylist->GetTheRendering()->GetTheVisualization();
+
+  std::vector<VolumeP> paged;
+  for (int i = 0; i < visualization->GetNumberOfVis(); i++)
+  {
+    VolumeP v = Volume::Cast(visualization->GetVis(i)->GetTheData());
+    if (v && v->is_paged())
+      paged.push_back(v);
+  }
+
+  if (paged.empty())
+    return;
+
+  // The z range of the segments of the rays within the local box
+
+  Box *box = visualization->get_local_box();
+  float zmin = FLT_MAX, zmax = -FLT_MAX;
+
+  for (int i = 0; i < raylist->GetRayCount(); i++)
+  {
+    float oz = raylist->get_oz(i), dz = raylist->get_dz(i);
+    float tmin, tmax;
+    if (box->intersect(raylist->get_ox(i), raylist->get_oy(i), oz,
+                       raylist->get_dx(i), raylist->get_dy(i), dz, tmin, tmax))
+    {
+      float z0 = oz + tmin*dz, z1 = oz + tmax*dz;
+      if (z0 > z1) std::swap(z0, z1);
+      if (z0 < zmin) zmin = z0;
+      if (z1 > zmax) zmax = z1;
+    }
+  }
+
+  if (zmin <= zmax)
+    for (auto v : paged)
+      v->Prefetch(zmin, zmax);
+}
+
 void
 Renderer::AssignDestinations(RayList *raylist)
 {
@@ -433,8 +612,29 @@ Renderer::AssignDestinations(RayList *raylist)
       int exit_face = box->exit_face(raylist->get_ox(i), raylist->get_oy(i), raylist->get_oz(i),
                                    raylist->get_dx(i), raylist->get_dy(i), raylist->get_dz(i));
 
-      if (visualization->has_neighbor(exit_face)) 
-        raylist->set_classification(i, visualization->get_neighbor(exit_face));
+      int neighbor = visualization->has_neighbor(exit_face) ? visualization->get_neighbor(exit_face) : -1;
+
+      // Data that isn't partitioned on a regular grid of processes may have
+      // several neighbors across a face; send the ray to the owner of the point
+      // just beyond where it leaves the local box
+
+      if (visualization->routes_by_owner())
+      {
+        vec3f o(raylist->get_ox(i), raylist->get_oy(i), raylist->get_oz(i));
+        vec3f d(raylist->get_dx(i), raylist->get_dy(i), raylist->get_dz(i));
+
+        float tmin, tmax;
+        if (box->intersect(o, d, tmin, tmax))
+        {
+          float eps = 1e-4 * box->diag() / sqrt(d * d);
+          vec3f p = o + d * (tmax + eps);
+          int owner = visualization->PointOwner(p);
+          neighbor = (owner == GetTheApplication()->GetRank()) ? neighbor : owner;
+        }
+      }
+
+      if (neighbor >= 0)
+        raylist->set_classification(i, neighbor);
       else
       {
         int t = raylist->get_type(i);
@@ -480,6 +680,7 @@ Renderer::HandleTerminatedRays(RayList *raylist)
       p->g = raylist->get_g(i);
       p->b = raylist->get_b(i);
       p->o = raylist->get_o(i);
+      p->samples = raylist->get_type(i) == RAY_PRIMARY ? 1 : 0;
       p++;
     }
 
@@ -501,6 +702,67 @@ Renderer::HandleTerminatedRays(RayList *raylist)
   }
 }
 
+// GXY_RAY_SORT: ray lists of at least this many rays are sorted by direction
+// octant and then by the Morton order of their origins in the local box before
+// they are traced, so that successive rays sample nearby data.  0 (the default)
+// for no sorting.
+
+static int
+ray_sort_threshold()
+{
+  static int t = getenv("GXY_RAY_SORT") ? atoi(getenv("GXY_RAY_SORT")) : 0;
+  return t;
+}
+
+// Spread the low 10 bits of v to every third bit
+
+static unsigned int
+spread_bits(unsigned int v)
+{
+  v &= 0x3ff;
+  v = (v | (v << 16)) & 0x030000ff;
+  v = (v | (v << 8))  & 0x0300f00f;
+  v = (v | (v << 4))  & 0x030c30c3;
+  v = (v | (v << 2))  & 0x09249249;
+  return v;
+}
+
+static RayList *
+sort_rays(RayList *in, Box *box)
+{
+  int n = in->GetRayCount();
+  float *lo = box->get_min();
+  float *hi = box->get_max();
+
+  std::vector<std::pair<unsigned long, int>> keys(n);
+  for (int i = 0; i < n; i++)
+  {
+    float o[] = {in->get_ox(i), in->get_oy(i), in->get_oz(i)};
+
+    unsigned int m = 0;
+    for (int a = 0; a < 3; a++)
+    {
+      float f = (hi[a] > lo[a]) ? (o[a] - lo[a]) / (hi[a] - lo[a]) : 0.0;
+      f = (f < 0.0) ? 0.0 : (f > 1.0) ? 1.0 : f;
+      m |= spread_bits((unsigned int)(f * 1023)) << a;
+    }
+
+    unsigned long octant = (in->get_dx(i) < 0 ? 1 : 0) | (in->get_dy(i) < 0 ? 2 : 0) | (in->get_dz(i) < 0 ? 4 : 0);
+    keys[i] = std::pair<unsigned long, int>((octant << 30) | m, i);
+  }
+
+  std::sort(keys.begin(), keys.end());
+
+  RayList *out = new RayList(in->GetTheRenderer(), in->GetTheRenderingSet(), in->GetTheRendering(), n, in->GetFrame(), in->GetType());
+  out->SetPass(in->GetPass());
+
+  for (int i = 0; i < n; i++)
+    RayList::CopyRay(in, keys[i].second, out, i);
+
+  delete in;
+  return out;
+}
+
 class processRays_task : public ThreadPoolTask
 {
 public:
@@ -508,7 +770,22 @@ public:
     ThreadPoolTask(raylist->GetType() == RayList::PRIMARY ? 3 : 2), raylist(raylist), renderer(renderer) {}
   ~processRays_task() {}
 
-	int work() { 
+	int work()
+	{
+		// Let the ray queue dispatch another list
+
+		RayQManager *rayQ = renderer->GetTheRayQManager();
+		int status = process();
+		rayQ->Finished();
+		return status;
+	}
+
+private:
+	int process() { 
+
+		// The number of queued ray lists this one stands for
+
+		int weight = raylist->GetWeight();
 
 		RendererP      renderer      = raylist->GetTheRenderer();
 		RenderingSetP  renderingSet  = raylist->GetTheRenderingSet();
@@ -543,17 +820,32 @@ public:
 			// else
 				// std::cerr << GetTheApplication()->GetRank() << " processing raylist " << raylist->GetRayCount() << "\n";
 
+			if (ray_sort_threshold() && raylist->GetRayCount() >= ray_sort_threshold())
+				raylist = sort_rays(raylist, visualization->get_local_box());
+
 			// This may put secondary lists on the ray queue
-			renderer->Trace(raylist);
+			{
+				RenderTimings::Scope t(RenderTimings::TRACE);
+				renderer->Trace(raylist);
+			}
 
       // Classify annotated rays
-      renderer->Classify(raylist);
+      {
+        RenderTimings::Scope t(RenderTimings::CLASSIFY);
+        renderer->Classify(raylist);
+      }
 
       // Assign destinations to rays that need to go elsewhere
-      renderer->AssignDestinations(raylist);
+      {
+        RenderTimings::Scope t(RenderTimings::ASSIGN);
+        renderer->AssignDestinations(raylist);
+      }
 
       // And handle the ones that terminate
-      renderer->HandleTerminatedRays(raylist);
+      {
+        RenderTimings::Scope t(RenderTimings::TERMINATE);
+        renderer->HandleTerminatedRays(raylist);
+      }
 
 			// OK, now we know the fate of the input rays.   Partition them accordingly
 			// counts going to each destination - six exit faces and stay right here.
@@ -589,11 +881,16 @@ public:
 
 			RayList **ray_lists = new RayList*[GetTheApplication()->GetSize()];
       RayList *keepers = (nKeepers > 0) ? new RayList(renderer, renderingSet, rendering, nKeepers, raylist->GetFrame(), raylist->GetType()) : (RayList *)NULL;
+      if (keepers)
+        keepers->SetPass(raylist->GetPass());
         
 			for (int i = 0; i < GetTheApplication()->GetSize(); i++)
 			{
 				if (knts[i])
+				{
 					ray_lists[i]   = new RayList(renderer, renderingSet, rendering, knts[i], raylist->GetFrame(), raylist->GetType());
+					ray_lists[i]->SetPass(raylist->GetPass());
+				}
 				else
 					ray_lists[i]   = NULL;
 
@@ -621,8 +918,8 @@ public:
 				if (knts[i])
 				{
 #ifdef GXY_WRITE_IMAGES
-					// This process gets "ownership" of the new ray list until its recipient acknowleges 
-					renderingSet->IncrementRayListCount();
+					// Counted as sent while this process is still busy with the list it came
+					// from; the termination waves match it against the receiver's count
 					renderer->SendRays(ray_lists[i], i);
 #else
 					if (renderingSet->IsActive(ray_lists[i]->GetFrame()))
@@ -644,13 +941,13 @@ public:
 
 #ifdef GXY_WRITE_IMAGES
     // Finished processing this ray list.  
-    renderingSet->DecrementRayListCount();
+    for (int i = 0; i < weight; i++)
+      renderingSet->DecrementRayListCount();
 #endif //  GXY_WRITE_IMAGES
 
     return 0;
   }
 
-private:
   RayList *raylist;
   Renderer *renderer;
 };
@@ -732,20 +1029,26 @@ Renderer::StatisticsMsg::CollectiveAction(MPI_Comm c, bool is_root)
 void 
 Renderer::SendRays(RayList *rays, int destination)
 {
+  RenderTimings::Scope t(RenderTimings::SEND);
+
 #ifdef GXY_WRITE_IMAGES
-  rays->GetTheRenderingSet()->IncrementInFlightCount();
+  rays->GetTheRenderingSet()->RayListSent();
 #endif
 
   int nReceived = rays->GetRayCount();
   _sent_to(destination, nReceived);
 
   SendRaysMsg msg(rays);
+  RenderTimings::AddBytesSent(msg.get_size());
   msg.Send(destination);
 }
 
 bool
 Renderer::SendRaysMsg::Action(int sender)
 {
+  RenderTimings::Scope t(RenderTimings::RECEIVE);
+  RenderTimings::AddBytesReceived(get_size());
+
   RayList *rayList = new RayList(this->contents);
 
   int nReceived = rayList->GetRayCount();
@@ -785,8 +1088,9 @@ Renderer::SendRaysMsg::Action(int sender)
   renderingSet->Enqueue(rayList);
 
 #ifdef GXY_WRITE_IMAGES
-  Renderer::AckRaysMsg ack(renderingSet);
-  ack.Send(sender);
+  // Counted only once enqueued, so any snapshot that includes the receipt
+  // also sees this process as busy
+  renderingSet->RayListReceived();
 #endif // GXY_WRITE_IMAGES
   
   return false;
@@ -795,7 +1099,7 @@ Renderer::SendRaysMsg::Action(int sender)
 int
 Renderer::SerialSize()
 {
-  return sizeof(bool) + sizeof(int);
+  return sizeof(bool) + 3*sizeof(int) + sizeof(float);
 }
 
 unsigned char *
@@ -805,6 +1109,12 @@ Renderer::Serialize(unsigned char *p)
   p += sizeof(bool);
   *(int*)p = max_rays_per_packet;
   p += sizeof(int);
+  *(int*)p = progressive_passes;
+  p += sizeof(int);
+  *(int*)p = progressive_stride;
+  p += sizeof(int);
+  *(float*)p = frame_budget;
+  p += sizeof(float);
 
   return p;
 }
@@ -816,26 +1126,16 @@ Renderer::Deserialize(unsigned char *p)
   p += sizeof(bool);
   max_rays_per_packet = *(int*)p;
   p += sizeof(int);
+  progressive_passes = *(int*)p;
+  p += sizeof(int);
+  progressive_stride = *(int*)p;
+  p += sizeof(int);
+  frame_budget = *(float*)p;
+  p += sizeof(float);
 
   return p;
 }
 
-#ifdef GXY_WRITE_IMAGES
-Renderer::AckRaysMsg::AckRaysMsg(RenderingSetP rs) : AckRaysMsg(sizeof(Key))
-{
-  *(Key *)contents->get() = rs->getkey();
-}
-
-bool
-Renderer::AckRaysMsg::Action(int sender)
-{
-  RenderingSetP rs = RenderingSet::GetByKey(*(Key *)contents->get());
-  rs->DecrementInFlightCount();
-  rs->DecrementRayListCount();
-  return false;
-}
-#endif // GXY_WRITE_IMAGES
-
 void
 Renderer::Start(RenderingSetP rs)
 {
@@ -861,10 +1161,63 @@ Renderer::Start(RenderingSetP rs)
   GetTheEventTracker()->Add(new StartRenderingEvent(rs->getkey()));
 #endif
 
+  pthread_mutex_lock(&hook_lock);
+  for (auto& h : frame_start_hooks)
+    h.second();
+  pthread_mutex_unlock(&hook_lock);
+
   RenderMsg msg(this, rs);
   msg.Broadcast(false, true);
 }
 
+void
+Renderer::AddFrameStartHook(Key owner, FrameStartHook hook)
+{
+  pthread_mutex_lock(&hook_lock);
+  frame_start_hooks[owner] = hook;
+  pthread_mutex_unlock(&hook_lock);
+}
+
+void
+Renderer::RemoveFrameStartHook(Key owner)
+{
+  pthread_mutex_lock(&hook_lock);
+  frame_start_hooks.erase(owner);
+  pthread_mutex_unlock(&hook_lock);
+}
+
+void
+Renderer::Cancel(RenderingSetP rs, int fnum)
+{
+  CancelMsg msg(this, rs, fnum);
+  msg.Broadcast(false, true);
+}
+
+bool
+Renderer::CancelMsg::Action(int sender)
+{
+  unsigned char *p = contents->get();
+
+  RendererP renderer = Renderer::GetByKey(*(Key *)p);
+  p += sizeof(Key);
+
+  RenderingSetP rs = RenderingSet::GetByKey(*(Key *)p);
+  p += sizeof(Key);
+
+  int fnum = *(int *)p;
+
+  if (! renderer || ! rs)
+    return false;
+
+  // Mark the frames inactive first, so nothing from them is enqueued
+  // behind the purge
+
+  rs->local_cancel(fnum);
+  renderer->GetTheRayQManager()->Purge(rs.get(), fnum);
+
+  return false;
+}
+
 void Renderer::DumpStatistics()
 {
   StatisticsMsg *s = new StatisticsMsg(this);
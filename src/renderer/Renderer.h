@@ -26,6 +26,9 @@
  */
 
 #include <vector>
+#include <atomic>
+#include <functional>
+#include <map>
 
 #include "OsprayHandle.h"
 
@@ -33,6 +36,7 @@
 #include "KeyedObject.h"
 #include "Datasets.h"
 #include "pthread.h"
+#include "RayFlags.h"
 #include "Rays.h"
 #include "Visualization.h"
 #include "Rendering.h"
@@ -69,6 +73,10 @@ public:
   void ProcessRays(RayList *); //!< add the given RayList as a Task for the ThreadPool
   void SendRays(RayList *, int); //!< send the given RayList to the specified process rank
 
+  //! tell the paged Volumes of the RayList's Visualization which of their bricks its rays will enter
+  /*! Called as a RayList is queued, so the bricks are read while earlier RayLists are traced */
+  void Prefetch(RayList *);
+
   void SetEpsilon(float e); //!< set the epsilon distance for the Renderer to avoid exact comparison in certain tests
   float GetEpsilon(); //!< get the epsilon distance for the Renderer to avoid exact comparison in certain tests
 
@@ -95,6 +103,26 @@ public:
 
   //! broadcasts a RenderMsg to all processes to begin rendering via each localRendering method
 	virtual void Start(RenderingSetP);
+
+  //! a function run at the master as each frame is started, before the frame's RenderMsg is broadcast
+  typedef std::function<void()> FrameStartHook;
+
+  //! register a FrameStartHook under the key of its owner, replacing any it registered before
+  /*! Work the hook broadcasts reaches every process ahead of the RenderMsg, so whatever it changes 
+   * changes between frames.   Hooks run in Start and must not wait on rendering.
+   */
+  static void AddFrameStartHook(Key owner, FrameStartHook hook);
+
+  //! remove the FrameStartHook registered under the key; once this returns, it is not running and won't be run again
+  static void RemoveFrameStartHook(Key owner);
+
+  //! broadcasts a CancelMsg to all processes to abandon the frames of the RenderingSet before fnum
+  /*! Each process drops the queued RayLists of those frames and, via 
+   * RenderingSet::local_cancel, the RayLists and pixels still in flight.   Since
+   * messages from the master arrive in order, a RenderMsg for frame fnum sent after
+   * this finds the queues purged.
+   */
+	void Cancel(RenderingSetP, int fnum);
   //! return the frame number for the current render
 	int GetFrame() { return frame; }
 
@@ -137,6 +165,28 @@ public:
   //! get permute_pixels
   bool GetPermutePixels() { return permute_pixels; }
 
+  //! Set the number of passes made over the image for each frame; 1 (the default) renders each frame in a single pass
+  /*! With more than one pass the first samples a sparse lattice of pixels, the second fills in the rest and
+   * each later pass takes another sample of every pixel with fresh AO directions.   Renderings average the
+   * samples each pixel receives.
+   */
+  void SetProgressivePasses(int n) { progressive_passes = n < 1 ? 1 : n; }
+
+  //! get the number of passes made over the image for each frame
+  int GetProgressivePasses() { return progressive_passes; }
+
+  //! Set the spacing, in pixels, of the lattice sampled by the first pass of a progressive frame
+  void SetProgressiveStride(int s) { progressive_stride = s < 1 ? 1 : s; }
+
+  //! get the spacing of the lattice sampled by the first pass of a progressive frame
+  int GetProgressiveStride() { return progressive_stride; }
+
+  //! Set the time in milliseconds after which no further refinement passes of a frame are begun; 0 for no limit
+  void SetFrameBudget(float ms) { frame_budget = ms; }
+
+  //! get the time in milliseconds after which no further refinement passes of a frame are begun
+  float GetFrameBudget() { return frame_budget; }
+
   // These defines categorize rays after a pass through the tracer
   // TODO: reimplement as enum
   static int TERMINATED;  //!< mark that this ray has been terminated
@@ -184,6 +234,23 @@ private:
 	int max_rays_per_packet;
   bool permute_pixels;
 
+  int progressive_passes;
+  int progressive_stride;
+  float frame_budget;
+
+  //! issues the passes after the first of a progressive frame as the local ray queue drains
+  static void *progressive_thread(void *);
+
+  //! stop the thread issuing the passes of the last progressive frame, and join it
+  void stop_progressive();
+
+  pthread_t progressive_tid;
+  bool progressive_running;
+  std::atomic<bool> progressive_stop;
+
+  static pthread_mutex_t hook_lock;
+  static std::map<Key, FrameStartHook> frame_start_hooks;
+
 	int sent_ray_count;
 	int terminated_ray_count;
 	int originated_ray_count;
@@ -227,21 +294,6 @@ public:
     bool Action(int sender);
   };
 
-#ifdef GXY_WRITE_IMAGES
-  //! a Work unit to acknowledge the receipt of rays from another process
-  class AckRaysMsg : public Work
-  {
-  public:
-    AckRaysMsg(RenderingSetP rs);
-    
-    WORK_CLASS(AckRaysMsg, false);
-
-  public:
-    bool Action(int sender);
-  };
-
-#endif // GXY_WRITE_IMAGES
-
   //! a Work unit to send pixel contributions to another process
   class SendPixelsMsg : public Work
   {
@@ -303,6 +355,7 @@ public:
       p->g = rl->get_g(i);
       p->b = rl->get_b(i);
       p->o = rl->get_o(i);
+      p->samples = rl->get_type(i) == RAY_PRIMARY ? 1 : 0;
     }
 
     WORK_CLASS(SendPixelsMsg, false);
@@ -339,6 +392,25 @@ public:
     int nxt;
   };
 
+  //! a Work unit to instruct Galaxy processes to abandon the earlier frames of a RenderingSet
+  class CancelMsg : public Work
+  {
+  public:
+    CancelMsg(Renderer *r, RenderingSetP rs, int fnum) : CancelMsg(2*sizeof(Key) + sizeof(int))
+    {
+      unsigned char *p = contents->get();
+      *(Key *)p = r->getkey();
+      p += sizeof(Key);
+      *(Key *)p = rs->getkey();
+      p += sizeof(Key);
+      *(int *)p = fnum;
+    }
+
+    WORK_CLASS(CancelMsg, true);
+
+    bool Action(int sender);
+  };
+
   //! a Work unit to instruct Galaxy processes to begin rendering
   class RenderMsg : public Work
   {
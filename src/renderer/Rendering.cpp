@@ -22,12 +22,14 @@
 
 #include "Application.h"
 #include "Camera.h"
+#include "ImageQueue.h"
 #include "ImageWriter.h"
 #include "KeyedObject.h"
 #include "Rays.h"
 #include "Renderer.h"
 #include "RenderingEvents.h"
 #include "RenderingSet.h"
+#include "RenderTimings.h"
 #include "Visualization.h"
 #include "Work.h"
 
@@ -52,6 +54,7 @@ Rendering::initialize()
   height = -1;
   owner = -1;
   framebuffer = NULL;
+  sbuffer = NULL;
 	frame = -1;
 
 #ifndef GXY_WRITE_IMAGES
@@ -70,6 +73,8 @@ Rendering::~Rendering()
 		delete[] framebuffer;
 	}
 
+  if (sbuffer) delete[] sbuffer;
+
 #ifndef GXY_WRITE_IMAGES
   if (kbuffer) delete[] kbuffer;
 #endif
@@ -86,24 +91,23 @@ Rendering::IsLocal()
   return owner == GetTheApplication()->GetRank();
 }
 
+// Each pixel holds the mean of the samples that have reached it; see AccumulateSample
+
 #ifdef GXY_WRITE_IMAGES
 
-#define ACCUMULATE_PIXEL(X, Y, R, G, B, O)                            	 \
+#define ACCUMULATE_PIXEL(P)                                              \
 {                                                                        \
-	int offset = Y*width + X;																							 \
+	int offset = (P)->y*width + (P)->x;																		 \
   float *ptr = framebuffer + (offset<<2);                                \
-  *ptr++ += R;                                                           \
-  *ptr++ += G;                                                           \
-  *ptr++ += B;                                                           \
-  *ptr++ += O;                                                           \
+	AccumulateSample(ptr, sbuffer[offset], &(P)->r, (P)->samples, 4);			 \
 	accumulation_knt++;																										 \
 }
 
 #else
     
-#define ACCUMULATE_PIXEL(f, X, Y, R, G, B, O)                            \
+#define ACCUMULATE_PIXEL(f, P)                                           \
 {     	                                                                 \
-	int offset = Y*width + X;																							 \
+	int offset = (P)->y*width + (P)->x;																		 \
   float *ptr = framebuffer + (offset<<2);                                \
 	if (kbuffer[offset] < f)																							 \
 	{																																			 \
@@ -111,12 +115,10 @@ Rendering::IsLocal()
 		ptr[1] = 0;																													 \
 		ptr[2] = 0;																													 \
 		ptr[3] = 0;																													 \
+		sbuffer[offset] = 0;																								 \
 		kbuffer[offset] = f;																								 \
 	}																																			 \
-  *ptr++ += R;                                                           \
-  *ptr++ += G;                                                           \
-  *ptr++ += B;                                                           \
-  *ptr++ += O;                                                           \
+	AccumulateSample(ptr, sbuffer[offset], &(P)->r, (P)->samples, 4);			 \
 	accumulation_knt++;																										 \
 }
 
@@ -125,6 +127,8 @@ Rendering::IsLocal()
 void
 Rendering::AddLocalPixels(Pixel *p, int n, int f, int s)
 {
+  RenderTimings::Scope t(RenderTimings::COMPOSITE);
+
 #if defined(GXY_EVENT_TRACKING)
 	GetTheEventTracker()->Add(new LocalPixelsEvent(n, this->getkey(), f));
 #endif
@@ -143,9 +147,9 @@ Rendering::AddLocalPixels(Pixel *p, int n, int f, int s)
 		while (n-- > 0)
 		{
 	#ifdef GXY_WRITE_IMAGES
-			ACCUMULATE_PIXEL(p->x, p->y, p->r, p->g, p->b, p->o);
+			ACCUMULATE_PIXEL(p);
 	#else
-			ACCUMULATE_PIXEL(f, p->x, p->y, p->r, p->g, p->b, p->o);
+			ACCUMULATE_PIXEL(f, p);
 	#endif
 			p++;
 		}
@@ -226,6 +230,12 @@ Rendering::local_commit(MPI_Comm c)
     framebuffer = new float[width*height*4];
     memset(framebuffer, 0, width*height*4*sizeof(float));
 
+    if (sbuffer)
+      delete[] sbuffer;
+
+    sbuffer = new int[width*height];
+    memset(sbuffer, 0, width*height*sizeof(int));
+
 #ifndef GXY_WRITE_IMAGES
 		if (kbuffer)
 			delete[] kbuffer;
@@ -249,6 +259,7 @@ Rendering::local_reset()
       exit(1);
     }
     for (float *p = framebuffer; p < framebuffer + width*height*4; *p++ = 0.0);
+    memset(sbuffer, 0, width*height*sizeof(int));
 
 #ifndef GXY_WRITE_IMAGES
 		memset(kbuffer, 0, width*height*sizeof(int));
@@ -280,16 +291,18 @@ void Rendering::SaveImage(string filename, int indx, bool asFloat)
     filename = filename + '_' + istr + GetTheVisualization()->GetAnnotation() + GetTheCamera()->GetAnnotation();
   }
 
+  // Float images are FITS unless GXY_FLOAT_IMAGE_FORMAT asks for half-float EXR
+
+  ImageFormat format = IMAGE_PNG;
   if (asFloat)
   {
-    FloatImageWriter writer;
-    writer.Write(width, height, framebuffer, filename.c_str());
-  }
-  else
-  {
-    ColorImageWriter writer;
-    writer.Write(width, height, framebuffer, filename.c_str());
+    const char *f = getenv("GXY_FLOAT_IMAGE_FORMAT");
+    format = (f && !strcmp(f, "exr")) ? IMAGE_EXR : IMAGE_FITS;
   }
+
+  // The framebuffer is snapshotted, so the next frame can render while this one is written
+
+  ImageQueue::GetTheImageQueue()->Write(width, height, framebuffer, filename, format);
 }
 
 int
@@ -89,6 +89,9 @@ public:
 	{
 		if (framebuffer) delete[] framebuffer;
 		framebuffer = new float[width * height * 4];
+		if (sbuffer) delete[] sbuffer;
+		sbuffer = new int[width * height];
+		memset(sbuffer, 0, width * height * sizeof(int));
 #ifndef GXY_WRITE_IMAGES
 		if (kbuffer) delete[] kbuffer;
 #endif
@@ -111,6 +114,8 @@ public:
 
 	//! return a pointer to the framebuffer for this Rendering
 	float *GetPixels() { return framebuffer; }
+	//! return a pointer to the per-pixel count of samples averaged into the framebuffer
+	int *GetSampleCounts() { return sbuffer; }
 	//! return a pointer to the Lighting singleton for this rendering
 	Lighting *GetLighting() { return &lights; }
 	//! set lights for this Rendering using the given Renderer
@@ -128,6 +133,7 @@ protected:
 	int accumulation_knt;
 
 	float *framebuffer;
+	int   *sbuffer;      // per-pixel count of samples averaged into the framebuffer
 #ifndef GXY_WRITE_IMAGES
   int *kbuffer;
 #endif
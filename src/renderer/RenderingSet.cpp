@@ -31,7 +31,7 @@ WORK_CLASS_TYPE(RenderingSet::SaveImagesMsg);
 
 #ifdef GXY_WRITE_IMAGES
 WORK_CLASS_TYPE(RenderingSet::PropagateStateMsg);
-WORK_CLASS_TYPE(RenderingSet::SynchronousCheckMsg);
+WORK_CLASS_TYPE(RenderingSet::TerminationWaveMsg);
 WORK_CLASS_TYPE(RenderingSet::ResetMsg);
 WORK_CLASS_TYPE(RenderingSet::DumpStateMsg);
 #endif // GXY_WRITE_IMAGES
@@ -47,7 +47,7 @@ RenderingSet::Register()
 
 #ifdef GXY_WRITE_IMAGES
 	PropagateStateMsg::Register();
-	SynchronousCheckMsg::Register();
+	TerminationWaveMsg::Register();
 	ResetMsg::Register();
 	DumpStateMsg::Register();
 #endif // GXY_WRITE_IMAGES
@@ -81,6 +81,7 @@ RenderingSet::initialize()
 
 	current_frame = -1;
 	next_frame = 0;
+	oldest_active_frame = -1;
 
 #ifdef GXY_WRITE_IMAGES
 
@@ -106,7 +107,7 @@ RenderingSet::initialize()
 	pthread_cond_init(&w8, NULL);
 
   local_raylist_count  = 0;
-  local_inflight_count  = 0;
+  wave_in_flight = false;
 
 	local_reset();
 
@@ -157,6 +158,13 @@ RenderingSet::local_reset()
 	n_pix_sent			= 0;
 	n_pix_received	= 0;
 
+	// Count of ray lists sent to and received from other processes, compared
+	// by the termination waves
+
+	n_raylists_sent			= 0;
+	n_raylists_received	= 0;
+	last_wave_quiet			= false;
+
   // Initially there are no ray messages anywhere, so the kids are idle.
   // However, we don't want anything happening until the kids positively
   // assert the are idle.   Also - any kid that doesn't exist is idle.
@@ -219,6 +227,7 @@ RenderingSet::InitializeState()
 	left_busy  = (left_id != -1);
 	right_busy = (right_id != -1);
 	last_busy  = true;
+	last_wave_quiet = false;
 	activeCameraCount = 0;
 }
 
@@ -320,8 +329,7 @@ RenderingSet::CheckLocalState()
       GetTheEventTracker()->Add(new CheckStateActionEvent(CheckStateActionEvent::INIT_SYNC_CHECK));
 #endif
 
-			SynchronousCheckMsg *msg = new SynchronousCheckMsg(getkey());
-			msg->Broadcast(true, true);
+			CheckGlobalState();
     }
     else if (parent != -1)
     {
@@ -360,6 +368,8 @@ RenderingSet::UpdateChildState(bool busy, int child)
                                                 CheckStateActionEvent::RECEIVED_IDLE_RIGHT));
 #endif
 
+	pthread_mutex_lock(&local_lock);
+
   if (child == left_id) left_busy = busy;
   else right_busy = busy;
 
@@ -368,21 +378,22 @@ RenderingSet::UpdateChildState(bool busy, int child)
 #endif
 
   CheckLocalState();
+	pthread_mutex_unlock(&local_lock);
 }
 
 void
-RenderingSet::IncrementInFlightCount()
+RenderingSet::RayListSent()
 {
 	pthread_mutex_lock(&local_lock);
-  local_inflight_count++;
+  n_raylists_sent++;
 	pthread_mutex_unlock(&local_lock);
 }
 	
 void
-RenderingSet::DecrementInFlightCount()
+RenderingSet::RayListReceived()
 {
 	pthread_mutex_lock(&local_lock);
-  local_inflight_count--;
+  n_raylists_received++;
 	pthread_mutex_unlock(&local_lock);
 }
 	
@@ -475,59 +486,123 @@ RenderingSet::DecrementRayListCount()
 void
 RenderingSet::CheckGlobalState()
 {
-	SynchronousCheckMsg * msg = new SynchronousCheckMsg(getkey());
-	msg->Broadcast(true, false);
+	// Called on the root with local_lock held.  Only one wave at a time: the
+	// second of a pair of waves must start after the first has finished everywhere.
+	// A wave that completes without finishing the frame re-checks the local 
+	// state, so dropping this request loses nothing.
+
+	if (wave_in_flight)
+		return;
+
+	wave_in_flight = true;
+
+	TerminationWaveMsg msg(getkey());
+	msg.Broadcast(true, false);
 }
 
+// A termination wave in progress: the local contribution and, once the 
+// non-blocking reduction completes, the global sums
+
+class TerminationWave : public NonBlockingCollective
+{
+public:
+	TerminationWave(RenderingSetP r) : rs(r) {}
+
+	void Complete() { rs->TerminationWaveCompleted(global_counts); }
+
+	RenderingSetP rs;
+	int local_counts[3];
+	int global_counts[3];
+};
+
 bool
-RenderingSet::SynchronousCheckMsg::CollectiveAction(MPI_Comm c, bool isRoot)
+RenderingSet::TerminationWaveMsg::CollectiveAction(MPI_Comm c, bool isRoot)
 {
 	Key rsk = *(Key *)contents->get();
 	RenderingSetP rs = GetByKey(rsk);
 
-	rs->first_async_completion_test_done = true;
+	TerminationWave *wave = new TerminationWave(rs);
 
-  rs->Lock();
+	// Snapshot whether this process is busy - holds a ray list or is still
+	// spawning camera rays - along with the counts of ray lists it has sent
+	// and received.  The snapshot is taken when the wave passes; the 
+	// reduction does not block the message thread.
 
-  int global_counts[4];
-	int local_counts[] = {rs->get_local_raylist_count(), rs->get_number_of_pixels_sent(), rs->get_number_of_pixels_received(), rs->CameraIsActive() ? 1 : 0};
+	pthread_mutex_lock(&rs->local_lock);
+	wave->local_counts[0] = ((rs->get_local_raylist_count() != 0) || rs->CameraIsActive()) ? 1 : 0;
+	wave->local_counts[1] = rs->n_raylists_sent;
+	wave->local_counts[2] = rs->n_raylists_received;
+	pthread_mutex_unlock(&rs->local_lock);
 
-	if (GetTheApplication()->GetTheMessageManager()->UsingMPI())
-		MPI_Allreduce(local_counts, global_counts, 4, MPI_INT, MPI_SUM, c);
+	MessageManager *mm = GetTheApplication()->GetTheMessageManager();
+	if (mm->UsingMPI())
+	{
+		MPI_Iallreduce(wave->local_counts, wave->global_counts, 3, MPI_INT, MPI_SUM, mm->getNBCComm(), wave->GetRequest());
+		mm->AddNonBlockingCollective(wave);
+	}
 	else
-		for (int i = 0; i < 4; i++)
-			global_counts[i] = local_counts[i];
+	{
+		for (int i = 0; i < 3; i++)
+			wave->global_counts[i] = wave->local_counts[i];
 
-	// If no raylists exist anywhere, and the number of received pixels matches the number of sent pixels,
-	// and there are no camera rays currently being generated, this rendering is done.
+		wave->Complete();
+		delete wave;
+	}
 
-  // if (global_counts[0] == 0 && (global_counts[1] == global_counts[2]) && global_counts[3] == 0)
-  if (global_counts[0] == 0 && global_counts[3] == 0)
-	{
-		rs->Finalize();
-  }
-  else
+	return false;
+}
+
+void
+RenderingSet::TerminationWaveCompleted(int *global_counts)
+{
+	Lock();
+	pthread_mutex_lock(&local_lock);
+
+	first_async_completion_test_done = true;
+	wave_in_flight = false;
+
+	if (! done)
 	{
+		// Quiet if nobody is busy and every ray list sent has been received.   
+		// One quiet wave is not enough, since a ray list may be received before
+		// its receiver's snapshot and sent after its sender's.   But if two 
+		// successive waves are quiet and saw the same counts, no ray list was
+		// sent or received in between, so the frame is done.
 
-#ifdef GXY_PRODUCE_STATUS_MESSAGES
-		rs->_dumpState(c, "completion_test");
-#endif
+		bool quiet = (global_counts[0] == 0) && (global_counts[1] == global_counts[2]);
 
-		if (GetTheApplication()->GetRank() == 0)
+		if (quiet && last_wave_quiet && 
+				global_counts[1] == last_wave_sent && global_counts[2] == last_wave_received)
 		{
-			if (global_counts[0] != 0 && global_counts[3] != 0)
-				 std::cerr << "not done due to ray lists AND cameras\n";
-			else if (global_counts[0] != 0)
-				 std::cerr << "not done due to ray lists\n";
-			else std::cerr << "not done due to cameras\n";
+			Finalize();
 		}
+		else
+		{
+			last_wave_quiet    = quiet;
+			last_wave_sent     = global_counts[1];
+			last_wave_received = global_counts[2];
+
+			if (GetTheApplication()->GetRank() == 0)
+			{
+				if (quiet)
+					CheckGlobalState();
+				else
+				{
+#ifdef GXY_PRODUCE_STATUS_MESSAGES
+					std::cerr << "not done: " << global_counts[0] << " busy, " 
+										<< (global_counts[1] - global_counts[2]) << " ray lists in flight\n";
+#endif
+					// Re-arm; if the tree already reports idle, go again now
 
-    rs->last_busy = true;
+					last_busy = true;
+					CheckLocalState();
+				}
+			}
+		}
 	}
 
-  rs->Unlock();
-
-  return false;
+	pthread_mutex_unlock(&local_lock);
+	Unlock();
 }
 
 void
@@ -746,9 +821,24 @@ RenderingSet::NeedInitialRays()
 		return -1;
 }
 
+void
+RenderingSet::local_cancel(int fnum)
+{
+	if (fnum > oldest_active_frame)
+		oldest_active_frame = fnum;
+
+	// Bump the current frame too, so a progressive frame stops issuing passes
+
+	if (fnum > current_frame)
+		current_frame = fnum;
+}
+
 bool 
 RenderingSet::IsActive(int fnum)
 {
+	if (fnum < oldest_active_frame)
+		return false;
+
 	if (fnum > current_frame)
 		current_frame = fnum;
 #if 0
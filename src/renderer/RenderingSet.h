@@ -54,7 +54,8 @@ class RenderingSet : public KeyedObject, public std::enable_shared_from_this<Ren
 {
 	friend class Rendering;
 	friend class PropagateStateMsg;
-	friend class SynchronousCheckMsg;
+	friend class TerminationWaveMsg;
+	friend class TerminationWave;
 	friend class SaveImagesMsg;
 	friend class ResetMsg;
 	
@@ -103,8 +104,8 @@ public:
 	//! return whether there is at least one active camera in this RenderingSet
 	bool CameraIsActive() { return activeCameraCount > 0; }
 
-	void IncrementInFlightCount(); //!< increase the inflight count by one
-	void DecrementInFlightCount(); //!< decrease the inflight count by one
+	void RayListSent(); //!< count a RayList sent to another process
+	void RayListReceived(); //!< count a RayList received from another process
 
 	//! return whether rendering for this RenderingSet is complete
 	bool IsDone() { return done; }
@@ -121,10 +122,7 @@ public:
 	//! reduce the count of active RayLists for this RenderingSet by one
 	/*! Decrement the number of ray lists for this set that are alive
 	 * in this process.   If it had been 1, then state has changed.
-	 * This is called both when ProcessRays finishes a RayList and 
-	 * from the acknowlegement of the receipt of a  ray list
-	 * from the action of the RaycastRenderer's AckRays message,
-	 * so it needs to be accessible.
+	 * This is called when ProcessRays finishes a RayList.
 	 */
 	void DecrementRayListCount();
 
@@ -133,9 +131,8 @@ public:
 	 * in this process.   If it had been 0, then state has changed.
 	 * If silent, then the modification of the state does not cause
 	 * a notification upstream; this is used during the initial
-	 * spawning of the rays.  This is called both when a ray list
-	 * is added to the local RayQ and when one is sent to a remote
-	 * process' RayQ so it needs to be accessible.
+	 * spawning of the rays.  This is called when a ray list
+	 * is added to the local RayQ.
 	 */
 	void IncrementRayListCount(bool silent = false);
 	//! set initial state to begin rendering this RenderingSet
@@ -213,15 +210,25 @@ protected:
 	void UpdateChildState(bool b, int c);
 
 	// Called by the root when its 'local state' is set to idle, indicating
-	// that the whole ball of wax might be done.   Calls the synchronous test
+	// that the whole ball of wax might be done.   Starts a termination wave:
+	// a non-blocking reduction of the busy state and the counts of ray lists
+	// sent and received.   The rendering is done when two successive waves
+	// find everyone idle and the same, matching, sent and received counts.
 
 	void CheckGlobalState();
+
+	// Called on the message thread, in order, as each termination wave completes
+
+	void TerminationWaveCompleted(int *global_counts);
 	
 	int get_local_raylist_count() { return local_raylist_count; }
 	void get_local_raylist_count(int &k) { k = local_raylist_count; }
 
-	int get_local_inflight_count() { return local_inflight_count; }
-	void get_local_inflight_count(int &k) { k = local_inflight_count; }
+	// ray lists sent from here less those received here; summed over all processes,
+	// the number in flight
+
+	int get_local_inflight_count() { return n_raylists_sent - n_raylists_received; }
+	void get_local_inflight_count(int &k) { k = n_raylists_sent - n_raylists_received; }
 
 	int get_number_of_pixels_sent() { return n_pix_sent; }
 	void get_number_of_pixels_sent(int &k) { k = n_pix_sent; }
@@ -259,6 +266,15 @@ public:
 	 */
 	bool IsActive(int fnum);
 
+	//! locally cancel the frames of this RenderingSet before fnum, in response to a Renderer's CancelMsg
+	/*! From then on IsActive is false for those frames, so their RayLists
+	 * and pixels are dropped as they arrive.
+	 */
+	void local_cancel(int fnum);
+
+	//! return the oldest frame that has not been cancelled
+	int GetOldestActiveFrame() { return oldest_active_frame; }
+
   //! Set the datasets this rendering set will refer to
   void SetTheDatasets(DatasetsP d) { datasets = d; }
   
@@ -272,6 +288,7 @@ private:
 
 	int current_frame;
 	int next_frame;
+	int oldest_active_frame;
   int spawnedRayCount;
 
   class SaveImagesMsg : public Work
@@ -292,8 +309,18 @@ private:
   bool currently_busy, last_busy, left_busy, right_busy;
   int left_id, right_id, parent;
 
-	int local_inflight_count;
 	int local_raylist_count;
+	int n_raylists_sent;
+	int n_raylists_received;
+
+	// Did the last termination wave find everyone idle with no ray lists
+	// in flight, and if so, what counts did it see?
+
+	bool last_wave_quiet;
+	int  last_wave_sent, last_wave_received;
+
+	bool wave_in_flight;		// on the root, has a wave been started but not completed?
+
 	int n_pix_sent;
 
 	int n_pix_received;	
@@ -321,15 +348,15 @@ private:
     bool Action(int sender);
   };
 
-  class SynchronousCheckMsg : public Work
+  class TerminationWaveMsg : public Work
   {
   public:
-		SynchronousCheckMsg(Key k) : SynchronousCheckMsg(sizeof(Key))
+		TerminationWaveMsg(Key k) : TerminationWaveMsg(sizeof(Key))
 		{
 			*(Key *)contents->get() = k;
 		}
 
-    WORK_CLASS(SynchronousCheckMsg, true);
+    WORK_CLASS(TerminationWaveMsg, true);
 
   public:
     bool CollectiveAction(MPI_Comm c, bool);
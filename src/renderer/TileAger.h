@@ -0,0 +1,134 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#pragma once
+
+/*! \file TileAger.h 
+ * \brief tile-by-tile aging of the stale pixels of an asynchronously updated image
+ * \ingroup render
+ */
+
+#include <climits>
+#include <vector>
+
+namespace gxy
+{
+
+#define GXY_AGER_TILE_SIZE 32
+
+//! tile-by-tile aging of the stale pixels of an asynchronously updated image
+/*! \ingroup render
+ * Asynchronously updated images (AsyncRendering, ClientWindow) fade out pixels 
+ * left over from prior frames.  The TileAger keeps, for each tile of the image, a 
+ * lower bound on the oldest frame of any pixel drawn in the tile.   Tiles whose 
+ * bound is not older than the current frame hold no stale pixels and are skipped, 
+ * so aging costs in proportion to the stale area of the image.   The bound is 
+ * lowered as pixels are drawn and made exact as tiles are aged.  Tiles are aged a
+ * row at a time so the owner can release its lock between rows.
+ */
+class TileAger
+{
+public:
+  //! size the tile map for a w x h image, forgetting all drawn pixels
+  void Resize(int w, int h)
+  {
+    width = w; height = h;
+    ntx = (w + GXY_AGER_TILE_SIZE - 1) / GXY_AGER_TILE_SIZE;
+    nty = (h + GXY_AGER_TILE_SIZE - 1) / GXY_AGER_TILE_SIZE;
+    oldest.assign(ntx*nty, INT_MAX);
+  }
+
+  //! note that pixel (x, y) was drawn in frame f
+  void Touch(int x, int y, int f)
+  {
+    int t = (y / GXY_AGER_TILE_SIZE)*ntx + (x / GXY_AGER_TILE_SIZE);
+    if (f < oldest[t]) oldest[t] = f;
+  }
+
+  //! note that pixels of tile (tx, ty) were drawn in frame f
+  void TouchTile(int tx, int ty, int f)
+  {
+    int t = ty*ntx + tx;
+    if (f < oldest[t]) oldest[t] = f;
+  }
+
+  //! number of rows of tiles
+  int GetNumberOfTileRows() { return nty; }
+
+  //! age the stale pixels in row ty of tiles
+  /*! Pixels drawn in a frame before `current` are faded, or if `reset` is set, 
+   * cleared to black and marked as belonging to the current frame.
+   * \param pixels the image, as (r,g,b,a) floats
+   * \param frameids the frame in which each pixel was last drawn, 0 if never
+   * \param samples if given, per-pixel sample counts, zeroed for cleared pixels
+   */
+  void AgeTileRow(int ty, float *pixels, int *frameids, int current, bool reset, int *samples = NULL)
+  {
+    for (int tx = 0; tx < ntx; tx++)
+    {
+      int t = ty*ntx + tx;
+      if (oldest[t] >= current)
+        continue;
+
+      int x0 = tx*GXY_AGER_TILE_SIZE, y0 = ty*GXY_AGER_TILE_SIZE;
+      int tw = (width  - x0) < GXY_AGER_TILE_SIZE ? (width  - x0) : GXY_AGER_TILE_SIZE;
+      int th = (height - y0) < GXY_AGER_TILE_SIZE ? (height - y0) : GXY_AGER_TILE_SIZE;
+
+      int o = INT_MAX;
+      for (int y = y0; y < y0 + th; y++)
+      {
+        int   *fid = frameids + y*width + x0;
+        float *pix = pixels + ((y*width + x0) << 2);
+        int   *smp = samples ? samples + y*width + x0 : NULL;
+
+        if (reset)
+          for (int x = 0; x < tw; x++, pix += 4)
+          {
+            if (fid[x] > 0 && fid[x] < current)
+            {
+              fid[x] = current;
+              if (smp) smp[x] = 0;
+              pix[0] = 0.0, pix[1] = 0.0, pix[2] = 0.0, pix[3] = 1.0;
+            }
+          }
+        else
+          for (int x = 0; x < tw; x++, pix += 4)
+          {
+            // Branch-free so the loop vectorizes
+
+            float s = (fid[x] > 0 && fid[x] < current) ? 0.9 : 1.0;
+            pix[0] *= s, pix[1] *= s, pix[2] *= s;
+          }
+
+        for (int x = 0; x < tw; x++)
+          if (fid[x] > 0 && fid[x] < o) o = fid[x];
+      }
+
+      oldest[t] = o;
+    }
+  }
+
+private:
+  int width = 0, height = 0;
+  int ntx = 0, nty = 0;
+  std::vector<int> oldest;
+};
+
+} // namespace gxy
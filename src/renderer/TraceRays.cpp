@@ -119,19 +119,20 @@ TraceRays::Trace(Lighting* lights, VisualizationP visualization, RayList *raysIn
   if (nOutputRays)
   {
     raysOut = new RayList(raysIn->GetTheRenderer(), raysIn->GetTheRenderingSet(), raysIn->GetTheRendering(), nOutputRays, raysIn->GetFrame(), RayList::SECONDARY);
+    raysOut->SetPass(raysIn->GetPass());
   }
   
 #ifdef GXY_REVERSE_LIGHTING
 	ispc::TraceRays_ambientLighting(GetIspc(), lights->GetIspc(), raysIn->GetRayCount(),  raysIn->GetIspc());
 	if (ao_ray_knt)
-		ispc::TraceRays_generateAORays(GetIspc(), lights->GetIspc(), raysIn->GetRayCount(), raysIn->GetIspc(), ao_offsets, raysOut->GetIspc(), epsilon);
+		ispc::TraceRays_generateAORays(GetIspc(), lights->GetIspc(), raysIn->GetRayCount(), raysIn->GetIspc(), ao_offsets, raysOut->GetIspc(), epsilon, raysIn->GetPass());
 	
 	ispc::TraceRays_diffuseLighting(GetIspc(), lights->GetIspc(), raysIn->GetRayCount(), raysIn->GetIspc());
 	if (shadow_ray_knt)
 		ispc::TraceRays_generateShadowRays(GetIspc(), lights->GetIspc(), raysIn->GetRayCount(), raysIn->GetIspc(), shadow_offsets, raysOut->GetIspc(), epsilon);
 #else
 	if (ao_ray_knt)
-		ispc::TraceRays_generateAORays(GetIspc(), lights->GetIspc(), raysIn->GetRayCount(), raysIn->GetIspc(), ao_offsets, raysOut->GetIspc(), epsilon);
+		ispc::TraceRays_generateAORays(GetIspc(), lights->GetIspc(), raysIn->GetRayCount(), raysIn->GetIspc(), ao_offsets, raysOut->GetIspc(), epsilon, raysIn->GetPass());
 	else
 		ispc::TraceRays_ambientLighting(GetIspc(), lights->GetIspc(), raysIn->GetRayCount(),  raysIn->GetIspc());
 	
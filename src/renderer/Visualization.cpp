@@ -136,6 +136,7 @@ bool
 Visualization::local_commit(MPI_Comm c)
 {
   bool first = true;
+  router = NULL;
 
   for (auto v : vis)
     v->local_commit(c);
@@ -159,6 +160,8 @@ Visualization::local_commit(MPI_Comm c)
 
       for (int i = 0; i < 6; i++)
         neighbors[i] = kdop->get_neighbor(i);
+
+      router = kdop->routes_by_owner() ? kdop : NULL;
     }
     else if (1 == 0)
     {
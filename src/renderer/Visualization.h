@@ -107,6 +107,14 @@ public:
    */
   bool has_neighbor(unsigned int face) { return neighbors[face] >= 0; }
 
+  //! are rays leaving the local box routed by the owner of the point they exit to?
+  /*! This is the case when the data is not partitioned on a regular grid of processes
+   *  \sa KeyedDataObject::routes_by_owner
+   */
+  bool routes_by_owner() { return router != NULL; }
+  //! Which process owns an arbitrary point in the routing data? -1 for outside
+  int PointOwner(vec3f& p) { return router ? router->PointOwner(p) : -1; }
+
   //! get a pointer to the Lighting object for this Visualization
 	Lighting *get_the_lights() { return &lighting; }
 
@@ -136,6 +144,7 @@ protected:
   Box global_box;
   Box local_box;
   int neighbors[6];
+  KeyedDataObjectP router;      // the data that routes rays by ownership, if any
 };
 
 } // namespace gxy
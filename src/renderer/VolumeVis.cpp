@@ -51,6 +51,7 @@ VolumeVis::initialize()
   // std::cerr << "VolVis init: " << std::hex << this << "\n";
   super::initialize();
   volume_rendering = false;
+  step_scale = 1.0;
 }
 
 void
@@ -73,7 +74,7 @@ VolumeVis::serialSize()
   return super::serialSize() +
          sizeof(int) + slices.size()*sizeof(vec4f) +
          sizeof(int) + isovalues.size()*sizeof(float) + 
-         sizeof(bool);
+         sizeof(bool) + sizeof(float);
 }
 
 unsigned char *
@@ -94,6 +95,9 @@ VolumeVis::serialize(unsigned char *ptr)
   *(bool *)ptr = volume_rendering;
   ptr += sizeof(bool);
 
+  *(float *)ptr = step_scale;
+  ptr += sizeof(float);
+
   return ptr;
 }
 
@@ -112,6 +116,8 @@ VolumeVis::deserialize(unsigned char *ptr)
   ptr += ni*sizeof(float);
   SetVolumeRendering(*(bool *)ptr);
   ptr += sizeof(bool);
+  SetStepScale(*(float *)ptr);
+  ptr += sizeof(float);
   
   return ptr;
 }
@@ -159,6 +165,11 @@ VolumeVis::LoadFromJSON(Value& v)
   else
     SetVolumeRendering(false);
 
+  if (v.HasMember("step scale"))
+    SetStepScale(v["step scale"].GetDouble());
+  else
+    SetStepScale(1.0);
+
   return true;
 }
 
@@ -180,6 +191,7 @@ VolumeVis::local_commit(MPI_Comm c)
 	ispc::VolumeVis_SetSlices(GetIspc(), slices.size(), ((float *)slices.data()));
 	ispc::VolumeVis_SetIsovalues(GetIspc(), isovalues.size(), ((float *)isovalues.data()));
 	ispc::VolumeVis_SetVolumeRenderFlag(GetIspc(), volume_rendering);
+	ispc::VolumeVis_SetStepScale(GetIspc(), step_scale);
 
 	return false;
 }
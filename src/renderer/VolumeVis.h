@@ -98,6 +98,12 @@ public:
   //! is direct volume rendering used to render this VolumeVis?
   bool GetVolumeRendering() { return volume_rendering; }
 
+  //! set the step scale of this VolumeVis: the step between samples is the volume's spacing times it (default 1)
+  /*! Larger is coarser.   Kept per vis, as other vis' of the same Volume may sample it with other steps */
+  void SetStepScale(float s) { step_scale = s; }
+  //! get the step scale of this VolumeVis
+  float GetStepScale() { return step_scale; }
+
   virtual bool local_commit(MPI_Comm);
 
 protected:
@@ -113,6 +119,7 @@ protected:
   virtual unsigned char* deserialize(unsigned char *ptr);
 
   bool volume_rendering;
+  float step_scale;
 
   std::vector<vec4f> slices;
   std::vector<float> isovalues;
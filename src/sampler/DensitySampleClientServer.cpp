@@ -30,8 +30,7 @@
 
 #include "Datasets.h"
 #include "DensitySampleClientServer.h"
-
-#include <time.h>
+#include "DensitySampling.h"
 
 using namespace gxy;
 using namespace std;
@@ -41,58 +40,16 @@ namespace gxy
 
 DensitySampleClientServer::DensitySampleClientServer(SocketHandler *sh) : MultiServerHandler(sh)
 {
-};
-
-#define RNDM ((float)rand() / RAND_MAX) 
-
-static float *
-CellValues(VolumeP v, DensitySampleClientServer::Args *a)
-{
-  float *cellValues = new float((a->ni-1) * (a->nj-1) * (a->nk-1));
-
-  float *d = cellValues;
-  if (v->get_type() == Volume::FLOAT)
-  {
-    float *s = (float *)v->get_samples();
-    for (int i = 0; i < a->nj-1; i++)
-      for (int j = 0; i < a->nj-1; j++)
-        for (int k = 0; k < a->nk-1; k++)
-        {
-          int corner = (a->goi+i)*a->istep + (a->goj+k)*a->jstep + (a->gok+k)*a->kstep;
-          *d++ = s[corner + 0*a->istep + 0*a->jstep + 0*a->kstep] +
-                 s[corner + 1*a->istep + 0*a->jstep + 0*a->kstep] +
-                 s[corner + 0*a->istep + 1*a->jstep + 0*a->kstep] +
-                 s[corner + 1*a->istep + 1*a->jstep + 0*a->kstep] +
-                 s[corner + 0*a->istep + 0*a->jstep + 1*a->kstep] +
-                 s[corner + 1*a->istep + 0*a->jstep + 1*a->kstep] +
-                 s[corner + 0*a->istep + 1*a->jstep + 1*a->kstep] +
-                 s[corner + 1*a->istep + 1*a->jstep + 1*a->kstep];
-        }
-  }
-  else
-  {
-    double *s = (double *)v->get_samples();
-    for (int i = 0; i < a->nj-1; i++)
-      for (int j = 0; i < a->nj-1; j++)
-        for (int k = 0; k < a->nk-1; k++)
-        {
-          int corner = (a->goi+i)*a->istep + (a->goj+k)*a->jstep + (a->gok+k)*a->kstep;
-          *d++ = s[corner + 0*a->istep + 0*a->jstep + 0*a->kstep] +
-                 s[corner + 1*a->istep + 0*a->jstep + 0*a->kstep] +
-                 s[corner + 0*a->istep + 1*a->jstep + 0*a->kstep] +
-                 s[corner + 1*a->istep + 1*a->jstep + 0*a->kstep] +
-                 s[corner + 0*a->istep + 0*a->jstep + 1*a->kstep] +
-                 s[corner + 1*a->istep + 0*a->jstep + 1*a->kstep] +
-                 s[corner + 0*a->istep + 1*a->jstep + 1*a->kstep] +
-                 s[corner + 1*a->istep + 1*a->jstep + 1*a->kstep];
-        }
-  }
+  args.nSamples = 1000;
+  args.power    = 1.0;
+  args.seed     = 0;
 
-  return cellValues;
-}
+  volume = NULL;
+  particles = NULL;
+};
 
 static void
-DensitySample(MPI_Comm c, DensitySampleClientServer::Args *a)
+Sample(MPI_Comm c, DensitySampleClientServer::Args *a)
 {
   VolumeP v = Volume::Cast(KeyedDataObject::GetByKey(a->vk));
   ParticlesP p = Particles::Cast(KeyedDataObject::GetByKey(a->pk));
@@ -101,57 +58,7 @@ DensitySample(MPI_Comm c, DensitySampleClientServer::Args *a)
   p->CopyPartitioning(v);
   p->SetDefaultColor(1.0, 1.0, 1.0, 1.0);
 
-  v->get_local_counts(a->ni, a->nj, a->nk);
-  v->get_ghosted_local_counts(a->gi, a->gj, a->gk);
-  v->get_ghosted_local_offsets(a->goi, a->goj, a->gok);
-  v->get_local_origin(a->ox, a->oy, a->oz);
-  v->get_deltas(a->dx, a->dy, a->dz);
-
-  a->istep = 1;
-  a->jstep = a->gi;
-  a->kstep = a->gi * a->gj;
-
-  float *cellValues = CellValues(v, a);
-
-  int ncells = a->ni * a->nj * a->nk;
-
-  float local_total = 0.0, global_total;
-  for (int i = 0; i < ncells; i++)
-    local_total += cellValues[i];
-
-  MPI_Allreduce(&local_total, &global_total, 1, MPI_FLOAT, MPI_SUM, c);
-
-  float f_this_part = (local_total / global_total) * a->nSamples;
-  int n_this_part   = ((int)f_this_part) + ((RNDM < (f_this_part - (int)f_this_part)) ? 1 : 0);
-
-  if (local_total > 0)
-  {
-    float *tcell = cellValues;
-
-    for (int i = 0; i < a->nj-1; i++)
-    {
-      float ox = a->ox + i*a->dx;
-
-      for (int j = 0; i < a->nj-1; j++)
-      {
-        float oy = a->oy + i*a->dx;
-
-        for (int k = 0; k < a->nk-1; k++)
-        {
-          float oz = a->oz + i*a->dx;
-
-          float f_this_cell = (*tcell++ / local_total) * f_this_part;
-          int n_this_part   = (int)f_this_cell + ((RNDM < (f_this_cell - (int)f_this_cell)) ? 1 : 0);
-
-          for (int l = 0; l < n_this_part; l++)
-          {
-            Particle s(ox + RNDM, oy + RNDM, oz + RNDM, 0);
-            p->push_back(s);
-          }
-        }
-      }
-    }
-  }
+  DensitySample(c, v, p, a->nSamples, a->power, a->seed);
 
   std::cerr << "created " << p->GetNumberOfVertices() << " samples\n";
 }
@@ -170,7 +77,7 @@ public:
 
   bool CollectiveAction(MPI_Comm c, bool isRoot)
   {
-    DensitySample(c, (DensitySampleClientServer::Args *)get());
+    Sample(c, (DensitySampleClientServer::Args *)get());
     return false;
   }
 };
@@ -180,7 +87,6 @@ WORK_CLASS_TYPE(DensitySampleMsg)
 extern "C" void
 init()
 {
-  srand(GetTheApplication()->GetRank());
   DensitySampleMsg::Register();
 }
 
@@ -193,8 +99,6 @@ new_handler(SocketHandler *sh)
 bool
 DensitySampleClientServer::handle(std::string line, std::string& reply)
 {
-  int nSamples = 1000;
-
   DatasetsP theDatasets = Datasets::Cast(MultiServer::Get()->GetGlobal("global datasets"));
   if (! theDatasets)
   {
@@ -245,7 +149,37 @@ DensitySampleClientServer::handle(std::string line, std::string& reply)
   }
   else if (cmd == "n")
   {
-    ss >> nSamples;
+    ss >> args.nSamples;
+    if (ss.fail())
+    {
+      reply = "error DensitySampler n command requires an integer argument";
+      return true;
+    }
+
+    reply = "ok";
+    return true;
+  }
+  else if (cmd == "power")
+  {
+    ss >> args.power;
+    if (ss.fail())
+    {
+      reply = "error DensitySampler power command requires a float argument";
+      return true;
+    }
+
+    reply = "ok";
+    return true;
+  }
+  else if (cmd == "seed")
+  {
+    ss >> args.seed;
+    if (ss.fail())
+    {
+      reply = "error DensitySampler seed command requires an integer argument";
+      return true;
+    }
+
     reply = "ok";
     return true;
   }
@@ -53,12 +53,8 @@ public:
     Key   vk;                   // Volume key
     Key   pk;                   // Particles key
     int   nSamples;             // total number of samples
-    int   ni,  nj,  nk;         // non-ghosted counts along each local axis
-    int   gi,  gj,  gk;         // ghosted counts along each local axis
-    int   goi, goj, gok;        // offsets of non-ghosted in ghosted
-    int   istep, jstep, kstep;  // strides in ghosted space
-    float ox, oy, oz;           // local grid origin
-    float dx, dy, dz;           // grid step size
+    float power;                // exponent applied to the normalized cell values
+    unsigned int seed;          // seed for the random streams
   } args;
 };
 
@@ -0,0 +1,413 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#pragma once
+
+/*! \file DensitySampling.h 
+ * \brief draw samples from a Volume with probability proportional to its (powered, normalized) cell values
+ * \ingroup sampler
+ */
+
+#include <vector>
+#include <future>
+#include <cfloat>
+#include <math.h>
+#include <mpi.h>
+
+#include "Application.h"
+#include "Threading.h"
+#include "Philox.h"
+#include "Volume.h"
+#include "Particles.h"
+
+namespace gxy
+{
+
+//! samples are drawn in chunks of this many, each chunk with its own random stream
+#define DENSITY_SAMPLE_CHUNK 65536
+
+//! the local cells are split into at most this many slabs, independent of the number of threads
+#define DENSITY_SLAB_COUNT 64
+
+//! the local cell grid of a Volume partition and the per-cell tables built over it
+/*! \ingroup sampler */
+struct DensityGrid
+{
+  int   ci, cj, ck;              //!< local (non-ghost) cell counts along each axis
+  int   oi, oj, ok;              //!< offset of the first local point in the ghosted samples
+  size_t istep, jstep, kstep;    //!< strides of the ghosted samples
+  float ox, oy, oz;              //!< local grid origin
+  float dx, dy, dz;              //!< cell size
+  float *weight;                 //!< per-cell weight, replaced by its alias probability
+  int   *alias;                  //!< per-cell alias
+};
+
+//! a run of whole k-layers of cells, handled by a single task
+/*! \ingroup sampler */
+struct DensitySlab
+{
+  size_t first;                  //!< index of the first cell in the slab
+  size_t count;                  //!< number of cells in the slab
+  float  min, max;               //!< range of the raw cell values in the slab
+  double total;                  //!< sum of the normalized cell weights in the slab
+};
+
+//! turn `n` non-negative weights summing to `total` into a Walker alias table, in place (Vose's method)
+/*! On return `p[i]` is the probability of keeping cell `i` and `alias[i]` the
+ * cell chosen otherwise.   Tables are per slab, so `n` is at most the cells
+ * of a slab.  Cells of no weight are never chosen; `total` must 
+ * be positive.
+ * \ingroup sampler
+ */
+inline void
+DensityAliasTable(float *p, int *alias, int n, double total)
+{
+  // small entries are stacked from the front, large ones from the back
+
+  std::vector<int> stack(n);
+  std::vector<bool> zero(n);
+  int nsmall = 0, nlarge = n, nonzero = -1;
+
+  for (int i = 0; i < n; i++)
+  {
+    zero[i] = (p[i] <= 0);
+    if (! zero[i]) nonzero = i;
+    p[i] = (p[i] * n) / total;
+    alias[i] = i;
+    if (p[i] < 1.0) stack[nsmall++] = i;
+    else stack[--nlarge] = i;
+  }
+
+  while (nsmall > 0 && nlarge < n)
+  {
+    int s = stack[--nsmall];
+    int l = stack[nlarge];
+
+    alias[s] = l;
+    p[l] = (p[l] + p[s]) - 1.0;
+
+    if (p[l] < 1.0)
+    {
+      nlarge++;
+      stack[nsmall++] = l;
+    }
+  }
+
+  // Whatever is left is 1 up to rounding, except entries of no weight, 
+  // which must never be drawn
+
+  while (nsmall > 0)
+  {
+    int s = stack[--nsmall];
+    if (zero[s]) p[s] = 0.0, alias[s] = nonzero;
+    else p[s] = 1.0;
+  }
+
+  while (nlarge < n) p[stack[nlarge++]] = 1.0;
+}
+
+//! draw an index from an alias table in O(1)
+inline int
+DensityAliasDraw(float *p, int *alias, int n, Philox& rng)
+{
+  int i = rng.next() % n;
+  return (rng.uniform() < p[i]) ? i : alias[i];
+}
+
+//! compute the raw value (sum of corner samples) of the cells of a slab
+/*! Only the first component of multi-component volumes is used.
+ * \ingroup sampler
+ */
+template<typename T>
+class DensityCellTask : public ThreadPoolTask
+{
+public:
+  DensityCellTask(T *s, DensityGrid& g, DensitySlab& slab) : ThreadPoolTask(3), s(s), g(g), slab(slab) {}
+
+  int work()
+  {
+    size_t layer = (size_t)g.ci * g.cj;
+    int k0 = slab.first / layer;
+    int k1 = k0 + slab.count / layer;
+
+    float *d = g.weight + slab.first;
+    float mn = FLT_MAX, mx = -FLT_MAX;
+
+    for (int k = k0; k < k1; k++)
+      for (int j = 0; j < g.cj; j++)
+      {
+        T *c = s + (g.ok+k)*g.kstep + (g.oj+j)*g.jstep + g.oi*g.istep;
+        for (int i = 0; i < g.ci; i++, c += g.istep)
+        {
+          float v = float(c[0]) +
+                    float(c[g.istep]) +
+                    float(c[g.jstep]) +
+                    float(c[g.istep + g.jstep]) +
+                    float(c[g.kstep]) +
+                    float(c[g.istep + g.kstep]) +
+                    float(c[g.jstep + g.kstep]) +
+                    float(c[g.istep + g.jstep + g.kstep]);
+          if (v < mn) mn = v;
+          if (v > mx) mx = v;
+          *d++ = v;
+        }
+      }
+
+    slab.min = mn;
+    slab.max = mx;
+    return slab.count;
+  }
+
+private:
+  T *s;
+  DensityGrid& g;
+  DensitySlab& slab;
+};
+
+//! normalize the cell values of a slab to weights and build the slab's alias table
+/*! \ingroup sampler */
+class DensityTableTask : public ThreadPoolTask
+{
+public:
+  DensityTableTask(DensityGrid& g, DensitySlab& slab, float min, float max, float power) :
+    ThreadPoolTask(3), g(g), slab(slab), min(min), max(max), power(power) {}
+
+  int work()
+  {
+    float *w = g.weight + slab.first;
+
+    double t = 0;
+    if (min != max)
+    {
+      for (size_t i = 0; i < slab.count; i++)
+      {
+        w[i] = pow((w[i] - min) / (max - min), power);
+        t += w[i];
+      }
+    }
+    else
+    {
+      for (size_t i = 0; i < slab.count; i++)
+        w[i] = 1.0;
+      t = slab.count;
+    }
+
+    slab.total = t;
+
+    // A slab of zero weight is never drawn from, so needs no table
+
+    if (t > 0)
+      DensityAliasTable(w, g.alias + slab.first, slab.count, t);
+
+    return slab.count;
+  }
+
+private:
+  DensityGrid& g;
+  DensitySlab& slab;
+  float min, max, power;
+};
+
+//! draw a chunk of samples: a slab from the slab table, a cell from the slab's table, then a point in the cell
+/*! \ingroup sampler */
+class DensityDrawTask : public ThreadPoolTask
+{
+public:
+  DensityDrawTask(DensityGrid& g, std::vector<DensitySlab>& slabs, float *p, int *alias, int n,
+                  uint32_t seed, int rank, int chunk, std::vector<Particle>& r) :
+    ThreadPoolTask(3), g(g), slabs(slabs), p(p), alias(alias), n(n), rng(seed, rank, chunk), result(r) {}
+
+  int work()
+  {
+    result.reserve(n);
+
+    for (int l = 0; l < n; l++)
+    {
+      DensitySlab& s = slabs[DensityAliasDraw(p, alias, slabs.size(), rng)];
+      size_t c = s.first + DensityAliasDraw(g.weight + s.first, g.alias + s.first, s.count, rng);
+
+      int i = c % g.ci;
+      int j = (c / g.ci) % g.cj;
+      int k = c / ((size_t)g.ci * g.cj);
+
+      float x = g.ox + (i + rng.uniform())*g.dx;
+      float y = g.oy + (j + rng.uniform())*g.dy;
+      float z = g.oz + (k + rng.uniform())*g.dz;
+
+      Particle sample(x, y, z, 0);
+      result.push_back(sample);
+    }
+
+    return n;
+  }
+
+private:
+  DensityGrid& g;
+  std::vector<DensitySlab>& slabs;
+  float *p;
+  int *alias;
+  int n;
+  Philox rng;
+  std::vector<Particle>& result;
+};
+
+//! collectively draw about `nSamples` points from `v` into `p`, distributed as the cell values raised to `power`
+/*! Cell values are the sums of the cell's corner samples, normalized to [0,1]
+ * by the global range before raising to `power`.  Each process gets its share
+ * of the samples in proportion to its total weight.   Cell values and the
+ * per-slab alias tables are built concurrently on the thread pool, and each
+ * sample is then drawn in constant time; the draws are divided into fixed-size
+ * chunks with Philox streams keyed on (seed, rank, chunk), so the result
+ * depends only on the seed and the partitioning.   Returns the number of 
+ * samples created locally.
+ * \ingroup sampler
+ */
+inline int
+DensitySample(MPI_Comm c, VolumeP v, ParticlesP p, int nSamples, float power, uint32_t seed)
+{
+  ThreadPool *threadpool = GetTheApplication()->GetTheThreadPool();
+  int rank = GetTheApplication()->GetRank();
+
+  DensityGrid g;
+
+  int ni, nj, nk, gi, gj, gk, li, lj, lk, goi, goj, gok;
+  v->get_local_counts(ni, nj, nk);
+  v->get_ghosted_local_counts(gi, gj, gk);
+  v->get_local_offsets(li, lj, lk);
+  v->get_ghosted_local_offsets(goi, goj, gok);
+  v->get_local_origin(g.ox, g.oy, g.oz);
+  v->get_deltas(g.dx, g.dy, g.dz);
+
+  // Cells span the local (non-ghost) points; the cells between partitions
+  // belong to the partition on their low side, which holds both their faces
+
+  g.ci = ni - 1; g.cj = nj - 1; g.ck = nk - 1;
+  g.oi = li - goi; g.oj = lj - goj; g.ok = lk - gok;
+
+  int nc = v->get_number_of_components();
+  g.istep = nc;
+  g.jstep = g.istep * gi;
+  g.kstep = g.jstep * gj;
+
+  size_t ncells = (g.ci > 0 && g.cj > 0 && g.ck > 0) ? (size_t)g.ci * g.cj * g.ck : 0;
+
+  std::vector<float> weight(ncells);
+  std::vector<int> alias(ncells);
+  g.weight = weight.data();
+  g.alias  = alias.data();
+
+  // Enough slabs of whole k-layers to balance the load across threads.  The
+  // count is fixed, so the draws don't depend on the size of the thread pool
+
+  int nslabs = DENSITY_SLAB_COUNT;
+  if (nslabs > g.ck) nslabs = g.ck;
+  if (ncells == 0) nslabs = 0;
+
+  std::vector<DensitySlab> slabs(nslabs);
+  for (int s = 0; s < nslabs; s++)
+  {
+    int k0 = (s * g.ck) / nslabs, k1 = ((s+1) * g.ck) / nslabs;
+    slabs[s].first = (size_t)k0 * g.ci * g.cj;
+    slabs[s].count = (size_t)(k1 - k0) * g.ci * g.cj;
+    slabs[s].min = FLT_MAX;
+    slabs[s].max = -FLT_MAX;
+    slabs[s].total = 0;
+  }
+
+  std::vector<std::future<int>> rvec;
+
+  for (auto& slab : slabs)
+    if (v->isFloat())
+      rvec.emplace_back(threadpool->AddTask(new DensityCellTask<float>((float *)v->get_samples(), g, slab)));
+    else
+      rvec.emplace_back(threadpool->AddTask(new DensityCellTask<unsigned char>(v->get_samples(), g, slab)));
+
+  for (auto& r : rvec)
+    r.get();
+  rvec.clear();
+
+  float local_min = FLT_MAX, local_max = -FLT_MAX;
+  for (auto& slab : slabs)
+  {
+    if (slab.min < local_min) local_min = slab.min;
+    if (slab.max > local_max) local_max = slab.max;
+  }
+
+  float global_min, global_max;
+  MPI_Allreduce(&local_min, &global_min, 1, MPI_FLOAT, MPI_MIN, c);
+  MPI_Allreduce(&local_max, &global_max, 1, MPI_FLOAT, MPI_MAX, c);
+
+  for (auto& slab : slabs)
+    rvec.emplace_back(threadpool->AddTask(new DensityTableTask(g, slab, global_min, global_max, power)));
+
+  for (auto& r : rvec)
+    r.get();
+  rvec.clear();
+
+  double local_total = 0, global_total;
+  for (auto& slab : slabs)
+    local_total += slab.total;
+
+  MPI_Allreduce(&local_total, &global_total, 1, MPI_DOUBLE, MPI_SUM, c);
+
+  // Note: local_total can be zero if the partition takes on the minimum
+  // value everywhere.  This means there will be no samples in this partition.
+
+  int n_this_part = 0;
+  if (local_total > 0)
+  {
+    Philox rng(seed, rank, 0);
+    double f_this_part = (local_total / global_total) * nSamples;
+    n_this_part = ((int)f_this_part) + ((rng.uniform() < (f_this_part - (int)f_this_part)) ? 1 : 0);
+  }
+
+  if (n_this_part == 0)
+    return 0;
+
+  std::vector<float> slab_p(nslabs);
+  std::vector<int> slab_alias(nslabs);
+  for (int s = 0; s < nslabs; s++)
+    slab_p[s] = slabs[s].total;
+
+  DensityAliasTable(slab_p.data(), slab_alias.data(), nslabs, local_total);
+
+  int nchunks = (n_this_part + DENSITY_SAMPLE_CHUNK - 1) / DENSITY_SAMPLE_CHUNK;
+  std::vector<std::vector<Particle>> results(nchunks);
+
+  for (int chunk = 0; chunk < nchunks; chunk++)
+  {
+    int n = n_this_part - chunk*DENSITY_SAMPLE_CHUNK;
+    if (n > DENSITY_SAMPLE_CHUNK) n = DENSITY_SAMPLE_CHUNK;
+
+    rvec.emplace_back(threadpool->AddTask(new DensityDrawTask(g, slabs, slab_p.data(), slab_alias.data(),
+                                                               n, seed, rank, chunk+1, results[chunk])));
+  }
+
+  for (auto& r : rvec)
+    r.get();
+
+  for (auto& r : results)
+    for (auto& s : r)
+      p->push_back(s);
+
+  return n_this_part;
+}
+
+} // namespace gxy
@@ -48,56 +48,6 @@ InterpolatorClientServer::InterpolatorClientServer(SocketHandler *sh) : MultiSer
   dst = NULL;
 };
 
-static float interpolate(InterpolatorClientServer::Args *a, VolumeP v, float x, float y, float z)
-{
-  x = (x - a->ox) / a->dx;
-  y = (y - a->oy) / a->dy;
-  z = (z - a->oz) / a->dz;
-
-  int ix = (int)x;
-  int iy = (int)y;
-  int iz = (int)z;
-
-  float dx = x - ix;
-  float dy = y - iy;
-  float dz = z - iz;
-
-  int v000 = (ix + 0) * a->istride + (iy + 0) * a->jstride + (iz + 0) * a->kstride;
-  int v001 = (ix + 0) * a->istride + (iy + 0) * a->jstride + (iz + 1) * a->kstride;
-  int v010 = (ix + 0) * a->istride + (iy + 1) * a->jstride + (iz + 0) * a->kstride;
-  int v011 = (ix + 0) * a->istride + (iy + 1) * a->jstride + (iz + 1) * a->kstride;
-  int v100 = (ix + 1) * a->istride + (iy + 0) * a->jstride + (iz + 0) * a->kstride;
-  int v101 = (ix + 1) * a->istride + (iy + 0) * a->jstride + (iz + 1) * a->kstride;
-  int v110 = (ix + 1) * a->istride + (iy + 1) * a->jstride + (iz + 0) * a->kstride;
-  int v111 = (ix + 1) * a->istride + (iy + 1) * a->jstride + (iz + 1) * a->kstride;
-
-  float b000 = (1.0 - dx) * (1.0 - dy) * (1.0 - dz);
-  float b001 = (1.0 - dx) * (1.0 - dy) * (dz);
-  float b010 = (1.0 - dx) * (dy) * (1.0 - dz);
-  float b011 = (1.0 - dx) * (dy) * (dz);
-  float b100 = (dx) * (1.0 - dy) * (1.0 - dz);
-  float b101 = (dx) * (1.0 - dy) * (dz);
-  float b110 = (dx) * (dy) * (1.0 - dz);
-  float b111 = (dx) * (dy) * (dz);
-
-  if (v->get_type() == Volume::FLOAT)
-  {
-    float *p = (float *)v->get_samples();
-    return p[v000]*b000 + p[v001]*b001 + p[v010]*b010 + p[v011]*b011 +
-           p[v100]*b100 + p[v101]*b101 + p[v110]*b110 + p[v111]*b111;
-  }
-  else
-  {
-    unsigned char *p = (unsigned char *)v->get_samples();
-    return p[v000]*b000 + p[v001]*b001 + p[v010]*b010 + p[v011]*b011 +
-           p[v100]*b100 + p[v101]*b101 + p[v110]*b110 + p[v111]*b111;
-  }
-}
-
-float interpolate(InterpolatorClientServer::Args *args, VolumeP v, Particle& p) { return interpolate(args, v, p.xyz.x, p.xyz.y, p.xyz.z); }
-float interpolate(InterpolatorClientServer::Args *args, VolumeP v, vec3f xyz) { return interpolate(args, v, xyz.x, xyz.y, xyz.z); }
-float interpolate(InterpolatorClientServer::Args *args, VolumeP v, vec3f *xyz) { return interpolate(args, v, xyz->x, xyz->y, xyz->z); }
-
 static void
 Interpolate(InterpolatorClientServer::Args *a)
 {
@@ -107,24 +57,22 @@ Interpolate(InterpolatorClientServer::Args *a)
 
   d->CopyPartitioning(s);
 
-  v->get_ghosted_local_origin(a->ox, a->oy, a->oz);
-  v->get_deltas(a->dx, a->dy, a->dz);
+  int n  = s->GetNumberOfVertices();
+  int nc = v->get_number_of_components();
 
-  int ik, jk, kk;
-  v->get_ghosted_local_counts(ik, jk, kk);
-
-  a->istride = 1;
-  a->jstride = ik;
-  a->kstride = ik * jk;
+  float *values = new float[n * nc];
+  v->Sample(n, s->GetVertices(), values, NULL);
 
   vec3f *srcp = s->GetVertices();
-  for (int i = 0; i < s->GetNumberOfVertices(); i++, srcp++)
+  for (int i = 0; i < n; i++, srcp++)
   {
     Particle p;
     p.xyz = *srcp;
-    p.u.value = interpolate(a, v, srcp);
+    p.u.value = values[i*nc];
     d->push_back(p);
   }
+
+  delete[] values;
 }
 
 class InterpolatorMsg : public Work
@@ -0,0 +1,167 @@
+// ========================================================================== //
+// Copyright (c) 2014-2020 The University of Texas at Austin.                 //
+// All rights reserved.                                                       //
+//                                                                            //
+// Licensed under the Apache License, Version 2.0 (the "License");            //
+// you may not use this file except in compliance with the License.           //
+// A copy of the License is included with this software in the file LICENSE.  //
+// If your copy does not contain the License, you may obtain a copy of the    //
+// License at:                                                                //
+//                                                                            //
+//     https://www.apache.org/licenses/LICENSE-2.0                            //
+//                                                                            //
+// Unless required by applicable law or agreed to in writing, software        //
+// distributed under the License is distributed on an "AS IS" BASIS, WITHOUT  //
+// WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.           //
+// See the License for the specific language governing permissions and        //
+// limitations under the License.                                             //
+//                                                                            //
+// ========================================================================== //
+
+#pragma once
+
+/*! \file MHChains.h 
+ * \brief multi-chain Metropolis-Hastings sampling of a Volume on the thread pool
+ * \ingroup sampler
+ */
+
+#include <vector>
+#include <future>
+
+#include "Application.h"
+#include "Threading.h"
+#include "Philox.h"
+#include "Volume.h"
+#include "Particles.h"
+
+namespace gxy
+{
+
+//! parameters of a multi-chain Metropolis-Hastings run
+/*! \ingroup sampler */
+struct MHChainArgs
+{
+  int      n_chains;      //!< number of independent chains (0 for one per pool thread)
+  int      n_iterations;  //!< iterations across all chains after burn-in
+  int      n_startup;     //!< burn-in iterations ignored by each chain
+  int      n_skip;        //!< only retain every n_skip'th successful sample
+  int      n_miss;        //!< successive misses allowed before a chain restarts
+  float    sigma;         //!< standard deviation of the gaussian step
+  uint32_t seed;          //!< seed shared by all chains; streams are keyed on rank and chain
+};
+
+//! one Metropolis-Hastings chain, run as a thread pool task
+/*! `Q` maps a volume sample to an (unnormalized) probability.  The chain draws
+ * from its own Philox stream and collects its samples into its own buffer,
+ * so chains share nothing while running.
+ * \ingroup sampler
+ */
+template<typename Q>
+class MHChainTask : public ThreadPoolTask
+{
+public:
+  MHChainTask(VolumeP v, MHChainArgs& a, Q q, int chain, int n, std::vector<Particle>& r) :
+    ThreadPoolTask(3), v(v), a(a), q(q), n(n), result(r),
+    rng(a.seed, GetTheApplication()->GetRank(), chain) {}
+
+  int work()
+  {
+    Box *box = v->get_local_box();
+
+    Particle tp;
+    tp.xyz = starting_point(box);
+    tp.u.value = sample(tp.xyz);
+
+    float tq = q(tp.u.value);
+
+    int miss_count = 0;
+    for (int iteration = 0; iteration < (a.n_startup + n); )
+    {
+      Particle cp(tp.xyz.x + a.sigma*rng.normal(), tp.xyz.y + a.sigma*rng.normal(), tp.xyz.z + a.sigma*rng.normal(), float(0.0));
+      if (! box->isIn(cp.xyz)) continue;
+
+      iteration ++;
+
+      cp.u.value = sample(cp.xyz);
+      float cq = q(cp.u.value);
+
+      if ((cq > tq) || (rng.uniform() < (cq/tq)))
+      {
+        tp = cp;
+        tq = cq;
+        if ((iteration > a.n_startup) && ((iteration % a.n_skip) == 0))
+          result.push_back(tp);
+        miss_count = 0;
+      }
+      else if (++miss_count > a.n_miss)
+      {
+        tp.xyz = starting_point(box);
+        tp.u.value = sample(tp.xyz);
+        tq = q(tp.u.value);
+        miss_count = 0;
+      }
+    }
+
+    return result.size();
+  }
+
+private:
+  vec3f starting_point(Box *box)
+  {
+    float x = rng.uniform(), y = rng.uniform(), z = rng.uniform();
+    return vec3f(box->xyz_min.x + x*(box->xyz_max.x - box->xyz_min.x),
+                 box->xyz_min.y + y*(box->xyz_max.y - box->xyz_min.y),
+                 box->xyz_min.z + z*(box->xyz_max.z - box->xyz_min.z));
+  }
+
+  float sample(vec3f& xyz)
+  {
+    float value;
+    return v->Sample(xyz, value) ? value : 0.0;
+  }
+
+  VolumeP v;
+  MHChainArgs a;
+  Q q;
+  int n;
+  std::vector<Particle>& result;
+  Philox rng;
+};
+
+//! run independent Metropolis-Hastings chains over the local partition of `v` 
+/*! The iterations are divided among the chains, which run concurrently on the
+ * thread pool.   Their samples are appended to `p` in chain order once all 
+ * have finished, so the result depends only on the arguments, the rank and 
+ * the number of chains.   Returns the number of samples added.
+ * \ingroup sampler
+ */
+template<typename Q>
+int 
+MHChains(VolumeP v, ParticlesP p, MHChainArgs& a, Q q)
+{
+  ThreadPool *threadpool = GetTheApplication()->GetTheThreadPool();
+
+  int nchains = (a.n_chains > 0) ? a.n_chains : threadpool->GetNumberOfThreads();
+  if (nchains < 1) nchains = 1;
+
+  std::vector<std::vector<Particle>> results(nchains);
+  std::vector<std::future<int>> rvec;
+
+  for (int c = 0; c < nchains; c++)
+  {
+    int n = (a.n_iterations / nchains) + ((c < (a.n_iterations % nchains)) ? 1 : 0);
+    rvec.emplace_back(threadpool->AddTask(new MHChainTask<Q>(v, a, q, c, n, results[c])));
+  }
+
+  int total = 0;
+  for (auto& r : rvec)
+    total += r.get();
+
+  for (auto& r : results)
+    for (auto& s : r)
+      p->push_back(s);
+
+  return total;
+}
+
+} // namespace gxy
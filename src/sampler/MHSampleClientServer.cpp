@@ -31,13 +31,8 @@
 
 #include "Datasets.h"
 #include "MHSampleClientServer.h"
+#include "MHChains.h"
 
-#include <time.h>
-#include <boost/random/normal_distribution.hpp>
-#include <boost/random/mersenne_twister.hpp>
-#include <boost/random/variate_generator.hpp>
-
-using namespace boost;
 using namespace gxy;
 using namespace std;
 
@@ -63,34 +58,19 @@ MHSampleClientServer::MHSampleClientServer(SocketHandler *sh) : MultiServerHandl
   args.n_startup    = 1000;
   args.n_skip       = 10;
   args.n_miss       = 10;
+  args.n_chains     = 0;
+  args.seed         = 0;
   args.r = args.g = args.b = 0.8; args.a = 1.0;
 
   volume = NULL;
   particles = NULL;
 };
 
-static variate_generator<mt19937, normal_distribution<> > *generator;
-
-static void normally_distributed_vector(double* v)
-{
-  for (size_t i = 0; i < 3; ++i)
-    v[i]=(*generator)();
-}
-
 static float gaussian(float x, float m, float s)
 {
   return ( 1 / ( s * sqrt(2*M_PI) ) ) * exp( -0.5 * pow( (x-m)/s, 2.0 ) );
 }
 
-#define RNDM ((float)rand() / RAND_MAX) 
-static vec3f get_starting_point(VolumeP v)
-{
-  Box *box = v->get_local_box();
-  return vec3f(box->xyz_min.x + RNDM*(box->xyz_max.x - box->xyz_min.x),
-               box->xyz_min.y + RNDM*(box->xyz_max.y - box->xyz_min.y),
-               box->xyz_min.z + RNDM*(box->xyz_max.z - box->xyz_min.z));
-}
-
 static float Q(VolumeP v, float s, MHSampleClientServer::Args *a)
 {
   float q;
@@ -118,66 +98,12 @@ static float Q(VolumeP v, float s, MHSampleClientServer::Args *a)
   return q;
 }
 
-static float sample(MHSampleClientServer::Args *args, VolumeP v, float x, float y, float z)
-{
-  float dx, dy, dz;
-  v->get_deltas(dx, dy, dz);
-
-  float ox, oy, oz;
-  v->get_ghosted_local_origin(ox, oy, oz);
-
-  x = (x - ox) / dx;
-  y = (y - oy) / dy;
-  z = (z - oz) / dz;
-
-  int ix = (int)x;
-  int iy = (int)y;
-  int iz = (int)z;
-
-  dx = x - ix;
-  dy = y - iy;
-  dz = z - iz;
-
-  int v000 = (ix + 0) * args->istep + (iy + 0) * args->jstep + (iz + 0) * args->kstep;
-  int v001 = (ix + 0) * args->istep + (iy + 0) * args->jstep + (iz + 1) * args->kstep;
-  int v010 = (ix + 0) * args->istep + (iy + 1) * args->jstep + (iz + 0) * args->kstep;
-  int v011 = (ix + 0) * args->istep + (iy + 1) * args->jstep + (iz + 1) * args->kstep;
-  int v100 = (ix + 1) * args->istep + (iy + 0) * args->jstep + (iz + 0) * args->kstep;
-  int v101 = (ix + 1) * args->istep + (iy + 0) * args->jstep + (iz + 1) * args->kstep;
-  int v110 = (ix + 1) * args->istep + (iy + 1) * args->jstep + (iz + 0) * args->kstep;
-  int v111 = (ix + 1) * args->istep + (iy + 1) * args->jstep + (iz + 1) * args->kstep;
-
-  float b000 = (1.0 - dx) * (1.0 - dy) * (1.0 - dz);
-  float b001 = (1.0 - dx) * (1.0 - dy) * (dz);
-  float b010 = (1.0 - dx) * (dy) * (1.0 - dz);
-  float b011 = (1.0 - dx) * (dy) * (dz);
-  float b100 = (dx) * (1.0 - dy) * (1.0 - dz);
-  float b101 = (dx) * (1.0 - dy) * (dz);
-  float b110 = (dx) * (dy) * (1.0 - dz);
-  float b111 = (dx) * (dy) * (dz);
-
-  if (v->get_type() == Volume::FLOAT)
-  {
-    float *p = (float *)v->get_samples();
-    return p[v000]*b000 + p[v001]*b001 + p[v010]*b010 + p[v011]*b011 +
-           p[v100]*b100 + p[v101]*b101 + p[v110]*b110 + p[v111]*b111;
-  }
-  else
-  {
-    unsigned char *p = (unsigned char *)v->get_samples();
-    return p[v000]*b000 + p[v001]*b001 + p[v010]*b010 + p[v011]*b011 +
-           p[v100]*b100 + p[v101]*b101 + p[v110]*b110 + p[v111]*b111;
-  }
-}
-
-float sample(MHSampleClientServer::Args *args, VolumeP v, Particle& p) { return sample(args, v, p.xyz.x, p.xyz.y, p.xyz.z); }
-float sample(MHSampleClientServer::Args *args, VolumeP v, vec3f xyz) { return sample(args, v, xyz.x, xyz.y, xyz.z); }
+// The sampling itself is done by independent chains on the thread pool, each
+// with its own Philox stream keyed on (seed, rank, chain) - see MHChains.h
 
 static void
 Metropolis_Hastings(MHSampleClientServer::Args *a)
 {
-  generator = new variate_generator<mt19937, normal_distribution<> >(mt19937(time(0)), normal_distribution<>(0.0, a->sigma));
-
   VolumeP v = Volume::Cast(KeyedDataObject::GetByKey(a->vk));
   ParticlesP p = Particles::Cast(KeyedDataObject::GetByKey(a->pk));
 
@@ -187,72 +113,16 @@ Metropolis_Hastings(MHSampleClientServer::Args *a)
 
   p->SetDefaultColor(a->r, a->g, a->b, a->a);
 
-  float deltaX, deltaY, deltaZ;
-  v->get_deltas(deltaX, deltaY, deltaZ);
-
-  float ox, oy, oz;
-  v->get_local_origin(ox, oy, oz);
-
-  int lioff, ljoff, lkoff;
-  v->get_ghosted_local_offsets(lioff, ljoff, lkoff);
-
-  int nli, nlj, nlk;
-  v->get_local_counts(nli, nlj, nlk);
-
-  int gnli, gnlj, gnlk;
-  v->get_ghosted_local_counts(gnli, gnlj, gnlk);
-
-  int local_count = nli*nlj*nlk;
-
-  float max_x = ox + (nli-1) * deltaX,
-        max_y = oy + (nlj-1) * deltaY,
-        max_z = oz + (nlk-1) * deltaZ;
-
-  int ngx, ngy, ngz;
-  v->get_local_counts(ngx, ngy, ngz);
-  int global_count = ngx*ngy*ngz;
-
-  a->istep = 1;
-  a->jstep = gnli;
-  a->kstep = gnli * gnlj;
-
-  Particle tp;
-  tp.xyz = get_starting_point(v);
-  tp.u.value = sample(a, v, tp.xyz);
-
-  float tq = Q(v, tp.u.value, a);
-
-  Box *partition_box = v->get_local_box();
+  MHChainArgs ca;
+  ca.n_chains     = a->n_chains;
+  ca.n_iterations = a->n_iterations;
+  ca.n_startup    = a->n_startup;
+  ca.n_skip       = a->n_skip;
+  ca.n_miss       = a->n_miss;
+  ca.sigma        = a->sigma;
+  ca.seed         = a->seed;
 
-  int miss_count = 0;
-  for (int iteration = 0; iteration < (a->n_startup + a->n_iterations); )
-  {
-    double rv[3];
-    normally_distributed_vector(rv);
-
-    Particle cp(tp.xyz.x + rv[0], tp.xyz.y + rv[1], tp.xyz.z + rv[2], float(0.0));
-    if (! partition_box->isIn(cp.xyz)) continue;
-
-    iteration ++;
-
-    cp.u.value = sample(a, v, cp);
-    float cq = Q(v, cp.u.value, a);
-
-    if ((cq > tq) || (RNDM < (cq/tq)))
-    {
-      tp = cp;
-      tq = cq;
-      if ((iteration > a->n_startup) && ((iteration % a->n_skip) == 0))
-        p->push_back(tp);
-      miss_count = 0;
-    }
-    else if (++miss_count > a->n_miss)
-    {
-      tp.xyz = get_starting_point(v);
-      tp.u.value = sample(a, v, tp.xyz);
-      miss_count = 0;
-    }
-  }
+  MHChains(v, p, ca, [v, a](float s) { return Q(v, s, a); });
 
   std::cerr << "created " << p->GetNumberOfVertices() << " samples\n";
 }
@@ -281,7 +151,6 @@ WORK_CLASS_TYPE(MHSampleMsg)
 extern "C" void
 init()
 {
-  srand(GetTheApplication()->GetRank());
   MHSampleMsg::Register();
 }
 
@@ -413,6 +282,30 @@ MHSampleClientServer::handle(std::string line, std::string& reply)
     reply = "ok";
     return true;
   }
+  else if (cmd == "chains")
+  {
+    ss >> args.n_chains;
+    if (ss.fail())
+    {
+      reply = "error MHSampler chains command requires an integer argument";
+      return true;
+    }
+
+    reply = "ok";
+    return true;
+  }
+  else if (cmd == "seed")
+  {
+    ss >> args.seed;
+    if (ss.fail())
+    {
+      reply = "error MHSampler seed command requires an integer argument";
+      return true;
+    }
+
+    reply = "ok";
+    return true;
+  }
   else if (cmd == "color")
   {
     ss >> args.r >> args.g >> args.b >> args.a;
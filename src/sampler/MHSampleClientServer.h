@@ -70,11 +70,10 @@ public:
     int   n_iterations;   // iteration limit - after the initial skipped iterations
     int   n_startup;      // initial iterations to ignore
     int   n_skip;         // only retain every n_skip'th successful sample
-    int   n_miss;         // max number of successive misses allowed before termination
+    int   n_miss;         // max number of successive misses allowed before a chain restarts
+    int   n_chains;       // number of independent chains per process (0: one per pool thread)
+    unsigned int seed;    // seed for the per-chain random streams
     float r, g, b, a;     // color for spheres
-    float istep;          // steps along i, j, and k axes 
-    float jstep;
-    float kstep;
   } args;
 };
 
@@ -25,6 +25,7 @@
 #include "Particles.h"
 #include "Rays.h"
 #include "SchlierenTraceRays.h"
+#include "SchlierenTraceRays_ispc.h"
 
 #include "rapidjson/document.h"
 #include "rapidjson/stringbuffer.h"
@@ -49,6 +50,18 @@ Schlieren::Initialize()
   super::Initialize();
 }
 
+void
+Schlieren::initialize()
+{
+  super::initialize();
+
+  far = 0;
+
+  min_step = 0.25;
+  max_step = 2.0;
+  max_bend = 0.001;
+}
+
 void
 Schlieren::HandleTerminatedRays(RayList *raylist)
 {
@@ -86,10 +99,6 @@ Schlieren::HandleTerminatedRays(RayList *raylist)
   vu = cross(vr, vd);
   normalize(vu);
 
-  // Get planar equation of projection plane: {vd.x, vd.y, vd.z, d} where d is:
-
-  vec4f projection_plane(vd.x, vd.y, vd.z, -dot(vd, center));
-
   // Need to be able to transform screen x,y to WCS point
 
   int width, height;
@@ -103,96 +112,18 @@ Schlieren::HandleTerminatedRays(RayList *raylist)
   float off_y = ((height - 1) / 2.0);
   float pixel_scaling = (((width < height) ? width : height) - 1.0) / 2.0;
 
-  // for each ray...
-
-  int mx, my;
-  float dmax = 0;
-
-  for (int i = 0; i < raylist->GetRayCount(); i++)
-  {
-    // If its terminated, project forward to projection plane
-    // and determine color by difference
-    // between projected destination and original destination
-
-    if (raylist->get_classification(i) == Renderer::TERMINATED)
-    {
-      // Final point and direction of bent ray
-
-      vec3f p_term(raylist->get_ox(i), raylist->get_oy(i), raylist->get_oz(i));
-      vec3f d_term(raylist->get_dx(i), raylist->get_dy(i), raylist->get_dz(i));
-
-      if (raylist->get_x(i) == 1 && raylist->get_y(i) == 6)
-      {
-        std::cerr << "o " << raylist->get_ox(i) << " " << raylist->get_oy(i) << " " << raylist->get_oz(i) << "\n";
-        std::cerr << "d " << raylist->get_dx(i) << " " << raylist->get_dy(i) << " " << raylist->get_dz(i) << "\n";
-      }
-
-      normalize(d_term);
-
-      // We want the intersection of the ray starting at the exit point in
-      // the exit direction with the projection plane.  The projection distance
-      // is the hyp - the perpendicular distance divided by the cosine of the
-      // angle between the perpendicular direction and the exit vector.
-
-      float d_perp = -(dot(projection_plane, p_term) + projection_plane.w);
-      float cos_theta = dot(projection_plane, d_term);
-      float d_exit_vector = d_perp / cos_theta;
-      
-      vec3f p_proj = p_term + d_term * d_exit_vector;
-
-      // Now p_proj is the point the bent ray extends to in the projection plane.   
-      // Where would the original ray have hit?
-
-      int pixel_ix = raylist->get_x(i);
-      int pixel_iy = raylist->get_y(i);
-
-      float pixel_fx = (pixel_ix - off_x) / pixel_scaling;
-      float pixel_fy = (pixel_iy - off_y) / pixel_scaling;
-
-      vec3f pixel_wcs = center + (vr * pixel_fx) + (vu * pixel_fy);
+  // Project each terminated ray forward to the projection plane and color
+  // it by the difference between its projected destination and the
+  // original's
 
-      // distance of pixel_wcs from plane perpendicular to the plane...
+  float vpa[] = {vp.x, vp.y, vp.z};
+  float vda[] = {vd.x, vd.y, vd.z};
+  float vra[] = {vr.x, vr.y, vr.z};
+  float vua[] = {vu.x, vu.y, vu.z};
+  float ca[]  = {center.x, center.y, center.z};
 
-      d_perp = -(dot(projection_plane, pixel_wcs) + projection_plane.w);
-
-      vec3f p_proj_orig;
-      if (is_ortho)
-      {
-        // Then project perpendicular to projection plane
-        p_proj_orig = pixel_wcs + (vd * d_perp);
-      }
-      else
-      {
-        // original ray direction from eye through pixel
-
-        vec3f d_orig = pixel_wcs - vp;
-        normalize(d_orig);
-
-        // Distance along original direction depends on angle between original dir and 
-        // normal of projection plane
-
-        cos_theta = dot(projection_plane, d_orig);
-        float d_orig_vector = d_perp / cos_theta;
-
-        p_proj_orig = pixel_wcs + d_orig * d_orig_vector;
-      }
-
-      vec3f delta = p_proj - p_proj_orig;
-      
-      float dd = sqrt(delta.x*delta.x + delta.y*delta.y + delta.z*delta.z);
-      if (dd > dmax)
-      {
-        mx = pixel_ix;
-        my = pixel_iy;
-        dmax = dd;
-      }
-
-      raylist->set_r(i, delta.x);
-      raylist->set_g(i, delta.y);
-      raylist->set_b(i, delta.z);
-      raylist->set_o(i, dd);
-    }
-  }
+  ispc::SchlierenTraceRays_Project(raylist->GetRayCount(), raylist->GetIspc(), Renderer::TERMINATED,
+      vpa, vda, vra, vua, ca, is_ortho, off_x, off_y, pixel_scaling);
 
   super::HandleTerminatedRays(raylist);
 }
@@ -200,15 +131,19 @@ Schlieren::HandleTerminatedRays(RayList *raylist)
 int
 Schlieren::SerialSize()
 {
-  return super::SerialSize() + sizeof(float);
+  return super::SerialSize() + 4*sizeof(float);
 }
 
 unsigned char *
 Schlieren::Serialize(unsigned char *p)
 {
   p = super::Serialize(p);
-  *(float *)p = GetFar();
-  p += sizeof(float);
+  float *f = (float *)p;
+  f[0] = GetFar();
+  f[1] = min_step;
+  f[2] = max_step;
+  f[3] = max_bend;
+  p += 4*sizeof(float);
   return p;
 }
 
@@ -216,8 +151,12 @@ unsigned char *
 Schlieren::Deserialize(unsigned char *p)
 {
   p = super::Deserialize(p);
-  SetFar(*(float *)p);
-  p += sizeof(float);
+  float *f = (float *)p;
+  SetFar(f[0]);
+  min_step = f[1];
+  max_step = f[2];
+  max_bend = f[3];
+  p += 4*sizeof(float);
   return p;
 }
 
@@ -237,6 +176,18 @@ Schlieren::Trace(RayList *raylist)
 
   SchlierenTraceRays tracer;
 
+  for (int i = 0; i < visualization->GetNumberOfVis(); i++)
+  {
+    VolumeP volume = Volume::Cast(visualization->GetVis(i)->GetTheData());
+    if (volume)
+    {
+      tracer.SetTheVolume(volume);
+      break;
+    }
+  }
+
+  tracer.SetStepping(min_step, max_step, max_bend);
+
   RayList *out = tracer.Trace(rendering->GetLighting(), visualization, raylist);
   if (out)
   {
@@ -262,6 +213,15 @@ Schlieren::LoadStateFromValue(Value& v)
   if (v.HasMember("far"))
       SetFar(v["far"].GetDouble());
 
+  if (v.HasMember("min step"))
+      min_step = v["min step"].GetDouble();
+
+  if (v.HasMember("max step"))
+      max_step = v["max step"].GetDouble();
+
+  if (v.HasMember("max bend"))
+      max_bend = v["max bend"].GetDouble();
+
   return true;
 }
 
@@ -269,6 +229,9 @@ void
 Schlieren::SaveStateToValue(Value& v, Document& doc)
 {
   v.AddMember("far", Value().SetDouble(GetFar()), doc.GetAllocator());
+  v.AddMember("min step", Value().SetDouble(min_step), doc.GetAllocator());
+  v.AddMember("max step", Value().SetDouble(max_step), doc.GetAllocator());
+  v.AddMember("max bend", Value().SetDouble(max_bend), doc.GetAllocator());
 }
 
 bool
@@ -49,6 +49,7 @@ class Schlieren : public Renderer
     
 public:
   static void Initialize();
+  virtual void initialize(); //!< initializes the Schlieren renderer
 
   virtual bool LoadStateFromValue(rapidjson::Value&);
   virtual void SaveStateToValue(rapidjson::Value&, rapidjson::Document&);
@@ -70,6 +71,10 @@ protected:
 private:
   float far;
 
+  // Adaptive stepping of the bending integrator; see SchlierenTraceRays::SetStepping
+
+  float min_step, max_step, max_bend;
+
   //! a Work unit to instruct Galaxy processes to begin rendering
   class NormalizeSchlierenImagesMsg : public Work
   {
@@ -26,6 +26,7 @@
 #include "Particles.h"
 #include "Rays.h"
 #include "Schlieren2TraceRays.h"
+#include "Schlieren2Rendering.h"
 
 #include "rapidjson/document.h"
 #include "rapidjson/stringbuffer.h"
@@ -39,6 +40,7 @@ using namespace std;
 namespace gxy 
 {
 WORK_CLASS_TYPE(Schlieren2::NormalizeSchlieren2ImagesMsg);
+WORK_CLASS_TYPE(Schlieren2::ReduceSplatsMsg);
 
 KEYED_OBJECT_CLASS_TYPE(Schlieren2)
 
@@ -47,6 +49,7 @@ Schlieren2::Initialize()
 { 
   RegisterClass();
   NormalizeSchlieren2ImagesMsg::Register();
+  ReduceSplatsMsg::Register();
   super::Initialize();
 }
 
@@ -110,10 +113,6 @@ Schlieren2::HandleTerminatedRays(RayList *raylist)
 
   // for each ray...
 
-  int mx, my;
-  float dmax = 0;
-
-  int kkk = 0;
   for (int i = 0; i < raylist->GetRayCount(); i++)
   {
     // If its terminated, project forward to projection plane
@@ -216,9 +215,26 @@ Schlieren2::HandleTerminatedRays(RayList *raylist)
     }
   }
 
-  std::cerr << kkk << " photons moved bucket\n";
+  // Splat the hits here rather than sending them to the owner of the 
+  // rendering; they are combined when the frame is done
+
+  Schlieren2RenderingP s2r = Schlieren2Rendering::Cast(rendering);
+  if (! s2r)
+  {
+    super::HandleTerminatedRays(raylist);
+    return;
+  }
+
+  vector<float> X, Y;
+  for (int i = 0; i < raylist->GetRayCount(); i++)
+    if (raylist->get_classification(i) == Renderer::TERMINATED)
+    {
+      X.push_back(raylist->get_r(i));
+      Y.push_back(raylist->get_g(i));
+    }
 
-  super::HandleTerminatedRays(raylist);
+  if (X.size() > 0)
+    s2r->Splat(X.size(), X.data(), Y.data());
 }
 
 int
@@ -364,6 +380,28 @@ Schlieren2::NormalizeImages(RenderingSetP rs)
   msg.Broadcast(true, true);
 }
 
+bool
+Schlieren2::ReduceSplatsMsg::CollectiveAction(MPI_Comm c, bool is_root)
+{
+  RenderingSetP rs = RenderingSet::GetByKey(*(Key *)contents->get());
+
+  for (int i = 0; i < rs->GetNumberOfRenderings(); i++)
+  {
+    Schlieren2RenderingP r = Schlieren2Rendering::Cast(rs->GetRendering(i));
+    if (r)
+      r->local_reduce_splats(c);
+  }
+
+  return false;
+}
+
+void
+Schlieren2::ReduceSplats(RenderingSetP rs)
+{
+  ReduceSplatsMsg msg(rs);
+  msg.Broadcast(true, true);
+}
+
 void
 Schlieren2::local_render(RendererP renderer, RenderingSetP renderingSet)
 {
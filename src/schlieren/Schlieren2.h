@@ -65,6 +65,10 @@ public:
 
   void NormalizeImages(RenderingSetP);
 
+  //! sum the hits splatted at every process into the framebuffers of the owners of the Schlieren2Renderings of the RenderingSet
+  /*! Called once rendering of the frame is done */
+  void ReduceSplats(RenderingSetP);
+
   float GetFar() { return far; }
   void  SetFar(float f) { far = f; }
 
@@ -105,6 +109,21 @@ private:
     int frame;
   };
 
+  //! a Work unit to instruct Galaxy processes to combine their splat images
+  class ReduceSplatsMsg : public Work
+  {
+  public:
+    ReduceSplatsMsg(RenderingSetP rs) : ReduceSplatsMsg(sizeof(Key))
+    {
+      unsigned char *p = (unsigned char *)contents->get();
+      *(Key *)p = rs->getkey();
+    }
+
+    WORK_CLASS(ReduceSplatsMsg, true);
+
+    bool CollectiveAction(MPI_Comm coll_comm, bool isRoot);
+  };
+
 };
 
 } // namespace gxy
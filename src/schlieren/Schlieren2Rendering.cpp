@@ -18,6 +18,11 @@
 //                                                                            //
 // ========================================================================== //
 
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#include "Application.h"
 #include "Schlieren2Rendering.h"
 
 namespace gxy
@@ -31,17 +36,60 @@ Schlieren2Rendering::Register()
 }
 
 void
-Schlieren2Rendering::AddLocalPixels(Pixel *p, int n, int f, int s)
+Schlieren2Rendering::initialize()
+{
+  super::initialize();
+  pthread_mutex_init(&splat_lock, NULL);
+}
+
+Schlieren2Rendering::~Schlieren2Rendering()
+{
+  pthread_mutex_destroy(&splat_lock);
+}
+
+void
+Schlieren2Rendering::local_reset()
+{
+  super::local_reset();
+
+  pthread_mutex_lock(&splat_lock);
+  for (auto& s : splats)
+    std::fill(s.second.begin(), s.second.end(), 0.0f);
+  pthread_mutex_unlock(&splat_lock);
+}
+
+// Bilinearly deposit a hit at (x, y) into a single-channel image whose 
+// pixels are stride floats apart
+
+static inline void
+deposit(float *image, int stride, int width, int height, float x, float y)
 {
-std::cerr << "SR " << n << "\n";
+  int ix = floor(x), iy = floor(y);
+  float dx = x - ix, dy = y - iy;
+
+  if (ix >= 0 && ix < width)
+  {
+    if (iy >= 0 && iy < height) image[(iy*width + ix) * stride] += (1.0 - dx) * (1.0 - dy);
+    if (iy+1 >= 0 && iy+1 < height) image[((iy+1)*width + ix) * stride] += (1.0 - dx) * dy;
+  }
 
+  if ((ix+1) >= 0 && (ix+1) < width)
+  {
+    if (iy >= 0 && iy < height) image[(iy*width + (ix+1)) * stride] += dx * (1.0 - dy);
+    if (iy+1 >= 0 && iy+1 < height) image[((iy+1)*width + (ix+1)) * stride] += dx * dy;
+  }
+}
+
+void
+Schlieren2Rendering::AddLocalPixels(Pixel *p, int n, int f, int s)
+{
 #if defined(GXY_EVENT_TRACKING)
   GetTheEventTracker()->Add(new LocalPixelsEvent(n, this->getkey(), f));
 #endif
 
   if (! framebuffer)
   {
-    cerr << "ERROR: Rendering::Schlieren2AddLocalPixel called by non-owner" << endl;
+    std::cerr << "ERROR: Rendering::Schlieren2AddLocalPixel called by non-owner" << std::endl;
     exit(1);
   }
 
@@ -50,28 +98,64 @@ std::cerr << "SR " << n << "\n";
     if (f > frame)
       frame = f;
    
-    while (n-- > 0)
+    pthread_mutex_lock(&splat_lock);
+
+    for ( ; n-- > 0; p++)
+      deposit(framebuffer, 4, width, height, p->r, p->g);
+
+    pthread_mutex_unlock(&splat_lock);
+  }
+}
+
+void
+Schlieren2Rendering::Splat(int n, const float *x, const float *y)
+{
+  // Each thread's image is created on its first splat and only ever
+  // touched by it until the reduction
+
+  pthread_mutex_lock(&splat_lock);
+  std::vector<float>& s = splats[pthread_self()];
+  if (s.size() != (size_t)(width * height))
+    s.assign(width * height, 0.0f);
+  pthread_mutex_unlock(&splat_lock);
+
+  float *image = s.data();
+  for (int i = 0; i < n; i++)
+    deposit(image, 1, width, height, x[i], y[i]);
+}
+
+void
+Schlieren2Rendering::local_reduce_splats(MPI_Comm c)
+{
+  int n = width * height;
+  std::vector<float> sum(n, 0.0f);
+
+  pthread_mutex_lock(&splat_lock);
+
+  for (auto& s : splats)
+    if (s.second.size() == (size_t)n)
     {
-      float x = p->r, y = p->g;
-      int ix = floor(x), iy = floor(y);
-      float dx = x - ix, dy = y - iy;
-
-      if (ix >= 0 && ix < width)
-      {
-        if (iy > 0) framebuffer[(iy*width + ix) << 2] += (1.0 - dx) * (1.0 - dy);
-        if (iy+1 < height) framebuffer[((iy+1)*width + ix) << 2] += (1.0 - dx) * dy;
-      }
-
-      if ((ix+1) >= 0 && (ix+1) < width)
-      {
-        if (iy > 0) framebuffer[(iy * width + (ix+1)) << 2] += dx * (1.0 - dy);
-        if (iy+1 < height) framebuffer[((iy+1)*width + (ix+1)) << 2] += dx * dy;
-      }
-
-      p++;
+      float *src = s.second.data();
+      float *dst = sum.data();
+      for (int i = 0; i < n; i++)
+        dst[i] += src[i];
+
+      std::fill(s.second.begin(), s.second.end(), 0.0f);
     }
 
+  pthread_mutex_unlock(&splat_lock);
+
+  if (GetTheApplication()->GetTheMessageManager()->UsingMPI())
+  {
+    if (IsLocal())
+      MPI_Reduce(MPI_IN_PLACE, sum.data(), n, MPI_FLOAT, MPI_SUM, owner, c);
+    else
+      MPI_Reduce(sum.data(), NULL, n, MPI_FLOAT, MPI_SUM, owner, c);
   }
+
+  if (IsLocal())
+    for (int i = 0; i < n; i++)
+      framebuffer[i << 2] += sum[i];
 }
 
 }
@@ -25,6 +25,10 @@
  * \ingroup render
  */
 
+#include <map>
+#include <pthread.h>
+#include <vector>
+
 #include "Rendering.h"
 
 namespace gxy
@@ -32,14 +36,37 @@ namespace gxy
 
 OBJECT_POINTER_TYPES(Schlieren2Rendering)
 
+//! a Rendering that accumulates hits on the image plane
+/*! Every process splats the hits of the rays it terminates into its own 
+ * hit-count image, one per ray processing thread, so no pixels are sent 
+ * while rendering.   At the end of the frame ReduceSplats sums them into
+ * the red channel of the owner's framebuffer.
+ */
 class Schlieren2Rendering : public Rendering
 {
   KEYED_OBJECT_SUBCLASS(Schlieren2Rendering, Rendering);
 
 public:
+  virtual void initialize(); //!< initialize this Schlieren2Rendering
+  virtual ~Schlieren2Rendering(); //!< destructor
+
+  //! clear the splat images as well as the owner's framebuffer
+  virtual void local_reset();
+
+  //! add hits, whose image-plane positions are in the pixels' r and g, to the owner's framebuffer
   virtual void AddLocalPixels(Pixel *p, int n, int f, int sender = -1);
-};
 
-}
+  //! deposit n hits at image-plane positions (x[i], y[i]) bilinearly into this process's splat image
+  /*! Called concurrently by the ray processing threads */
+  void Splat(int n, const float *x, const float *y);
+
+  //! sum the splat images of all processes into the owner's framebuffer and clear them
+  /*! Collective; performed in response to a Schlieren2 ReduceSplatsMsg */
+  void local_reduce_splats(MPI_Comm c);
 
+private:
+  pthread_mutex_t splat_lock;
+  std::map<pthread_t, std::vector<float>> splats;
+};
 
+}
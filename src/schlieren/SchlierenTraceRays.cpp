@@ -44,6 +44,52 @@ SchlierenTraceRays::SchlierenTraceRays()
 
 SchlierenTraceRays::~SchlierenTraceRays()
 {
+  destroy_ispc();
+}
+
+void
+SchlierenTraceRays::allocate_ispc()
+{
+  ispc = ispc::SchlierenTraceRays_allocate();
+}
+
+void
+SchlierenTraceRays::initialize_ispc()
+{
+  ispc::SchlierenTraceRays_initialize(GetIspc());
+}
+
+void
+SchlierenTraceRays::destroy_ispc()
+{
+  if (ispc)
+  {
+    ispc::SchlierenTraceRays_destroy(GetIspc());
+    ispc = NULL;
+  }
+}
+
+void
+SchlierenTraceRays::SetTheVolume(VolumeP volume)
+{
+  if (! volume || volume->get_number_of_components() != 1 || ! volume->get_samples())
+    return;
+
+  float origin[3], deltas[3];
+  int offsets[3], counts[3];
+
+  volume->get_global_origin(origin[0], origin[1], origin[2]);
+  volume->get_deltas(deltas[0], deltas[1], deltas[2]);
+  volume->get_ghosted_local_offsets(offsets[0], offsets[1], offsets[2]);
+  volume->get_ghosted_local_counts(counts[0], counts[1], counts[2]);
+
+  ispc::SchlierenTraceRays_set_volume(GetIspc(), volume->get_samples(), volume->isFloat(), origin, deltas, offsets, counts);
+}
+
+void
+SchlierenTraceRays::SetStepping(float min_step, float max_step, float max_bend)
+{
+  ispc::SchlierenTraceRays_set_stepping(GetIspc(), min_step, max_step, max_bend);
 }
 
 RayList *
@@ -35,6 +35,7 @@
 #include "Lighting.h"
 #include "Rays.h"
 #include "Visualization.h"
+#include "Volume.h"
 
 namespace gxy
 {
@@ -58,8 +59,24 @@ public:
    */
   RayList *Trace(Lighting* lights, VisualizationP visualization, RayList * raysIn);
 
-protected:
+  //! sample the refractive index, and its gradient, directly from the local grid of the given Volume
+  /*! Only single-component volumes are sampled directly; otherwise, or if this
+   * is not called, the OSPRay volume is sampled and differenced.
+   */
+  void SetTheVolume(VolumeP volume);
 
+  //! set the adaptive stepping of the bending integrator
+  /*! \param min_step the shortest step, as a multiple of the volume's sampling step
+   * \param max_step the longest step, as a multiple of the volume's sampling step
+   * \param max_bend the deflection per step, in radians, above which the step is halved 
+   *                 and below a quarter of which it is doubled; 0 for fixed steps
+   */
+  void SetStepping(float min_step, float max_step, float max_bend);
+
+protected:
+  virtual void allocate_ispc();
+  virtual void initialize_ispc();
+  virtual void destroy_ispc();
 };
 
 } // namespace gxy
@@ -295,6 +295,8 @@ int main(int argc,  char *argv[])
 
       if (original_algorithm)
         Schlieren::Cast(theRenderer)->NormalizeImages(rs);
+      else
+        Schlieren2::Cast(theRenderer)->ReduceSplats(rs);
       sleep(4);
 
       rs->SaveImages(cinema ? (cdb + "/image/image").c_str() : "image", true);
@@ -23,9 +23,13 @@
 #include <unistd.h>
 #include <string.h>
 #include <sys/types.h>
+#include <vector>
+#include <future>
 
 #include <dtypes.h>
 
+#include "Application.h"
+#include "Threading.h"
 #include "Interpolator.h"
 
 using namespace gxy;
@@ -34,6 +38,66 @@ using namespace std;
 namespace gxy
 {
 
+// Geometry carries a single value per vertex; for vector volumes take 
+// the first component
+
+static int
+sample_first_component(VolumeP vol, int n, vec3f *p, float *d, unsigned char *valid)
+{
+  int nc = vol->get_number_of_components();
+  if (nc == 1)
+    return vol->Sample(n, p, d, valid);
+
+  float *values = new float[n * nc];
+  int k = vol->Sample(n, p, values, valid);
+  for (int i = 0; i < n; i++)
+    d[i] = values[i*nc];
+  delete[] values;
+
+  return k;
+}
+
+// Interpolate a contiguous range of vertices on a pool thread
+
+class interpolate_task : public ThreadPoolTask
+{
+public:
+  interpolate_task(VolumeP v, int n, vec3f *p, float *d, unsigned char *valid) : 
+    ThreadPoolTask(3), vol(v), n(n), p(p), d(d), valid(valid) {}
+
+  int work()
+  {
+    return sample_first_component(vol, n, p, d, valid);
+  }
+
+private:
+  VolumeP vol;
+  int n;
+  vec3f *p;
+  float *d;
+  unsigned char *valid;
+};
+
+#define INTERPOLATION_CHUNK 65536
+
+// Split n vertices across the thread pool and wait for them all
+
+static void
+parallel_sample(VolumeP vol, int n, vec3f *p, float *d, unsigned char *valid)
+{
+  ThreadPool *threadpool = GetTheApplication()->GetTheThreadPool();
+  std::vector<std::future<int>> rvec;
+
+  for (int i = 0; i < n; i += INTERPOLATION_CHUNK)
+  {
+    int k = ((i + INTERPOLATION_CHUNK) > n) ? (n - i) : INTERPOLATION_CHUNK;
+    rvec.emplace_back(threadpool->AddTask(new interpolate_task(vol, k, p + i, d + i, valid ? valid + i : NULL)));
+  }
+
+  for (auto& r : rvec)
+    r.get();
+}
+
 class InterpolateVolumeOntoGeometryMsg : public Work
 {
 public:
@@ -63,72 +127,83 @@ public:
         memcpy((void *)dst->GetConnectivity(), (void *)src->GetConnectivity(), dst->GetConnectivitySize()*sizeof(int));
     }
 
-    float ox, oy, oz;
-    vol->get_ghosted_local_origin(ox, oy, oz);
+    int nv = dst->GetNumberOfVertices();
+    vec3f *p = dst->GetVertices();
+    float *d = dst->GetData();
 
-    float dx, dy, dz;
-    vol->get_deltas(dx, dy, dz);
+    // Interpolate everything we can locally, noting which vertices fell outside
+    // the local ghosted partition
 
-    int ik, jk, kk;
-    vol->get_ghosted_local_counts(ik, jk, kk);
+    std::vector<unsigned char> valid(nv);
+    parallel_sample(vol, nv, p, d, valid.data());
 
-    int istride = 1;
-    int jstride = ik;
-    int kstride = ik * jk;
+    int rank = GetTheApplication()->GetRank();
+    int size = GetTheApplication()->GetSize();
 
-    vec3f *p = dst->GetVertices();
-    float *d = dst->GetData();
-    float m, M;
-    for (int i = 0; i < dst->GetNumberOfVertices(); i++, p++, d++)
+    if (size > 1)
     {
-      float x = (p->x - ox) / dx;
-      float y = (p->y - oy) / dy;
-      float z = (p->z - oz) / dz;
-  
-      int ix = (int)x;
-      int iy = (int)y;
-      int iz = (int)z;
-  
-      float dx = x - ix;
-      float dy = y - iy;
-      float dz = z - iz;
-  
-      int v000 = (ix + 0) * istride + (iy + 0) * jstride + (iz + 0) * kstride;
-      int v001 = (ix + 0) * istride + (iy + 0) * jstride + (iz + 1) * kstride;
-      int v010 = (ix + 0) * istride + (iy + 1) * jstride + (iz + 0) * kstride;
-      int v011 = (ix + 0) * istride + (iy + 1) * jstride + (iz + 1) * kstride;
-      int v100 = (ix + 1) * istride + (iy + 0) * jstride + (iz + 0) * kstride;
-      int v101 = (ix + 1) * istride + (iy + 0) * jstride + (iz + 1) * kstride;
-      int v110 = (ix + 1) * istride + (iy + 1) * jstride + (iz + 0) * kstride;
-      int v111 = (ix + 1) * istride + (iy + 1) * jstride + (iz + 1) * kstride;
-      
-      float b000 = (1.0 - dx) * (1.0 - dy) * (1.0 - dz);
-      float b001 = (1.0 - dx) * (1.0 - dy) * (dz);
-      float b010 = (1.0 - dx) * (dy) * (1.0 - dz);
-      float b011 = (1.0 - dx) * (dy) * (dz);
-      float b100 = (dx) * (1.0 - dy) * (1.0 - dz);
-      float b101 = (dx) * (1.0 - dy) * (dz);
-      float b110 = (dx) * (dy) * (1.0 - dz);
-      float b111 = (dx) * (dy) * (dz);
-      
-      if (vol->get_type() == Volume::FLOAT)
+      // Route the vertices that missed to the ranks that own them, have them
+      // interpolated there and scatter the results back.   Vertices outside the
+      // global volume keep the 0 they were given locally.
+
+      std::vector<std::vector<int>> misses(size);
+      for (int i = 0; i < nv; i++)
+        if (! valid[i])
+        {
+          int owner = vol->PointOwner(p[i]);
+          if (owner >= 0 && owner != rank)
+            misses[owner].push_back(i);
+        }
+
+      std::vector<int> scounts(size), sdispls(size), rcounts(size), rdispls(size);
+      for (int r = 0; r < size; r++)
+        scounts[r] = misses[r].size();
+
+      MPI_Alltoall(scounts.data(), 1, MPI_INT, rcounts.data(), 1, MPI_INT, c);
+
+      int nsend = 0, nrecv = 0;
+      for (int r = 0; r < size; r++)
       {
-        float *s = (float *)vol->get_samples();
-        *d = s[v000]*b000 + s[v001]*b001 + s[v010]*b010 + s[v011]*b011 +
-             s[v100]*b100 + s[v101]*b101 + s[v110]*b110 + s[v111]*b111;
-      }        
-      else
+        sdispls[r] = nsend; nsend += scounts[r];
+        rdispls[r] = nrecv; nrecv += rcounts[r];
+      }
+
+      std::vector<vec3f> spoints(nsend), rpoints(nrecv);
+      for (int r = 0; r < size; r++)
+        for (int j = 0; j < scounts[r]; j++)
+          spoints[sdispls[r] + j] = p[misses[r][j]];
+
+      // Points travel as 3 floats apiece
+
+      std::vector<int> scounts3(size), sdispls3(size), rcounts3(size), rdispls3(size);
+      for (int r = 0; r < size; r++)
       {
-        unsigned char *s = (unsigned char *)vol->get_samples();
-        *d = s[v000]*b000 + s[v001]*b001 + s[v010]*b010 + s[v011]*b011 +
-             s[v100]*b100 + s[v101]*b101 + s[v110]*b110 + s[v111]*b111;
-      }        
+        scounts3[r] = 3*scounts[r]; sdispls3[r] = 3*sdispls[r];
+        rcounts3[r] = 3*rcounts[r]; rdispls3[r] = 3*rdispls[r];
+      }
+
+      MPI_Alltoallv((float *)spoints.data(), scounts3.data(), sdispls3.data(), MPI_FLOAT,
+                    (float *)rpoints.data(), rcounts3.data(), rdispls3.data(), MPI_FLOAT, c);
 
-      if (i == 0) m = M = *d;
+      std::vector<float> svalues(nsend), rvalues(nrecv);
+      parallel_sample(vol, nrecv, rpoints.data(), rvalues.data(), NULL);
+
+      MPI_Alltoallv(rvalues.data(), rcounts.data(), rdispls.data(), MPI_FLOAT,
+                    svalues.data(), scounts.data(), sdispls.data(), MPI_FLOAT, c);
+
+      for (int r = 0; r < size; r++)
+        for (int j = 0; j < scounts[r]; j++)
+          d[misses[r][j]] = svalues[sdispls[r] + j];
+    }
+
+    float m = 0, M = 0;
+    for (int i = 0; i < nv; i++)
+    {
+      if (i == 0) m = M = d[i];
       else
       {
-        if (m > *d) m = *d;
-        if (M < *d) M = *d;
+        if (m > d[i]) m = d[i];
+        if (M < d[i]) M = d[i];
       }
     }
 
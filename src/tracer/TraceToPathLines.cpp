@@ -13,8 +13,8 @@ class TraceToPathLinesMsg : public Work
 {
 public:
 
-  TraceToPathLinesMsg(RungeKuttaP rkp, PathLinesP plp, float t, float dt)
-    : TraceToPathLinesMsg(2*sizeof(Key) + 2*sizeof(float))
+  TraceToPathLinesMsg(RungeKuttaP rkp, PathLinesP plp, float t, float dt, bool incremental)
+    : TraceToPathLinesMsg(2*sizeof(Key) + 2*sizeof(float) + sizeof(int))
   {
     unsigned char *g = (unsigned char *)get();
     *(Key *)g = rkp->getkey();
@@ -25,6 +25,8 @@ public:
     g += sizeof(float);
     *(float *)g = dt;
     g += sizeof(float);
+    *(int *)g = incremental ? 1 : 0;
+    g += sizeof(int);
   }
 
   ~TraceToPathLinesMsg() {}
@@ -43,9 +45,18 @@ public:
     g += sizeof(float);
     float dt = *(float *)g;
     g += sizeof(float);
+    bool incremental = *(int *)g == 1;
+    g += sizeof(int);
 
     plp->CopyPartitioning(rkp);
 
+    if (incremental)
+    {
+      update_incrementally(rkp, plp, t, dt);
+      MPI_Barrier(c);
+      return false;
+    }
+
     std::vector<int> keys;
     rkp->get_keys(keys);
 
@@ -110,6 +121,95 @@ public:
 
     return false;
   }
+
+private:
+  // The windows of plp are valid if they were laid out from the same set
+  // of segments that rkp currently holds
+
+  bool windows_match(RungeKuttaP rkp, std::vector<int>& keys, PathLinesP plp)
+  {
+    std::vector<PLWindow>& windows = plp->GetWindows();
+
+    int i = 0;
+    for (auto id = keys.begin(); id != keys.end(); id++)
+    {
+      trajectory traj = rkp->get_trajectory(*id);
+      for (auto segp = traj->begin(); segp != traj->end(); segp++, i++)
+        if (i >= windows.size() || windows[i].size != (*segp)->times.size())
+          return false;
+    }
+
+    return i == windows.size();
+  }
+
+  void update_incrementally(RungeKuttaP rkp, PathLinesP plp, float t, float dt)
+  {
+    std::vector<int> keys;
+    rkp->get_keys(keys);
+
+    // The first time through (or if the trajectories have changed) lay out
+    // every segment in full in its own slot of the vertex buffer.   This is
+    // the only time vertices or data are copied.
+
+    if (! plp->is_incremental() || ! windows_match(rkp, keys, plp))
+    {
+      std::vector<int> sizes;
+      for (auto id = keys.begin(); id != keys.end(); id++)
+      {
+        trajectory traj = rkp->get_trajectory(*id);
+        for (auto segp = traj->begin(); segp != traj->end(); segp++)
+          sizes.push_back((*segp)->times.size());
+      }
+
+      plp->allocate_windows(sizes);
+
+      vec3f *pbuf = plp->GetVertices();
+      float *dbuf = plp->GetData();
+
+      for (auto id = keys.begin(); id != keys.end(); id++)
+      {
+        trajectory traj = rkp->get_trajectory(*id);
+        for (auto segp = traj->begin(); segp != traj->end(); segp++)
+        {
+          auto seg = *segp;
+          int n = seg->times.size();
+          memcpy((void *)pbuf, (void *)seg->points.data(), n*sizeof(vec3f));
+          memcpy((void *)dbuf, (void *)seg->times.data(), n*sizeof(float));
+          pbuf += n;
+          dbuf += n;
+        }
+      }
+    }
+
+    // Segment times increase monotonically, so each window's head and tail only
+    // move forward as t advances.  If t went backwards, start the windows over.
+
+    std::vector<PLWindow>& windows = plp->GetWindows();
+    bool restart = t < plp->get_window_time();
+
+    int i = 0;
+    for (auto id = keys.begin(); id != keys.end(); id++)
+    {
+      trajectory traj = rkp->get_trajectory(*id);
+      for (auto segp = traj->begin(); segp != traj->end(); segp++, i++)
+      {
+        float *times = (*segp)->times.data();
+        PLWindow& w = windows[i];
+
+        if (restart)
+          w.first = w.last = 0;
+
+        while (w.last < w.size && times[w.last] < t)
+          w.last++;
+
+        while (w.first < w.last && times[w.first] <= (t - dt))
+          w.first++;
+      }
+    }
+
+    plp->set_window_time(t);
+    plp->update_connectivity();
+  }
 };
 
 WORK_CLASS_TYPE(TraceToPathLinesMsg)
@@ -121,9 +221,9 @@ RegisterTraceToPathLines()
 }
 
 void
-TraceToPathLines(RungeKuttaP rkp, PathLinesP plp, float t, float dt)
+TraceToPathLines(RungeKuttaP rkp, PathLinesP plp, float t, float dt, bool incremental)
 {
-  TraceToPathLinesMsg msg(rkp, plp, t, dt);
+  TraceToPathLinesMsg msg(rkp, plp, t, dt, incremental);
   msg.Broadcast(true, true);
 }
 
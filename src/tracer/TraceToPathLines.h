@@ -2,6 +2,13 @@ namespace gxy
 {
 
 void RegisterTraceToPathLines();
-void TraceToPathLines(RungeKuttaP rkp, PathLinesP plp, float t, float dt);
+
+// Extract the portions of the trajectories in rkp that lie within the time
+// window (t - dt, t) into plp.   If incremental, plp retains every trajectory
+// in full from the first call and subsequent calls only advance the visible 
+// window of each line and rebuild the connectivity, so successive animation 
+// frames don't pay for copying the whole trajectory set.
+
+void TraceToPathLines(RungeKuttaP rkp, PathLinesP plp, float t, float dt, bool incremental = false);
 
 }
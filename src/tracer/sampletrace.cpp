@@ -63,6 +63,7 @@ float t = -1.0;
 float max_i = -1;
 float dt = 1.0;
 int nf = 1;
+bool incremental = false;
 
 
 void
@@ -81,6 +82,7 @@ syntax(char *a)
   cerr << "  -I max        scale the colormap to this to avoid hairballs (scale to max integration time)\n";
   cerr << "  -dt dt        truncate pathlines to this length in proportion of total integration time (don't truncate)\n";
   cerr << "  -nf nf        animate by moving head of pathlines from 0 to total integration time in this number of frames (1)\n";
+  cerr << "  -inc          update pathlines incrementally from frame to frame rather than rebuilding them\n";
   cerr << "  -sdata name   volume to map onto samples\n";
   cerr << "  -pdata name   volume to map onto pathlines\n";
   exit(1);
@@ -151,6 +153,10 @@ main(int argc, char * argv[])
     {
       nf = atoi(argv[++i]);
     }
+    else if (! strcmp(argv[i], "-inc"))
+    {
+      incremental = true;
+    }
     else if (! strcmp(argv[i], "-pdata"))
     {
       pdata = argv[++i];
@@ -354,7 +360,7 @@ main(int argc, char * argv[])
       // Create a rendering set for the rendering pass...
       RenderingSetP rs = RenderingSet::NewP();
     
-      TraceToPathLines(rkp, plp, head_time, dt);
+      TraceToPathLines(rkp, plp, head_time, dt, incremental);
       plp->Commit();
 
       if (pdata != "")